@@ -0,0 +1,113 @@
+#ifndef ADMISSION_CONTROL_HPP
+#define ADMISSION_CONTROL_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * @brief Bounded admission for search requests.
+ *
+ * At most maxActive searches run at once; up to maxQueued more may wait for a
+ * slot. Requests arriving when the queue is full are rejected immediately
+ * (the server answers 503), and queued requests give up when their deadline
+ * passes, so waiting time counts against the request's own timeout.
+*/
+class AdmissionController {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Result { Admitted, Rejected, TimedOut };
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t maxActive;
+    size_t maxQueued;
+    size_t active;
+    size_t queued;
+    uint64_t rejectedCount;
+    uint64_t timedOutCount;
+
+public:
+    AdmissionController(size_t maxActiveSearches, size_t maxQueuedSearches)
+        : maxActive(maxActiveSearches == 0 ? 1 : maxActiveSearches), maxQueued(maxQueuedSearches),
+          active(0), queued(0), rejectedCount(0), timedOutCount(0) {}
+
+    /**
+     * @brief Wait for a slot.
+     * @param deadline Give up at this time (ignored if hasDeadline is false).
+     */
+    Result acquire(bool hasDeadline, Clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (active < maxActive) {
+            active++;
+            return Result::Admitted;
+        }
+        if (queued >= maxQueued) {
+            rejectedCount++;
+            return Result::Rejected;
+        }
+
+        queued++;
+        auto ready = [this] { return active < maxActive; };
+        bool admitted = true;
+        if (hasDeadline) {
+            admitted = cv.wait_until(lock, deadline, ready);
+        } else {
+            cv.wait(lock, ready);
+        }
+        queued--;
+
+        if (!admitted) {
+            timedOutCount++;
+            return Result::TimedOut;
+        }
+        active++;
+        return Result::Admitted;
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            active--;
+        }
+        cv.notify_one();
+    }
+
+    uint64_t rejected() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return rejectedCount;
+    }
+
+    uint64_t timedOut() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return timedOutCount;
+    }
+
+    /**
+     * @brief RAII slot: releases on destruction if it was admitted.
+     */
+    class Slot {
+    private:
+        AdmissionController& controller;
+        Result result;
+
+    public:
+        Slot(AdmissionController& c, bool hasDeadline, Clock::time_point deadline)
+            : controller(c), result(c.acquire(hasDeadline, deadline)) {}
+
+        ~Slot() {
+            if (result == Result::Admitted) controller.release();
+        }
+
+        Slot(const Slot&) = delete;
+        Slot& operator=(const Slot&) = delete;
+
+        bool admitted() const { return result == Result::Admitted; }
+        Result status() const { return result; }
+    };
+};
+
+#endif // ADMISSION_CONTROL_HPP
@@ -0,0 +1,410 @@
+#ifndef BOOLEAN_QUERY_HPP
+#define BOOLEAN_QUERY_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include "index_reader.hpp"
+#include "bm25.hpp"
+#include "utils.hpp"
+
+struct BooleanClause;
+
+/**
+ * @brief Node of a boolean query: a term (leaf) or a group of clauses.
+ *
+ * A group matches the documents containing every MUST clause and no MUST_NOT
+ * clause; without MUST clauses at least one SHOULD clause has to match.
+ * SHOULD clauses add to the score when they match. DEFAULT marks juxtaposed
+ * clauses, which follow the query mode (MUST for "and", SHOULD for "or").
+*/
+struct BooleanNode {
+    std::string term;                     // leaf only
+    double weight;                        // term^w or (group)^w
+    std::vector<BooleanClause> clauses;   // group only
+
+    BooleanNode() : weight(1.0) {}
+
+    bool leaf() const { return !term.empty(); }
+};
+
+struct BooleanClause {
+    enum Occur { MUST, SHOULD, DEFAULT, MUST_NOT };
+
+    Occur occur;
+    BooleanNode node;
+};
+
+/**
+ * @brief Parser for the boolean query language.
+ *
+ *     query   := seq ("OR" seq)*
+ *     seq     := conj conj*                 (juxtaposition: query mode)
+ *     conj    := unary ("AND" unary)*
+ *     unary   := "NOT" unary | "+" unary | "-" unary | primary
+ *     primary := "(" query ")" ["^" w] | "\"phrase\"" | word ["^" w]
+ *
+ * AND binds tighter than juxtaposition, which binds tighter than OR; NOT and
+ * a leading '-' exclude, a leading '+' requires. Phrases are conjunctions of
+ * their words (positions are not checked in boolean queries), as are words
+ * the tokenizer splits (e-mail). Words keep '*' for wildcard expansion.
+ * Unbalanced parentheses are closed implicitly.
+*/
+class BooleanParser {
+public:
+    /**
+     * @brief Whether text uses boolean syntax (AND/OR/NOT, leading +/-,
+     *        parentheses or ^weights); other queries keep the plain parser.
+    */
+    static bool detect(const std::string& text) {
+        for (const auto& word : split(text)) {
+            if (word == "AND" || word == "OR" || word == "NOT") return true;
+            if (word.size() > 1 && (word[0] == '+' || word[0] == '-')) return true;
+            if (word.find_first_of("()^") != std::string::npos) return true;
+        }
+        return false;
+    }
+
+    static BooleanNode parse(const std::string& text) {
+        BooleanParser parser(text);
+        BooleanNode root = parser.parseQuery();
+        return root;
+    }
+
+    /**
+     * @brief Terms that can contribute to the score (not under MUST_NOT),
+     *        first-occurrence order.
+    */
+    static void positiveTerms(const BooleanNode& node, std::vector<std::string>& out) {
+        if (node.leaf()) {
+            if (std::find(out.begin(), out.end(), node.term) == out.end()) out.push_back(node.term);
+            return;
+        }
+        for (const auto& clause : node.clauses) {
+            if (clause.occur != BooleanClause::MUST_NOT) positiveTerms(clause.node, out);
+        }
+    }
+
+private:
+    enum TokenType { WORD, PHRASE, LPAREN, RPAREN, AND, OR, NOT, PLUS, MINUS, WEIGHT, END };
+
+    struct Token {
+        TokenType type;
+        std::string text;
+        double weight;
+    };
+
+    std::vector<Token> tokens;
+    size_t pos;
+
+    static std::vector<std::string> split(const std::string& text) {
+        std::vector<std::string> words;
+        std::string word;
+        for (char c : text) {
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                if (!word.empty()) words.push_back(word);
+                word.clear();
+            } else {
+                word += c;
+            }
+        }
+        if (!word.empty()) words.push_back(word);
+        return words;
+    }
+
+    explicit BooleanParser(const std::string& text) : pos(0) {
+        size_t i = 0;
+        while (i < text.size()) {
+            char c = text[i];
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                i++;
+            } else if (c == '(' || c == ')') {
+                tokens.push_back({c == '(' ? LPAREN : RPAREN, "", 1.0});
+                i++;
+            } else if (c == '"') {
+                size_t close = text.find('"', i + 1);
+                if (close == std::string::npos) close = text.size();
+                tokens.push_back({PHRASE, text.substr(i + 1, close - i - 1), 1.0});
+                i = close + 1;
+            } else if (c == '^') {
+                size_t end = i + 1;
+                while (end < text.size() && (std::isdigit(static_cast<unsigned char>(text[end])) || text[end] == '.')) {
+                    end++;
+                }
+                double weight = end > i + 1 ? std::atof(text.substr(i + 1, end - i - 1).c_str()) : 1.0;
+                tokens.push_back({WEIGHT, "", weight});
+                i = end;
+            } else if ((c == '+' || c == '-') && i + 1 < text.size() &&
+                       !std::isspace(static_cast<unsigned char>(text[i + 1]))) {
+                tokens.push_back({c == '+' ? PLUS : MINUS, "", 1.0});
+                i++;
+            } else {
+                size_t end = i;
+                while (end < text.size() && !std::isspace(static_cast<unsigned char>(text[end])) &&
+                       text[end] != '(' && text[end] != ')' && text[end] != '"' && text[end] != '^') {
+                    end++;
+                }
+                std::string word = text.substr(i, end - i);
+                TokenType type = word == "AND" ? AND : word == "OR" ? OR : word == "NOT" ? NOT : WORD;
+                tokens.push_back({type, word, 1.0});
+                i = end;
+            }
+        }
+        tokens.push_back({END, "", 1.0});
+    }
+
+    const Token& peek() const { return tokens[pos]; }
+
+    // a group of one non-excluded clause is that clause
+    static BooleanNode group(std::vector<BooleanClause> clauses) {
+        BooleanNode node;
+        if (clauses.size() == 1 && clauses[0].occur != BooleanClause::MUST_NOT) {
+            return std::move(clauses[0].node);
+        }
+        node.clauses = std::move(clauses);
+        return node;
+    }
+
+    BooleanNode parseQuery() {
+        std::vector<BooleanClause> alternatives;
+        alternatives.push_back({BooleanClause::SHOULD, parseSeq()});
+        while (peek().type == OR) {
+            pos++;
+            alternatives.push_back({BooleanClause::SHOULD, parseSeq()});
+        }
+        return group(std::move(alternatives));
+    }
+
+    BooleanNode parseSeq() {
+        std::vector<BooleanClause> clauses;
+        while (peek().type != END && peek().type != OR && peek().type != RPAREN) {
+            if (peek().type == AND) {   // stray AND
+                pos++;
+                continue;
+            }
+            clauses.push_back(parseConj());
+        }
+        return group(std::move(clauses));
+    }
+
+    BooleanClause parseConj() {
+        BooleanClause first = parseUnary();
+        if (peek().type != AND) return first;
+
+        std::vector<BooleanClause> clauses;
+        if (first.occur != BooleanClause::MUST_NOT) first.occur = BooleanClause::MUST;
+        clauses.push_back(std::move(first));
+        while (peek().type == AND) {
+            pos++;
+            if (peek().type == END || peek().type == OR || peek().type == RPAREN) break;
+            BooleanClause next = parseUnary();
+            if (next.occur != BooleanClause::MUST_NOT) next.occur = BooleanClause::MUST;
+            clauses.push_back(std::move(next));
+        }
+        return {BooleanClause::DEFAULT, group(std::move(clauses))};
+    }
+
+    BooleanClause parseUnary() {
+        TokenType type = peek().type;
+        if (type == NOT || type == MINUS || type == PLUS) {
+            pos++;
+            if (peek().type == END || peek().type == OR || peek().type == RPAREN) {
+                return {BooleanClause::SHOULD, BooleanNode()};   // dangling operator
+            }
+            BooleanClause inner = parseUnary();
+            inner.occur = type == PLUS ? BooleanClause::MUST : BooleanClause::MUST_NOT;
+            return inner;
+        }
+        return {BooleanClause::DEFAULT, parsePrimary()};
+    }
+
+    BooleanNode parsePrimary() {
+        BooleanNode node;
+        const Token& token = tokens[pos++];
+        if (token.type == LPAREN) {
+            node = parseQuery();
+            if (peek().type == RPAREN) pos++;
+        } else if (token.type == PHRASE || token.type == WORD) {
+            std::vector<BooleanClause> words;
+            for (auto& term : tokenize_words(token.text, token.type == WORD)) {
+                if (term.find_first_not_of('*') == std::string::npos) continue;   // bare "*"
+                BooleanNode leaf;
+                leaf.term = term;
+                words.push_back({BooleanClause::MUST, std::move(leaf)});
+            }
+            node = group(std::move(words));
+        }
+        if (peek().type == WEIGHT) node.weight *= tokens[pos++].weight;
+        return node;
+    }
+};
+
+/**
+ * @brief Cursor over the documents matched by a boolean (sub)query.
+ *
+ * Every operator exposes the same forward-only interface as PostingList, so
+ * groups nest freely and skip with nextGEQ all the way down to the skip
+ * tables of the term lists. A cursor is positioned on its first match once
+ * nextGEQ(0) has been called.
+*/
+class QueryCursor {
+public:
+    virtual ~QueryCursor() = default;
+
+    virtual bool valid() const = 0;
+    virtual uint32_t doc() const = 0;
+
+    // advance to the first match >= target; false once exhausted
+    virtual bool nextGEQ(uint32_t target) = 0;
+
+    bool next() { return valid() && doc() < UINT32_MAX && nextGEQ(doc() + 1); }
+
+    // score of the current document; matched counts the term postings scored
+    virtual double score(uint32_t dl, uint32_t& matched) = 0;
+
+    // estimated number of matching documents
+    virtual uint64_t cost() const = 0;
+};
+
+/**
+ * @brief Leaf: one posting list scored with weighted BM25 (or, on an
+ *        impact-scored index, weight * stored impact).
+*/
+class TermCursor : public QueryCursor {
+private:
+    PostingList list;
+    double idf;
+    double weight;
+    uint64_t df;
+    double avgdl;
+    bm25::Params params;
+    bool impacts;
+
+public:
+    TermCursor(PostingList&& postings, uint32_t docFreq, uint64_t docCount, double avgLen,
+               bm25::Params bm25Params, double termWeight, bool impactScoring = false)
+        : list(std::move(postings)), idf(bm25::idf(docCount, docFreq)), weight(termWeight),
+          df(docFreq), avgdl(avgLen), params(bm25Params), impacts(impactScoring) {}
+
+    bool valid() const override { return list.valid(); }
+    uint32_t doc() const override { return list.doc(); }
+    bool nextGEQ(uint32_t target) override { return list.nextGEQ(target); }
+
+    double score(uint32_t dl, uint32_t& matched) override {
+        matched++;
+        if (impacts) return weight * list.freq();
+        return weight * bm25::score(idf, list.freq(), dl, avgdl, params);
+    }
+
+    uint64_t cost() const override { return df; }
+};
+
+/**
+ * @brief Group: conjunction of the required children, union of the optional
+ *        ones when nothing is required, minus the excluded children.
+ *
+ * Children are ordered by estimated cost: the cheapest required child drives
+ * the conjunction and the others are probed with nextGEQ on its candidates;
+ * excluded children are probed the same way (most frequent first), so an
+ * exclusion skips through its list instead of filtering a materialized result.
+*/
+class BooleanCursor : public QueryCursor {
+private:
+    std::vector<std::unique_ptr<QueryCursor>> required;
+    std::vector<std::unique_ptr<QueryCursor>> optional;
+    std::vector<std::unique_ptr<QueryCursor>> excluded;
+    double weight;
+    uint32_t current;
+    bool positioned;
+    bool exhausted;
+
+    bool stop() {
+        exhausted = true;
+        return false;
+    }
+
+    bool isExcluded(uint32_t doc) {
+        for (auto& child : excluded) {
+            if (child->nextGEQ(doc) && child->doc() == doc) return true;
+        }
+        return false;
+    }
+
+public:
+    BooleanCursor(std::vector<std::unique_ptr<QueryCursor>> must,
+                  std::vector<std::unique_ptr<QueryCursor>> should,
+                  std::vector<std::unique_ptr<QueryCursor>> mustNot,
+                  double groupWeight)
+        : required(std::move(must)), optional(std::move(should)), excluded(std::move(mustNot)),
+          weight(groupWeight), current(0), positioned(false), exhausted(false) {
+        auto cheaper = [](const std::unique_ptr<QueryCursor>& a, const std::unique_ptr<QueryCursor>& b) {
+            return a->cost() < b->cost();
+        };
+        std::stable_sort(required.begin(), required.end(), cheaper);
+        std::stable_sort(excluded.begin(), excluded.end(),
+                         [&cheaper](const auto& a, const auto& b) { return cheaper(b, a); });
+    }
+
+    bool valid() const override { return positioned && !exhausted; }
+    uint32_t doc() const override { return current; }
+
+    bool nextGEQ(uint32_t target) override {
+        if (exhausted) return false;
+        if (positioned && current >= target) return true;
+
+        while (true) {
+            uint32_t candidate;
+            if (!required.empty()) {
+                // leapfrog from the cheapest list
+                if (!required[0]->nextGEQ(target)) return stop();
+                candidate = required[0]->doc();
+                bool aligned = true;
+                for (size_t i = 1; i < required.size(); i++) {
+                    if (!required[i]->nextGEQ(candidate)) return stop();
+                    if (required[i]->doc() != candidate) {
+                        target = required[i]->doc();
+                        aligned = false;
+                        break;
+                    }
+                }
+                if (!aligned) continue;
+            } else {
+                candidate = UINT32_MAX;
+                for (auto& child : optional) {
+                    if (child->nextGEQ(target)) candidate = std::min(candidate, child->doc());
+                }
+                if (candidate == UINT32_MAX) return stop();
+            }
+
+            if (isExcluded(candidate)) {
+                if (candidate == UINT32_MAX) return stop();
+                target = candidate + 1;
+                continue;
+            }
+            current = candidate;
+            positioned = true;
+            return true;
+        }
+    }
+
+    double score(uint32_t dl, uint32_t& matched) override {
+        double total = 0.0;
+        for (auto& child : required) total += child->score(dl, matched);
+        for (auto& child : optional) {
+            if (child->nextGEQ(current) && child->doc() == current) total += child->score(dl, matched);
+        }
+        return weight * total;
+    }
+
+    uint64_t cost() const override {
+        if (!required.empty()) return required.front()->cost();
+        uint64_t total = 0;
+        for (const auto& child : optional) total += child->cost();
+        return total;
+    }
+};
+
+#endif // BOOLEAN_QUERY_HPP
@@ -0,0 +1,141 @@
+#ifndef COMPLETION_TRIE_HPP
+#define COMPLETION_TRIE_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+
+/**
+ * @brief Completion trie with precomputed top-k completions per node
+ *        (suggest.bin, written by the suggester tool).
+ *
+ * A radix trie over the suggestion terms: each node carries the label of the
+ * edge leading to it and the ids of the k heaviest terms below it, so a
+ * lookup walks at most |prefix| characters and copies one list; posting
+ * lists are never read. Children of a node are stored contiguously.
+ * Weights are the term's df, or (query log count << 32) | df when the trie
+ * was built from a query log.
+ *
+ * File layout (little-endian):
+ *     char[4] "SUGG", uint32 version, uint32 k
+ *     uint32 termCount, nodeCount, topCount, labelBytes, termBytes
+ *     uint32 termOffsets[termCount + 1]; char terms[termBytes]
+ *     uint64 weights[termCount]
+ *     Node nodes[nodeCount]            (node 0 is the root)
+ *     uint32 top[topCount]             (term ids, heaviest first)
+ *     char labels[labelBytes]
+*/
+class CompletionTrie {
+public:
+    static constexpr uint32_t VERSION = 1;
+
+    struct Node {
+        uint32_t labelOffset;
+        uint32_t labelLen;
+        uint32_t firstChild;
+        uint32_t childCount;
+        uint32_t topOffset;
+        uint32_t topCount;
+    };
+
+    struct Completion {
+        std::string term;
+        uint64_t weight;
+    };
+
+private:
+    uint32_t k;
+    std::vector<uint32_t> termOffsets;
+    std::vector<char> termBytes;
+    std::vector<uint64_t> weights;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> top;
+    std::vector<char> labels;
+
+    template <typename T>
+    static bool readArray(std::ifstream& file, std::vector<T>& out, size_t count) {
+        out.resize(count);
+        file.read(reinterpret_cast<char*>(out.data()), count * sizeof(T));
+        return static_cast<bool>(file);
+    }
+
+public:
+    CompletionTrie() : k(0) {}
+
+    /**
+     * @brief Load suggest.bin; a missing file is not an error (no suggestions).
+     */
+    bool load(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) return false;
+
+        char magic[4];
+        uint32_t header[7];
+        file.read(magic, 4);
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!file || std::string(magic, 4) != "SUGG" || header[0] != VERSION) {
+            std::cerr << "Invalid completion trie: " << path << std::endl;
+            return false;
+        }
+        k = header[1];
+        uint32_t termCount = header[2], nodeCount = header[3], topCount = header[4];
+        uint32_t labelBytes = header[5], termByteCount = header[6];
+
+        if (!readArray(file, termOffsets, termCount + 1) || !readArray(file, termBytes, termByteCount) ||
+            !readArray(file, weights, termCount) || !readArray(file, nodes, nodeCount) ||
+            !readArray(file, top, topCount) || !readArray(file, labels, labelBytes) || nodes.empty()) {
+            std::cerr << "Truncated completion trie: " << path << std::endl;
+            nodes.clear();
+            return false;
+        }
+        std::cout << "Loaded completion trie: " << termCount << " terms, " << nodeCount
+                  << " nodes, top-" << k << std::endl;
+        return true;
+    }
+
+    bool available() const { return !nodes.empty(); }
+
+    // completions stored per node (more cannot be returned)
+    uint32_t maxK() const { return k; }
+
+    /**
+     * @brief Up to `limit` completions of prefix, heaviest first.
+     */
+    void complete(const std::string& prefix, size_t limit, std::vector<Completion>& out) const {
+        out.clear();
+        if (nodes.empty()) return;
+
+        uint32_t current = 0;
+        size_t pos = 0;
+        while (pos < prefix.size()) {
+            const Node& node = nodes[current];
+            uint32_t next = UINT32_MAX;
+            for (uint32_t c = node.firstChild; c < node.firstChild + node.childCount; c++) {
+                if (labels[nodes[c].labelOffset] == prefix[pos]) {
+                    next = c;
+                    break;
+                }
+            }
+            if (next == UINT32_MAX) return;
+
+            // the prefix may end inside the edge label
+            const Node& child = nodes[next];
+            size_t len = std::min<size_t>(child.labelLen, prefix.size() - pos);
+            if (prefix.compare(pos, len, &labels[child.labelOffset], len) != 0) return;
+            pos += len;
+            current = next;
+        }
+
+        const Node& node = nodes[current];
+        size_t count = std::min<size_t>(node.topCount, limit);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t id = top[node.topOffset + i];
+            out.push_back({std::string(&termBytes[termOffsets[id]], termOffsets[id + 1] - termOffsets[id]),
+                           weights[id]});
+        }
+    }
+};
+
+#endif // COMPLETION_TRIE_HPP
@@ -0,0 +1,178 @@
+#ifndef FEEDBACK_HPP
+#define FEEDBACK_HPP
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include "index_reader.hpp"
+
+/**
+ * @brief RM3 pseudo-relevance feedback settings.
+*/
+struct FeedbackOptions {
+    bool enabled;
+    uint32_t docs;            // first-pass documents taken as relevant
+    uint32_t terms;           // expansion terms added to the query
+    double originalWeight;    // lambda: weight of the original query in the mix
+    double maxDfRatio;        // terms in more than this fraction of documents are not expansion candidates
+
+    FeedbackOptions() : enabled(false), docs(10), terms(10), originalWeight(0.5), maxDfRatio(0.1) {}
+};
+
+/**
+ * @brief A term of the expanded query and its weight.
+*/
+struct FeedbackTerm {
+    std::string term;
+    double weight;
+};
+
+/**
+ * @brief What feedback did for one query, with per-stage timings.
+*/
+struct FeedbackStats {
+    bool applied;                     // false: the query was evaluated as is
+    size_t feedbackDocs;              // first-pass documents used
+    size_t candidates;                // distinct terms in their vectors
+    size_t dropped;                   // candidates that did not fit the accumulator
+    std::vector<FeedbackTerm> terms;  // expanded query, heaviest first
+    double firstPassMs;
+    double selectionMs;               // forward index reads + term selection
+    double secondPassMs;
+
+    FeedbackStats() : applied(false), feedbackDocs(0), candidates(0), dropped(0),
+                      firstPassMs(0.0), selectionMs(0.0), secondPassMs(0.0) {}
+};
+
+/**
+ * @brief Fixed-capacity termID -> weight accumulator (open addressing).
+ *
+ * Sized once, so selecting expansion terms costs the same memory whatever
+ * the vocabulary size; terms arriving after CAPACITY distinct terms are
+ * counted in dropped() and ignored. reset() only clears the used slots.
+*/
+class TermAccumulator {
+public:
+    static constexpr uint32_t CAPACITY = 4096;        // distinct terms
+    static constexpr uint32_t SLOTS = 2 * CAPACITY;   // power of two, load <= 0.5
+
+private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    std::vector<uint32_t> keys;
+    std::vector<double> values;
+    std::vector<uint32_t> used;    // occupied slots, in insertion order
+    size_t droppedTerms;
+
+public:
+    TermAccumulator() : keys(SLOTS, EMPTY), values(SLOTS, 0.0), droppedTerms(0) {
+        used.reserve(CAPACITY);
+    }
+
+    void reset() {
+        for (uint32_t slot : used) {
+            keys[slot] = EMPTY;
+            values[slot] = 0.0;
+        }
+        used.clear();
+        droppedTerms = 0;
+    }
+
+    void add(uint32_t termID, double weight) {
+        uint32_t slot = (termID * 2654435761u) & (SLOTS - 1);
+        while (keys[slot] != EMPTY && keys[slot] != termID) slot = (slot + 1) & (SLOTS - 1);
+        if (keys[slot] == EMPTY) {
+            if (used.size() == CAPACITY) {
+                droppedTerms++;
+                return;
+            }
+            keys[slot] = termID;
+            used.push_back(slot);
+        }
+        values[slot] += weight;
+    }
+
+    size_t size() const { return used.size(); }
+    size_t dropped() const { return droppedTerms; }
+
+    template <typename F>
+    void forEach(F f) const {
+        for (uint32_t slot : used) f(keys[slot], values[slot]);
+    }
+};
+
+/**
+ * @brief RM3 term selection over forward-index document vectors.
+ *
+ * RM1 estimates P(t|R) = sum_d P(d|Q) * tf(t, d) / |d| over the feedback
+ * documents, with P(d|Q) their first-pass scores normalized to sum to 1.
+ * Terms in more than maxDfRatio * N documents carry no topical signal and
+ * are skipped. The `terms` heaviest are renormalized and mixed with the
+ * original query (each occurrence weighing 1 / |Q|):
+ *     w(t) = lambda * P(t|Q) + (1 - lambda) * P(t|R)
+*/
+class RelevanceModel {
+public:
+    static std::vector<FeedbackTerm> expand(const ForwardIndex& forward,
+                                            const std::vector<std::string>& queryTerms,
+                                            const std::vector<DocVector>& docs,
+                                            const std::vector<double>& scores,
+                                            const FeedbackOptions& options,
+                                            TermAccumulator& accumulator,
+                                            FeedbackStats& stats) {
+        double scoreSum = 0.0;
+        for (double s : scores) scoreSum += std::max(s, 0.0);
+        uint64_t maxDf = static_cast<uint64_t>(options.maxDfRatio * forward.documentCount());
+
+        accumulator.reset();
+        for (size_t d = 0; d < docs.size(); d++) {
+            uint64_t length = 0;
+            for (uint32_t tf : docs[d].freqs) length += tf;
+            if (length == 0 || scoreSum <= 0.0) continue;
+            double docWeight = std::max(scores[d], 0.0) / scoreSum / static_cast<double>(length);
+            for (size_t i = 0; i < docs[d].termIDs.size(); i++) {
+                uint32_t termID = docs[d].termIDs[i];
+                if (forward.df(termID) > maxDf) continue;
+                accumulator.add(termID, docWeight * docs[d].freqs[i]);
+            }
+        }
+        stats.candidates = accumulator.size();
+        stats.dropped = accumulator.dropped();
+
+        std::vector<std::pair<double, uint32_t>> ranked;
+        ranked.reserve(accumulator.size());
+        accumulator.forEach([&ranked](uint32_t termID, double weight) { ranked.push_back({weight, termID}); });
+        size_t n = std::min<size_t>(ranked.size(), options.terms);
+        std::partial_sort(ranked.begin(), ranked.begin() + n, ranked.end(),
+                          [](const auto& a, const auto& b) {
+                              return a.first != b.first ? a.first > b.first : a.second < b.second;
+                          });
+        double selectedSum = 0.0;
+        for (size_t i = 0; i < n; i++) selectedSum += ranked[i].first;
+
+        std::unordered_map<std::string, double> weights;
+        std::vector<std::string> order;   // first appearance, for a stable result
+        double lambda = std::min(std::max(options.originalWeight, 0.0), 1.0);
+        for (const auto& term : queryTerms) {
+            if (weights.emplace(term, 0.0).second) order.push_back(term);
+            weights[term] += lambda / queryTerms.size();
+        }
+        for (size_t i = 0; i < n && selectedSum > 0.0; i++) {
+            const std::string& term = forward.term(ranked[i].second);
+            if (weights.emplace(term, 0.0).second) order.push_back(term);
+            weights[term] += (1.0 - lambda) * ranked[i].first / selectedSum;
+        }
+
+        std::vector<FeedbackTerm> expanded;
+        for (const auto& term : order) {
+            if (weights[term] > 0.0) expanded.push_back({term, weights[term]});
+        }
+        std::stable_sort(expanded.begin(), expanded.end(),
+                         [](const FeedbackTerm& a, const FeedbackTerm& b) { return a.weight > b.weight; });
+        return expanded;
+    }
+};
+
+#endif // FEEDBACK_HPP
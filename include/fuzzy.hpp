@@ -0,0 +1,212 @@
+#ifndef FUZZY_HPP
+#define FUZZY_HPP
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <cstdint>
+#include "index_reader.hpp"
+
+/**
+ * @brief Typo tolerance for query terms missing from the lexicon.
+*/
+struct FuzzyOptions {
+    bool enabled;
+    uint32_t maxDistance;     // edit distance for terms of 5+ characters (1 for 3-4)
+    size_t minLength;         // shorter terms are never corrected
+
+    FuzzyOptions() : enabled(false), maxDistance(2), minLength(3) {}
+};
+
+/**
+ * @brief A replacement for a query term.
+*/
+struct FuzzyMatch {
+    std::string original;
+    std::string term;
+    uint32_t distance;
+    uint32_t df;
+    double lookupMs;
+
+    FuzzyMatch() : distance(0), df(0), lookupMs(0.0) {}
+};
+
+/**
+ * @brief SymSpell-style deletion index over the lexicon.
+ *
+ * Every dictionary term with df >= minDf is stored under the hashes of all
+ * strings obtained by deleting up to maxDistance characters from its first
+ * PREFIX characters (at most 29 keys per term for distance 2). A query
+ * generates the same deletions of its own prefix; terms sharing a key are
+ * candidates, verified with the exact (transposition-aware) edit distance on
+ * the whole strings. The best match has the smallest distance, then the
+ * highest df. A lookup costs a few dozen binary searches plus the
+ * verifications, independent of the lexicon size.
+ *
+ * Keys and term indexes are kept in two parallel arrays sorted by key
+ * (12 bytes per entry); rare terms are left out (minDf) because they are
+ * mostly typos themselves and would make the index much larger.
+*/
+class FuzzyIndex {
+private:
+    static constexpr size_t PREFIX = 7;
+
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> owners;               // term index per key
+    std::vector<const Lexicon::Entry*> terms;   // indexed terms
+    uint32_t maxDistance;
+    bool built;
+
+    static uint64_t hash(const std::string& s) {
+        // FNV-1a
+        uint64_t h = 1469598103934665603ULL;
+        for (unsigned char c : s) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    // all strings reachable from s by deleting up to `distance` characters (s included)
+    static void deletions(const std::string& s, uint32_t distance, std::vector<std::string>& out) {
+        out.clear();
+        out.push_back(s);
+        size_t level = 0;
+        for (uint32_t d = 0; d < distance; d++) {
+            size_t end = out.size();
+            for (size_t i = level; i < end; i++) {
+                if (out[i].size() <= 1) continue;
+                for (size_t p = 0; p < out[i].size(); p++) {
+                    std::string shorter = out[i];
+                    shorter.erase(p, 1);
+                    out.push_back(std::move(shorter));
+                }
+            }
+            level = end;
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+
+public:
+    FuzzyIndex() : maxDistance(0), built(false) {}
+
+    /**
+     * @brief Index the lexicon terms with df >= minDf.
+     */
+    void build(const Lexicon& lexicon, uint32_t minDf = 3, uint32_t distance = 2) {
+        maxDistance = distance;
+        terms.clear();
+        for (const auto& entry : lexicon.entries()) {
+            if (entry.second.df >= minDf) terms.push_back(&entry);
+        }
+
+        std::vector<std::pair<uint64_t, uint32_t>> entries;
+        std::vector<std::string> dels;
+        for (uint32_t t = 0; t < terms.size(); t++) {
+            const std::string& term = terms[t]->first;
+            deletions(term.substr(0, PREFIX), maxDistance, dels);
+            for (const auto& d : dels) entries.push_back({hash(d), t});
+        }
+        std::sort(entries.begin(), entries.end());
+
+        keys.resize(entries.size());
+        owners.resize(entries.size());
+        for (size_t i = 0; i < entries.size(); i++) {
+            keys[i] = entries[i].first;
+            owners[i] = entries[i].second;
+        }
+        built = true;
+        std::cout << "Built fuzzy index: " << terms.size() << " terms (df >= " << minDf << "), "
+                  << keys.size() << " keys" << std::endl;
+    }
+
+    bool available() const { return built; }
+
+    static uint32_t allowedDistance(size_t length, const FuzzyOptions& options) {
+        if (length < options.minLength) return 0;
+        return length <= 4 ? std::min<uint32_t>(1, options.maxDistance) : options.maxDistance;
+    }
+
+    // DP rows reused across distance() calls
+    struct Rows {
+        std::vector<uint32_t> prev2, prev, cur;
+    };
+
+    /**
+     * @brief Optimal string alignment distance (adjacent transpositions
+     *        count as one edit); returns limit + 1 once it exceeds limit.
+     */
+    static uint32_t distance(const std::string& a, const std::string& b, uint32_t limit, Rows& rows) {
+        size_t n = a.size(), m = b.size();
+        if ((n > m ? n - m : m - n) > limit) return limit + 1;
+        std::vector<uint32_t>& prev2 = rows.prev2;
+        std::vector<uint32_t>& prev = rows.prev;
+        std::vector<uint32_t>& cur = rows.cur;
+        prev2.assign(m + 1, 0);
+        prev.resize(m + 1);
+        cur.resize(m + 1);
+        std::iota(prev.begin(), prev.end(), 0);
+        for (size_t i = 1; i <= n; i++) {
+            cur[0] = static_cast<uint32_t>(i);
+            uint32_t rowMin = cur[0];
+            for (size_t j = 1; j <= m; j++) {
+                uint32_t cost = (a[i - 1] == b[j - 1]) ? 0 : 1;
+                uint32_t v = std::min({prev[j] + 1, cur[j - 1] + 1, prev[j - 1] + cost});
+                if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]) {
+                    v = std::min(v, prev2[j - 2] + 1);
+                }
+                cur[j] = v;
+                rowMin = std::min(rowMin, v);
+            }
+            if (rowMin > limit) return limit + 1;
+            prev2.swap(prev);
+            prev.swap(cur);
+        }
+        return std::min(prev[m], limit + 1);
+    }
+
+    /**
+     * @return false if no indexed term is within the allowed distance.
+     */
+    bool bestMatch(const std::string& query, const FuzzyOptions& options, FuzzyMatch& out) const {
+        auto start = std::chrono::steady_clock::now();
+        uint32_t limit = std::min(allowedDistance(query.size(), options), maxDistance);
+        if (!built || limit == 0) return false;
+
+        std::vector<std::string> dels;
+        deletions(query.substr(0, PREFIX), limit, dels);
+
+        std::vector<uint32_t> candidates;
+        for (const auto& d : dels) {
+            auto range = std::equal_range(keys.begin(), keys.end(), hash(d));
+            for (auto it = range.first; it != range.second; ++it) {
+                candidates.push_back(owners[it - keys.begin()]);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        bool found = false;
+        Rows rows;
+        for (uint32_t c : candidates) {
+            const std::string& term = terms[c]->first;
+            uint32_t df = terms[c]->second.df;
+            uint32_t d = distance(query, term, found ? out.distance : limit, rows);
+            if (d == 0 || d > limit) continue;
+            if (!found || d < out.distance || (d == out.distance && df > out.df)) {
+                out.original = query;
+                out.term = term;
+                out.distance = d;
+                out.df = df;
+                found = true;
+            }
+        }
+        out.lookupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return found;
+    }
+};
+
+#endif // FUZZY_HPP
@@ -8,7 +8,13 @@
 #include <sstream>
 #include <iostream>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <cmath>
 #include "varbyte.hpp"
+#include "roaring.hpp"
+#include "utils.hpp"
 
 // Term metadata
 struct TermMeta {
@@ -17,15 +23,44 @@ struct TermMeta {
     uint64_t docids_offset;   // offset in postings.docids.bin 
     uint64_t freqs_offset;    // offset in postings.freqs.bin
     uint32_t blocks;          // number of blocks
+    uint64_t skips_offset;    // offset in postings.skips.bin (if hasSkips)
+    bool hasSkips;            // older indexes have no skip table
+    uint64_t positions_offset; // offset in postings.positions.bin (if hasPositions)
+    bool hasPositions;        // index built with positions
+    uint64_t dense_offset;    // Roaring copy in postings.dense.bin (if hasDense)
+    uint64_t dense_bytes;
+    bool hasDense;            // listed in dense.tsv
+    uint32_t idf_df;          // df of the unpruned list (from idf_df.tsv), 0 = df
     
-    TermMeta() : df(0), cf(0), docids_offset(0), freqs_offset(0), blocks(0) {}
+    TermMeta() : df(0), cf(0), docids_offset(0), freqs_offset(0), blocks(0),
+                 skips_offset(0), hasSkips(false), positions_offset(0), hasPositions(false),
+                 dense_offset(0), dense_bytes(0), hasDense(false), idf_df(0) {}
+
+    // df that idf is computed from; differs from df only on a pruned index
+    uint32_t scoringDf() const { return idf_df ? idf_df : df; }
+};
+
+// Skip table entry, one per block (postings.skips.bin)
+// Offsets are relative to the term's docids_offset / freqs_offset.
+struct SkipEntry {
+    uint32_t lastDocID;       // last docID in the block
+    uint32_t docidsOffset;    // block start in postings.docids.bin
+    uint32_t freqsOffset;     // block start in postings.freqs.bin
+    uint32_t maxTF;           // largest tf in the block
 };
 
 // Lexicon: term -> TermMeta
 class Lexicon {
+public:
+    using Entry = std::pair<const std::string, TermMeta>;
+
 private:
     std::unordered_map<std::string, TermMeta> terms;
     
+    // entries in term order, built on the first prefix lookup
+    mutable std::once_flag sortedOnce;
+    mutable std::vector<const Entry*> sorted;
+    
 public:
     bool load(const std::string& path) {
         std::ifstream file(path);
@@ -43,12 +78,47 @@ public:
             TermMeta meta;
             
             if (iss >> term >> meta.df >> meta.cf >> meta.docids_offset >> meta.freqs_offset >> meta.blocks) {
+                // optional 7th/8th columns: skip table and positions offsets
+                if (iss >> meta.skips_offset) meta.hasSkips = true;
+                if (iss >> meta.positions_offset) meta.hasPositions = true;
                 terms[term] = meta;
             }
         }
         
         file.close();
         std::cout << "Loaded " << terms.size() << " terms from lexicon" << std::endl;
+        
+        // dense.tsv next to the lexicon: Roaring copies of the densest lists
+        std::ifstream denseFile(path.substr(0, path.find_last_of('/') + 1) + "dense.tsv");
+        size_t denseCount = 0;
+        while (std::getline(denseFile, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream iss(line);
+            std::string term;
+            uint64_t offset, bytes;
+            auto it = (iss >> term >> offset >> bytes) ? terms.find(term) : terms.end();
+            if (it == terms.end()) continue;
+            it->second.dense_offset = offset;
+            it->second.dense_bytes = bytes;
+            it->second.hasDense = true;
+            denseCount++;
+        }
+        if (denseCount > 0) std::cout << "Dense lists: " << denseCount << " terms" << std::endl;
+        
+        // idf_df.tsv (written by prune): the full-index df of lists it shortened
+        std::ifstream idfFile(path.substr(0, path.find_last_of('/') + 1) + "idf_df.tsv");
+        size_t idfCount = 0;
+        while (std::getline(idfFile, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream iss(line);
+            std::string term;
+            uint32_t df;
+            auto it = (iss >> term >> df) ? terms.find(term) : terms.end();
+            if (it == terms.end() || df < it->second.df) continue;
+            it->second.idf_df = df;
+            idfCount++;
+        }
+        if (idfCount > 0) std::cout << "Pruned lists: " << idfCount << " terms keep their full df" << std::endl;
         return true;
     }
     
@@ -62,6 +132,31 @@ public:
     }
     
     size_t size() const { return terms.size(); }
+    
+    /**
+     * @brief Visit every term starting with prefix, in term order.
+     *        The visitor returns false to stop early.
+     */
+    template <typename Visitor>
+    void forEachPrefix(const std::string& prefix, Visitor visit) const {
+        std::call_once(sortedOnce, [this] {
+            sorted.reserve(terms.size());
+            for (const auto& entry : terms) sorted.push_back(&entry);
+            std::sort(sorted.begin(), sorted.end(),
+                      [](const Entry* a, const Entry* b) { return a->first < b->first; });
+        });
+        
+        auto it = std::lower_bound(sorted.begin(), sorted.end(), prefix,
+                                   [](const Entry* e, const std::string& p) { return e->first < p; });
+        for (; it != sorted.end(); ++it) {
+            const std::string& term = (*it)->first;
+            if (term.compare(0, prefix.size(), prefix) != 0) break;
+            if (!visit(term, (*it)->second)) break;
+        }
+    }
+    
+    // all entries (for offline tools that rewrite the index)
+    const std::unordered_map<std::string, TermMeta>& entries() const { return terms; }
 };
 
 // Collection statistics
@@ -69,8 +164,9 @@ class Stats {
 public:
     uint64_t doc_count;
     double avgdl;
+    bool impacts;        // "scoring impact": tfs are learned impacts, scored by dot product
     
-    Stats() : doc_count(0), avgdl(0.0) {}
+    Stats() : doc_count(0), avgdl(0.0), impacts(false) {}
     
     bool load(const std::string& path) {
         std::ifstream file(path);
@@ -91,11 +187,16 @@ public:
                 iss >> doc_count;
             } else if (key == "avgdl") {
                 iss >> avgdl;
+            } else if (key == "scoring") {
+                std::string scoring;
+                iss >> scoring;
+                impacts = (scoring == "impact");
             }
         }
         
         file.close();
-        std::cout << "Loaded stats: doc_count=" << doc_count << ", avgdl=" << avgdl << std::endl;
+        std::cout << "Loaded stats: doc_count=" << doc_count << ", avgdl=" << avgdl
+                  << (impacts ? ", impact scoring" : "") << std::endl;
         return doc_count > 0;
     }
 };
@@ -197,11 +298,319 @@ public:
     size_t size() const { return lengths.size(); }
 };
 
+/**
+ * @brief Documents a query may return (index docIDs), evaluated inside
+ *        posting-list traversal instead of post-filtering the top-k.
+ *
+ * A conjunction of docID ranges (e.g. the docIDs of one source), an allow
+ * bitmap (explicit IDs, or ranges of a reordered index) and a document length
+ * range. Ranges and the bitmap are skippable: skipTo() jumps over rejected
+ * docIDs, so a PostingList with a filter seeks past whole blocks holding no
+ * accepted document without decoding them. Lengths are checked per candidate.
+*/
+class DocFilter {
+private:
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;   // inclusive, sorted, disjoint
+    std::vector<uint64_t> bits;                          // allow bitmap, empty = no bitmap
+    bool hasBits;
+    const DocLen* docLen;
+    uint32_t minLength;
+    uint32_t maxLength;
+
+    // first set bit >= doc, NONE if there is none
+    uint32_t nextBit(uint32_t doc) const {
+        size_t word = doc / 64;
+        if (word >= bits.size()) return NONE;
+        uint64_t w = bits[word] & (~0ULL << (doc % 64));
+        while (w == 0) {
+            if (++word >= bits.size()) return NONE;
+            w = bits[word];
+        }
+        return static_cast<uint32_t>(word * 64 + ctz64(w));
+    }
+
+    bool lengthAccepts(uint32_t doc) const {
+        if (!docLen) return true;
+        uint32_t len = docLen->len(doc);
+        return len >= minLength && len <= maxLength;
+    }
+
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    DocFilter() : hasBits(false), docLen(nullptr), minLength(0), maxLength(UINT32_MAX) {}
+
+    bool active() const { return !ranges.empty() || hasBits || docLen; }
+
+    void clear() { *this = DocFilter(); }
+
+    // allow [lo, hi]; call normalize() after the last range
+    void addRange(uint32_t lo, uint32_t hi) {
+        if (lo <= hi) ranges.push_back({lo, hi});
+    }
+
+    // sort and merge the ranges
+    void normalize() {
+        std::sort(ranges.begin(), ranges.end());
+        std::vector<std::pair<uint32_t, uint32_t>> merged;
+        for (const auto& r : ranges) {
+            if (!merged.empty() && (merged.back().second == NONE || r.first <= merged.back().second + 1)) {
+                merged.back().second = std::max(merged.back().second, r.second);
+            } else {
+                merged.push_back(r);
+            }
+        }
+        ranges.swap(merged);
+    }
+
+    // intersect with an allow bitmap (bit d set = document d allowed)
+    void restrictTo(const std::vector<uint64_t>& allowed) {
+        if (!hasBits) {
+            bits = allowed;
+            hasBits = true;
+            return;
+        }
+        bits.resize(std::min(bits.size(), allowed.size()));
+        for (size_t i = 0; i < bits.size(); i++) bits[i] &= allowed[i];
+    }
+
+    void setLengthRange(const DocLen* lengths, uint32_t minLen, uint32_t maxLen) {
+        docLen = lengths;
+        minLength = minLen;
+        maxLength = maxLen;
+    }
+
+    /**
+     * @brief First docID >= target allowed by the ranges and the bitmap,
+     *        NONE if there is none. Lengths are not checked (see accepts()).
+     */
+    uint32_t skipTo(uint32_t target) const {
+        uint32_t doc = target;
+        while (true) {
+            if (!ranges.empty()) {
+                auto it = std::lower_bound(ranges.begin(), ranges.end(), doc,
+                                           [](const std::pair<uint32_t, uint32_t>& r, uint32_t d) { return r.second < d; });
+                if (it == ranges.end()) return NONE;
+                doc = std::max(doc, it->first);
+            }
+            if (!hasBits) return doc;
+            uint32_t next = nextBit(doc);
+            if (next == doc || next == NONE) return next;
+            doc = next;   // re-check the ranges
+        }
+    }
+
+    bool accepts(uint32_t doc) const {
+        return skipTo(doc) == doc && lengthAccepts(doc);
+    }
+};
+
+/**
+ * @brief Static document priors and the docID order they induced.
+ *
+ * Written by the reorder tool: doc_order.bin maps each index docID to the
+ * indexer's original internal docID (so doc table / content lookups keep
+ * working), and doc_prior.bin holds one float prior per index docID. Both
+ * files are optional; without them docIDs are used as is and priors are 0.
+*/
+class DocPriors {
+private:
+    std::vector<uint32_t> order;   // index docID -> indexer docID
+    std::vector<uint32_t> inverse; // indexer docID -> index docID
+    std::vector<float> priors;     // index docID -> static prior
+    
+    template <typename T>
+    static bool loadArray(const std::string& path, std::vector<T>& out) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) return false;
+        
+        file.seekg(0, std::ios::end);
+        size_t count = static_cast<size_t>(file.tellg()) / sizeof(T);
+        file.seekg(0, std::ios::beg);
+        out.resize(count);
+        file.read(reinterpret_cast<char*>(out.data()), count * sizeof(T));
+        return static_cast<bool>(file);
+    }
+    
+public:
+    // load from an index directory; returns false if the index was not reordered
+    bool load(const std::string& indexDir) {
+        bool hasOrder = loadArray(indexDir + "/doc_order.bin", order);
+        bool hasPriors = loadArray(indexDir + "/doc_prior.bin", priors);
+        inverse.assign(order.size(), 0);
+        for (uint32_t i = 0; i < order.size(); i++) {
+            if (order[i] < inverse.size()) inverse[order[i]] = i;
+        }
+        if (hasOrder || hasPriors) {
+            std::cout << "Loaded static priors for " << priors.size() << " documents"
+                      << (hasOrder ? " (prior-ordered docIDs)" : "") << std::endl;
+        }
+        return hasOrder;
+    }
+    
+    bool reordered() const { return !order.empty(); }
+    bool hasPriors() const { return !priors.empty(); }
+    
+    // index docID -> indexer docID
+    uint32_t toExternal(uint32_t docID) const {
+        return docID < order.size() ? order[docID] : docID;
+    }
+    
+    // indexer docID -> index docID
+    uint32_t toInternal(uint32_t docID) const {
+        return docID < inverse.size() ? inverse[docID] : docID;
+    }
+    
+    float prior(uint32_t docID) const {
+        return docID < priors.size() ? priors[docID] : 0.0f;
+    }
+};
+
+/**
+ * @brief High-impact tier of an index (optional, written by merger --tiers=N).
+ *
+ * For every term whose list is longer than N, tier1/ holds the N postings with
+ * the highest BM25 impact (docID-sorted, same on-disk format as the full index)
+ * and tier1/tiers.tsv records the largest impact left in the tail. Impacts were
+ * computed with the k1/b stored in the tiers.tsv header, so the tier is only
+ * usable for queries scored with the same parameters.
+*/
+class TierIndex {
+private:
+    std::string tierDir;
+    Lexicon lexicon;
+    std::unordered_map<std::string, double> tailMax;
+    double k1;
+    double b;
+    bool loaded;
+    
+public:
+    TierIndex() : k1(0.0), b(0.0), loaded(false) {}
+    
+    // load from an index directory; returns false if the index has no tier
+    bool load(const std::string& indexDir) {
+        tierDir = indexDir + "/tier1";
+        std::ifstream file(tierDir + "/tiers.tsv");
+        if (!file.is_open()) return false;
+        
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty()) continue;
+            std::istringstream iss(line);
+            if (line[0] == '#') {
+                std::string hash, key;
+                double value;
+                if (iss >> hash >> key >> value) {
+                    if (key == "k1") k1 = value;
+                    else if (key == "b") b = value;
+                }
+                continue;
+            }
+            std::string term;
+            double maxImpact;
+            if (iss >> term >> maxImpact) tailMax[term] = maxImpact;
+        }
+        
+        if (!lexicon.load(tierDir + "/lexicon.tsv")) return false;
+        loaded = true;
+        std::cout << "Loaded tier 1 for " << lexicon.size() << " terms (k1=" << k1
+                  << ", b=" << b << ")" << std::endl;
+        return true;
+    }
+    
+    bool available() const { return loaded; }
+    const std::string& directory() const { return tierDir; }
+    
+    // tier was built for these scoring parameters
+    bool matches(double queryK1, double queryB) const {
+        return loaded && std::abs(queryK1 - k1) < 1e-9 && std::abs(queryB - b) < 1e-9;
+    }
+    
+    // tier-1 list and tail bound of a term; false if the term is not tiered
+    bool find(const std::string& term, TermMeta& meta, double& tailBound) const {
+        auto it = tailMax.find(term);
+        if (it == tailMax.end() || !lexicon.find(term, meta)) return false;
+        tailBound = it->second;
+        return true;
+    }
+};
+
+/**
+ * @brief Precomputed intersections of frequent term pairs (built by pair_builder).
+ *
+ * pairs/ holds an ordinary block index whose "terms" are pair keys (a|b with
+ * a < b) and whose lists are the documents containing both terms; each
+ * posting's freq packs both tfs as (tf_a << 16) | tf_b. pair_builder does
+ * not build a pair whose tfs would not fit in 16 bits (MAX_TF), so pair lists
+ * score exactly like the intersection of the plain lists.
+ * pairs/pairs.tsv lists the pairs with the count they were selected by.
+*/
+class PairIndex {
+private:
+    std::string pairDir;
+    Lexicon lexicon;
+    bool loaded;
+
+public:
+    static constexpr uint32_t MAX_TF = 0xFFFF;
+
+    PairIndex() : loaded(false) {}
+
+    // load from an index directory; returns false if the index has no pairs
+    bool load(const std::string& indexDir) {
+        pairDir = indexDir + "/pairs";
+        std::ifstream file(pairDir + "/pairs.tsv");
+        if (!file.is_open()) return false;
+        if (!lexicon.load(pairDir + "/lexicon.tsv")) return false;
+        loaded = true;
+        std::cout << "Loaded pair lists for " << lexicon.size() << " term pairs" << std::endl;
+        return true;
+    }
+
+    bool available() const { return loaded; }
+    const std::string& directory() const { return pairDir; }
+
+    static std::string key(const std::string& a, const std::string& b) {
+        return a < b ? a + "|" + b : b + "|" + a;
+    }
+
+    static uint32_t pack(uint32_t tfFirst, uint32_t tfSecond) {
+        return (std::min(tfFirst, MAX_TF) << 16) | std::min(tfSecond, MAX_TF);
+    }
+
+    // tfs of the smaller / larger term of the key
+    static uint32_t firstTf(uint32_t packed) { return packed >> 16; }
+    static uint32_t secondTf(uint32_t packed) { return packed & MAX_TF; }
+
+    // pair list of two terms (in either order); false if the pair was not built
+    bool find(const std::string& a, const std::string& b, TermMeta& meta) const {
+        return loaded && a != b && lexicon.find(key(a, b), meta);
+    }
+};
+
+/**
+ * @brief A fully decoded posting list held in memory.
+ *
+ * Used when the same list is traversed by several queries (e.g. a batch),
+ * so the blocks are decoded once and shared read-only.
+*/
+struct DecodedPostings {
+    std::vector<uint32_t> docIDs;
+    std::vector<uint32_t> freqs;
+};
+
 /**
  * @brief Represents a posting list for a specific term.
  * 
  * Provides sequential access to compressed posting data (docIDs and term frequencies).
  * Implements local decoding rather than decompressing entire lists at once.
+ * When the index has a skip table, nextGEQ() jumps over whole blocks without
+ * decoding them (the table is read lazily on the first jump).
+ * Positions are only read when positions() is called, one block at a time.
+ * Terms with a Roaring copy (dense.tsv, non-positional indexes) are served
+ * from it instead of the blocks.
+ * With a DocFilter, next() and nextGEQ() only stop at accepted documents and
+ * seek past rejected docID ranges through the skip table.
 */
 class PostingList {
 private:
@@ -210,7 +619,7 @@ private:
     
     // block state
     uint32_t totalBlocks;
-    uint32_t currentBlock;
+    uint32_t currentBlock;    // number of the next block to load
     uint32_t blockLen;
     uint32_t blockPos;
     
@@ -223,6 +632,36 @@ private:
     std::vector<uint32_t> docIDsBuffer;
     std::vector<uint32_t> freqsBuffer;
     
+    bool withFreqs;           // false: tfs are not read (count-only traversal, freq() == 0)
+    
+    // current block data: points into the buffers above or into shared postings
+    const uint32_t* blockDocIDs;
+    const uint32_t* blockFreqs;
+    std::shared_ptr<const DecodedPostings> shared;
+    
+    // Roaring copy of a dense term (replaces the blocks when set)
+    std::shared_ptr<const RoaringPostings> dense;
+    RoaringCursor denseCursor;
+    
+    // skip table (loaded on first use)
+    TermMeta meta;
+    std::string skipsPath;
+    std::vector<SkipEntry> skips;
+    bool skipsLoaded;
+    uint32_t shallowBlock;    // block of the last blockMax() target
+    uint32_t listMaxFreq;     // 0 = not computed yet
+    
+    const DocFilter* filter;  // postings the filter rejects are skipped (nullptr: none)
+    
+    // positions (loaded on first use)
+    std::string positionsPath;
+    std::ifstream positionsFile;
+    std::vector<uint32_t> positionOffsets;     // block data offsets (blocks + 1)
+    std::vector<unsigned char> positionBytes;  // positions of the loaded block
+    uint32_t positionsBlock;                   // block held in positionBytes
+    uint32_t positionsCursor;                  // posting index at positionsByte
+    size_t positionsByte;
+    
     // load next block
     bool loadNextBlock() {
         if (currentBlock >= totalBlocks) {
@@ -248,6 +687,15 @@ private:
             prevDocID = docID;
         }
         
+        if (!withFreqs) {
+            freqsBuffer.assign(blockLen, 0);
+            blockDocIDs = docIDsBuffer.data();
+            blockFreqs = freqsBuffer.data();
+            blockPos = 0;
+            currentBlock++;
+            return true;
+        }
+        
         // load freqs block
         uint32_t blockLenFreq = varbyte::decode(freqsFile);
         if (blockLenFreq != blockLen) {
@@ -262,28 +710,143 @@ private:
             freqsBuffer.push_back(varbyte::decode(freqsFile));
         }
         
+        blockDocIDs = docIDsBuffer.data();
+        blockFreqs = freqsBuffer.data();
         blockPos = 0;
         currentBlock++;
         return true;
     }
     
+    bool loadSkips() {
+        skipsLoaded = true;
+        if (!meta.hasSkips || skipsPath.empty()) return false;
+        
+        std::ifstream skipsFile(skipsPath, std::ios::binary);
+        if (!skipsFile.is_open()) return false;
+        
+        skips.resize(totalBlocks);
+        skipsFile.seekg(meta.skips_offset);
+        skipsFile.read(reinterpret_cast<char*>(skips.data()), totalBlocks * sizeof(SkipEntry));
+        if (!skipsFile) skips.clear();
+        return !skips.empty();
+    }
+    
+    // copy the dense cursor's posting into the current state
+    bool syncDense(bool ok) {
+        hasMore = ok;
+        if (ok) {
+            currentDocID = denseCursor.doc();
+            currentFreq = denseCursor.freq();
+        }
+        return ok;
+    }
+    
+    // position the streams at block b and decode it
+    bool seekBlock(uint32_t b) {
+        docidsFile.clear();
+        freqsFile.clear();
+        docidsFile.seekg(meta.docids_offset + skips[b].docidsOffset);
+        freqsFile.seekg(meta.freqs_offset + skips[b].freqsOffset);
+        currentBlock = b;
+        return loadNextBlock();
+    }
+    
 public:
     PostingList() 
         : totalBlocks(0), currentBlock(0), blockLen(0), blockPos(0),
-          currentDocID(0), currentFreq(0), hasMore(false) {}
+          currentDocID(0), currentFreq(0), hasMore(false), withFreqs(true),
+          blockDocIDs(nullptr), blockFreqs(nullptr), skipsLoaded(false), shallowBlock(0), listMaxFreq(0),
+          filter(nullptr), positionsBlock(UINT32_MAX), positionsCursor(0), positionsByte(0) {}
+    
+    // move keeps the block pointers valid (vector buffers are transferred)
+    PostingList(PostingList&& other) = default;
+    PostingList& operator=(PostingList&& other) = default;
+    
+    /**
+     * @brief Decode an entire posting list into memory.
+     *
+     * With `positions`, the positions of every posting are appended to it
+     * (freq values per posting, as IndexWriter takes them); the list must
+     * then come from a positional index.
+     * @return nullptr if the list (or its positions) cannot be read.
+     */
+    static std::shared_ptr<DecodedPostings> decodeAll(const TermMeta& meta, const std::string& indexDir,
+                                                      std::vector<uint32_t>* positions = nullptr) {
+        PostingList list;
+        if (!list.open(meta, indexDir)) return nullptr;
+        
+        auto decoded = std::make_shared<DecodedPostings>();
+        decoded->docIDs.reserve(meta.df);
+        decoded->freqs.reserve(meta.df);
+        std::vector<uint32_t> current;
+        do {
+            decoded->docIDs.push_back(list.doc());
+            decoded->freqs.push_back(list.freq());
+            if (positions) {
+                if (!list.positions(current) || current.size() != list.freq()) return nullptr;
+                positions->insert(positions->end(), current.begin(), current.end());
+            }
+        } while (list.next());
+        return decoded;
+    }
+    
+    // open posting list over already decoded postings (no file access)
+    bool open(std::shared_ptr<const DecodedPostings> postings) {
+        shared = std::move(postings);
+        filter = nullptr;
+        if (!shared || shared->docIDs.empty()) {
+            hasMore = false;
+            return false;
+        }
+        
+        // expose the whole list as a single block
+        totalBlocks = 0;
+        currentBlock = 0;
+        blockLen = static_cast<uint32_t>(shared->docIDs.size());
+        blockPos = 0;
+        blockDocIDs = shared->docIDs.data();
+        blockFreqs = shared->freqs.data();
+        skipsLoaded = true;
+        skips.clear();
+        shallowBlock = 0;
+        listMaxFreq = 0;
+        
+        currentDocID = blockDocIDs[0];
+        currentFreq = blockFreqs[0];
+        hasMore = true;
+        return true;
+    }
     
-    // open posting list for a term
-    bool open(const TermMeta& meta, const std::string& indexDir) {
+    // open posting list for a term; with readFreqs == false only docIDs are decoded
+    bool open(const TermMeta& termMeta, const std::string& indexDir, bool readFreqs = true) {
+        withFreqs = readFreqs;
+        filter = nullptr;
+        shallowBlock = 0;
+        listMaxFreq = 0;
+        if (termMeta.hasDense && !termMeta.hasPositions) {
+            meta = termMeta;
+            skipsPath = indexDir + "/postings.skips.bin";   // block maxima of the same postings
+            skipsLoaded = false;
+            totalBlocks = meta.blocks;
+            dense = RoaringPostings::load(indexDir + "/postings.dense.bin", meta.dense_offset, meta.dense_bytes);
+            if (dense) return syncDense(denseCursor.open(dense.get()));
+            std::cerr << "Failed to read dense list, using blocks\n";
+        }
+        
         std::string docPath = indexDir + "/postings.docids.bin";
         std::string freqPath = indexDir + "/postings.freqs.bin";
 
         docidsFile.open(docPath, std::ios::binary);
-        freqsFile.open(freqPath, std::ios::binary);
-        if (!docidsFile.is_open() || !freqsFile.is_open()) {
+        if (withFreqs) freqsFile.open(freqPath, std::ios::binary);
+        if (!docidsFile.is_open() || (withFreqs && !freqsFile.is_open())) {
             std::cerr << "Failed to open posting list files\n";
             return false;
         }
 
+        meta = termMeta;
+        skipsPath = indexDir + "/postings.skips.bin";
+        positionsPath = indexDir + "/postings.positions.bin";
+        skipsLoaded = false;
         totalBlocks = meta.blocks;
         currentBlock = 0;
         
@@ -300,8 +863,8 @@ public:
         
         // initialize current docID and freq
         if (blockLen > 0) {
-            currentDocID = docIDsBuffer[0];
-            currentFreq = freqsBuffer[0];
+            currentDocID = blockDocIDs[0];
+            currentFreq = blockFreqs[0];
             return true;
         }
         
@@ -309,23 +872,67 @@ public:
         return false;
     }
     
+    /**
+     * @brief Only stop at postings of documents the filter accepts
+     *        (nullptr: all). Call after open(); the list moves to the first
+     *        accepted posting. The filter must outlive the traversal.
+     */
+    void setFilter(const DocFilter* docFilter) {
+        filter = (docFilter && docFilter->active()) ? docFilter : nullptr;
+        settle();
+    }
+    
     // move to next document
     bool next() {
+        return advance() && settle();
+    }
+    
+    // move to first docID >= target
+    bool nextGEQ(uint32_t target) {
         if (!hasMore) return false;
+        if (currentDocID >= target) return true;
+        if (filter) {
+            target = filter->skipTo(target);
+            if (target == DocFilter::NONE) {
+                hasMore = false;
+                return false;
+            }
+        }
+        return advanceTo(target) && settle();
+    }
+    
+private:
+    // step past postings the filter rejects; false once the list is exhausted
+    bool settle() {
+        if (!filter) return hasMore;
+        while (hasMore && !filter->accepts(currentDocID)) {
+            uint32_t target = currentDocID == UINT32_MAX ? DocFilter::NONE : filter->skipTo(currentDocID + 1);
+            if (target == DocFilter::NONE) {
+                hasMore = false;
+                break;
+            }
+            advanceTo(target);
+        }
+        return hasMore;
+    }
+    
+    bool advance() {
+        if (!hasMore) return false;
+        if (dense) return syncDense(denseCursor.next());
         
         blockPos++;
         
         // if still within current block
         if (blockPos < blockLen) {
-            currentDocID = docIDsBuffer[blockPos];
-            currentFreq = freqsBuffer[blockPos];
+            currentDocID = blockDocIDs[blockPos];
+            currentFreq = blockFreqs[blockPos];
             return true;
         }
         
         // load next block
         if (loadNextBlock() && blockLen > 0) {
-            currentDocID = docIDsBuffer[0];
-            currentFreq = freqsBuffer[0];
+            currentDocID = blockDocIDs[0];
+            currentFreq = blockFreqs[0];
             return true;
         }
         
@@ -333,14 +940,141 @@ public:
         return false;
     }
     
-    // move to first docID >= target
-    bool nextGEQ(uint32_t target) {
-        while (hasMore && currentDocID < target) {
-            if (!next()) {
+    bool advanceTo(uint32_t target) {
+        if (!hasMore) return false;
+        if (currentDocID >= target) return true;
+        if (dense) return syncDense(denseCursor.nextGEQ(target));
+        
+        // target beyond the current block: skip whole blocks
+        if (blockDocIDs[blockLen - 1] < target) {
+            if (currentBlock >= totalBlocks) {
+                hasMore = false;
                 return false;
             }
+            if ((skipsLoaded || loadSkips()) && !skips.empty()) {
+                auto it = std::lower_bound(skips.begin() + currentBlock, skips.end(), target,
+                                           [](const SkipEntry& e, uint32_t t) { return e.lastDocID < t; });
+                if (it == skips.end()) {
+                    hasMore = false;
+                    return false;
+                }
+                uint32_t b = static_cast<uint32_t>(it - skips.begin());
+                bool loaded = (b == currentBlock) ? loadNextBlock() : seekBlock(b);
+                if (!loaded || blockLen == 0) {
+                    hasMore = false;
+                    return false;
+                }
+            } else {
+                // no skip table: decode blocks sequentially
+                do {
+                    if (!loadNextBlock() || blockLen == 0) {
+                        hasMore = false;
+                        return false;
+                    }
+                } while (blockDocIDs[blockLen - 1] < target);
+            }
+        }
+        
+        // binary search within the current block
+        const uint32_t* pos = std::lower_bound(blockDocIDs + blockPos, blockDocIDs + blockLen, target);
+        blockPos = static_cast<uint32_t>(pos - blockDocIDs);
+        currentDocID = blockDocIDs[blockPos];
+        currentFreq = blockFreqs[blockPos];
+        return true;
+    }
+    
+public:
+    /**
+     * @brief Largest freq in the block holding the first posting >= target,
+     *        read from the skip table without decoding (shallow move);
+     *        lastDoc is that block's last docID. Lists without a skip table
+     *        (decoded or old lists) report maxFreq() for the whole list and
+     *        lastDoc = UINT32_MAX, as do targets behind the last posting
+     *        (with 0). Targets are expected in ascending order.
+     */
+    uint32_t blockMax(uint32_t target, uint32_t& lastDoc) {
+        lastDoc = UINT32_MAX;
+        if (!(skipsLoaded || loadSkips()) || skips.empty()) return maxFreq();
+        if (shallowBlock >= skips.size() || (shallowBlock > 0 && skips[shallowBlock - 1].lastDocID >= target)) {
+            shallowBlock = 0;
+        }
+        auto it = std::lower_bound(skips.begin() + shallowBlock, skips.end(), target,
+                                   [](const SkipEntry& e, uint32_t t) { return e.lastDocID < t; });
+        shallowBlock = static_cast<uint32_t>(it - skips.begin());
+        if (it == skips.end()) return 0;
+        lastDoc = it->lastDocID;
+        return it->maxTF;
+    }
+    
+    // largest freq in the list
+    uint32_t maxFreq() {
+        if (listMaxFreq > 0) return listMaxFreq;
+        if ((skipsLoaded || loadSkips()) && !skips.empty()) {
+            for (const auto& e : skips) listMaxFreq = std::max(listMaxFreq, e.maxTF);
+        } else if (shared) {
+            listMaxFreq = *std::max_element(shared->freqs.begin(), shared->freqs.end());
+        } else {
+            listMaxFreq = UINT32_MAX;   // no bound known
+        }
+        return listMaxFreq;
+    }
+    
+    // whether positions() is available (file-backed list of a positional index)
+    bool hasPositions() const { return meta.hasPositions && !shared && !dense; }
+    
+    /**
+     * @brief Positions of the current posting (ascending).
+     * @return false if the index has no positions or the read fails.
+     */
+    bool positions(std::vector<uint32_t>& out) {
+        out.clear();
+        if (!hasMore || !hasPositions() || currentBlock == 0) return false;
+        
+        uint32_t block = currentBlock - 1;
+        if (block != positionsBlock) {
+            if (positionOffsets.empty()) {
+                positionsFile.open(positionsPath, std::ios::binary);
+                if (!positionsFile.is_open()) return false;
+                positionOffsets.resize(totalBlocks + 1);
+                positionsFile.seekg(meta.positions_offset);
+                positionsFile.read(reinterpret_cast<char*>(positionOffsets.data()),
+                                   positionOffsets.size() * sizeof(uint32_t));
+                if (!positionsFile) {
+                    positionOffsets.clear();
+                    return false;
+                }
+            }
+            uint64_t dataStart = meta.positions_offset + positionOffsets.size() * sizeof(uint32_t);
+            positionBytes.resize(positionOffsets[block + 1] - positionOffsets[block]);
+            positionsFile.clear();
+            positionsFile.seekg(dataStart + positionOffsets[block]);
+            positionsFile.read(reinterpret_cast<char*>(positionBytes.data()), positionBytes.size());
+            if (!positionsFile) return false;
+            positionsBlock = block;
+            positionsCursor = 0;
+            positionsByte = 0;
+        }
+        
+        // skip the positions of earlier postings in the block (tf values each)
+        if (blockPos < positionsCursor) {
+            positionsCursor = 0;
+            positionsByte = 0;
+        }
+        while (positionsCursor < blockPos) {
+            for (uint32_t n = blockFreqs[positionsCursor]; n > 0 && positionsByte < positionBytes.size(); ) {
+                if (!(positionBytes[positionsByte++] & 0x80)) n--;
+            }
+            positionsCursor++;
         }
-        return hasMore && currentDocID >= target;
+        
+        const unsigned char* ptr = positionBytes.data() + positionsByte;
+        const unsigned char* end = positionBytes.data() + positionBytes.size();
+        uint32_t pos = 0;
+        for (uint32_t i = 0; i < currentFreq && ptr < end; i++) {
+            pos += varbyte::decode_from_buffer(ptr);
+            out.push_back(pos);
+        }
+        return out.size() == currentFreq;
     }
     
     // current docID
@@ -351,6 +1085,12 @@ public:
     
     // whether there are more documents
     bool valid() const { return hasMore; }
+    
+    // Roaring set of a dense term, nullptr for block lists and filtered lists
+    const RoaringPostings* denseSet() const { return filter ? nullptr : dense.get(); }
+    
+    // document frequency of the underlying list
+    uint32_t size() const { return shared ? static_cast<uint32_t>(shared->docIDs.size()) : meta.df; }
 };
 
 // Document content reader (based on offsets)
@@ -364,6 +1104,7 @@ private:
     std::string contentFilePath;
     std::vector<DocOffset> offsets;
     mutable std::ifstream contentFile;
+    mutable std::mutex readMutex;   // contentFile position is shared between threads
     
 public:
     DocContentFile() {}
@@ -415,6 +1156,7 @@ public:
         }
         
         const DocOffset& doc = offsets[docID];
+        std::lock_guard<std::mutex> lock(readMutex);
         
         // Seek to document position
         contentFile.seekg(doc.offset);
@@ -450,6 +1192,7 @@ public:
                  });
         
         // read documents in sorted order
+        std::lock_guard<std::mutex> lock(readMutex);
         for (const auto& [docID, doc] : sorted) {
             contentFile.seekg(doc.offset);
             std::string content(doc.length, '\0');
@@ -463,6 +1206,158 @@ public:
     size_t size() const { return offsets.size(); }
 };
 
+// Term vector of one document (forward index)
+struct DocVector {
+    uint32_t docID = 0;
+    std::vector<uint32_t> termIDs;   // ascending
+    std::vector<uint32_t> freqs;     // parallel to termIDs
+};
+
+/**
+ * ForwardIndex: reads the term vectors written by ForwardIndexWriter
+ *
+ * The term table and the block offsets are loaded into memory; documents are
+ * read from forward.bin one block (BLOCK_DOCS documents) at a time. getBatch
+ * reads every block a batch touches once, in file order. Term IDs number the
+ * terms in lexicon order (forward.terms.tsv). reorder rewrites it under the
+ * new docIDs; prune copies it, as pruning leaves the documents unchanged.
+ */
+class ForwardIndex {
+private:
+    std::vector<std::string> terms;       // term ID -> term
+    std::vector<uint32_t> dfs;            // term ID -> df
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<uint64_t> blockOffsets;   // block -> offset in forward.bin, then the end offset
+    uint64_t docCount = 0;
+    uint32_t blockDocs = 0;
+    mutable std::ifstream dataFile;
+    mutable std::mutex readMutex;         // dataFile position is shared between threads
+
+    // decode the document at ptr and advance past it
+    static void decodeDoc(const unsigned char*& ptr, DocVector& out) {
+        uint32_t n = varbyte::decode_from_buffer(ptr);
+        out.termIDs.resize(n);
+        out.freqs.resize(n);
+        uint32_t termID = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            termID += varbyte::decode_from_buffer(ptr);
+            out.termIDs[i] = termID;
+        }
+        for (uint32_t i = 0; i < n; i++) out.freqs[i] = varbyte::decode_from_buffer(ptr);
+    }
+
+    static void skipDoc(const unsigned char*& ptr) {
+        uint32_t n = varbyte::decode_from_buffer(ptr);
+        for (uint32_t i = 0; i < 2 * n; i++) {
+            while (*ptr++ & 0x80) {}
+        }
+    }
+
+    // caller holds readMutex
+    void readBlock(size_t block, std::vector<unsigned char>& bytes) const {
+        uint64_t begin = blockOffsets[block];
+        bytes.resize(blockOffsets[block + 1] - begin);
+        dataFile.seekg(begin);
+        dataFile.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+    }
+
+public:
+    // load from an index directory; returns false if it has no forward index
+    bool load(const std::string& indexDir) {
+        std::ifstream blocksFile(indexDir + "/forward.blocks.bin", std::ios::binary);
+        if (!blocksFile.is_open()) return false;
+        blocksFile.read(reinterpret_cast<char*>(&docCount), sizeof(docCount));
+        blocksFile.read(reinterpret_cast<char*>(&blockDocs), sizeof(blockDocs));
+        uint64_t offset;
+        while (blocksFile.read(reinterpret_cast<char*>(&offset), sizeof(offset))) blockOffsets.push_back(offset);
+        if (blockDocs == 0 || blockOffsets.size() != (docCount + blockDocs - 1) / blockDocs + 1) {
+            std::cerr << "Corrupt forward index: " << indexDir << "/forward.blocks.bin" << std::endl;
+            blockOffsets.clear();
+            return false;
+        }
+
+        std::ifstream termsFile(indexDir + "/forward.terms.tsv");
+        std::string line;
+        while (std::getline(termsFile, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            size_t tab = line.find('\t');
+            ids[line.substr(0, tab)] = static_cast<uint32_t>(terms.size());
+            terms.push_back(line.substr(0, tab));
+            dfs.push_back(tab == std::string::npos ? 0 : static_cast<uint32_t>(std::stoul(line.substr(tab + 1))));
+        }
+
+        dataFile.open(indexDir + "/forward.bin", std::ios::binary);
+        if (!dataFile.is_open()) {
+            std::cerr << "Cannot open forward index: " << indexDir << "/forward.bin" << std::endl;
+            blockOffsets.clear();
+            return false;
+        }
+        std::cout << "Loaded forward index: " << docCount << " documents, " << terms.size() << " terms" << std::endl;
+        return true;
+    }
+
+    bool loaded() const { return !blockOffsets.empty(); }
+    uint64_t documentCount() const { return docCount; }
+    size_t termCount() const { return terms.size(); }
+
+    const std::string& term(uint32_t termID) const { return terms[termID]; }
+    uint32_t df(uint32_t termID) const { return dfs[termID]; }
+
+    bool termID(const std::string& term, uint32_t& out) const {
+        auto it = ids.find(term);
+        if (it == ids.end()) return false;
+        out = it->second;
+        return true;
+    }
+
+    // term vector of one document; false if docID is out of range
+    bool get(uint32_t docID, DocVector& out) const {
+        std::vector<DocVector> batch = getBatch({docID});
+        out = std::move(batch[0]);
+        return docID < docCount;
+    }
+
+    /**
+     * Term vectors of docIDs, in the same order (documents out of range get
+     * empty vectors)
+     */
+    std::vector<DocVector> getBatch(const std::vector<uint32_t>& docIDs) const {
+        std::vector<DocVector> out(docIDs.size());
+        std::vector<uint32_t> order;
+        for (uint32_t i = 0; i < docIDs.size(); i++) {
+            out[i].docID = docIDs[i];
+            if (docIDs[i] < docCount) order.push_back(i);
+        }
+        if (order.empty()) return out;
+        std::sort(order.begin(), order.end(),
+                  [&docIDs](uint32_t a, uint32_t b) { return docIDs[a] < docIDs[b]; });
+
+        std::vector<unsigned char> bytes;
+        size_t currentBlock = SIZE_MAX;
+        const unsigned char* ptr = nullptr;
+        uint32_t slot = 0;   // document of currentBlock that ptr points at
+        std::lock_guard<std::mutex> lock(readMutex);
+        for (size_t i = 0; i < order.size(); i++) {
+            uint32_t docID = docIDs[order[i]];
+            if (i > 0 && docIDs[order[i - 1]] == docID) {
+                out[order[i]] = out[order[i - 1]];
+                continue;
+            }
+            size_t block = docID / blockDocs;
+            if (block != currentBlock) {
+                readBlock(block, bytes);
+                currentBlock = block;
+                ptr = bytes.data();
+                slot = 0;
+            }
+            for (; slot < docID % blockDocs; slot++) skipDoc(ptr);
+            decodeDoc(ptr, out[order[i]]);
+            slot++;
+        }
+        return out;
+    }
+};
+
 
 #endif // INDEX_READER_HPP
 
@@ -0,0 +1,544 @@
+#ifndef INDEX_WRITER_HPP
+#define INDEX_WRITER_HPP
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include "varbyte.hpp"
+#include "index_reader.hpp"
+
+/**
+ * IndexWriter: writes a block-compressed inverted index
+ *
+ * Shared by the merger (Phase 2) and the offline tools that rewrite an
+ * existing index. Produces:
+ * - postings.docids.bin: block_len + gap-encoded docIDs (VarByte)
+ * - postings.freqs.bin:  block_len + tfs (VarByte)
+ * - postings.skips.bin:  one SkipEntry per block (last docID, block offsets, max tf)
+ * - postings.positions.bin (optional): per term, a table of block offsets
+ *   followed by delta-encoded positions of every posting, block-aligned
+ * - lexicon.tsv:         term, df, cf, offsets, block count, skips offset
+ *                        [, positions offset]
+ * - doc_len.bin / stats.txt: document lengths and collection statistics
+ */
+class IndexWriter {
+public:
+    // Block size for compression (number of postings per block)
+    static constexpr size_t BLOCK_SIZE = 128;
+
+    // Posting structure for in-memory representation
+    struct Posting {
+        uint32_t docID;
+        uint32_t frequency;
+
+        Posting(uint32_t d, uint32_t f) : docID(d), frequency(f) {}
+    };
+
+private:
+    std::string outputDir;      // Output directory for index files
+
+    // Output file streams
+    std::ofstream docIdsFile;   // Block-compressed docIDs
+    std::ofstream freqsFile;    // Block-compressed frequencies
+    std::ofstream skipsFile;    // Per-block skip entries
+    std::ofstream lexiconFile;  // Term dictionary (text format for debugging)
+    std::ofstream positionsFile;  // Optional term positions
+    bool headerWritten;
+    std::vector<unsigned char> positionBytes;  // encoded positions of the current term
+    bool impactScoring;         // tfs are learned impacts (stats.txt: scoring impact)
+
+    // Statistics accumulators
+    uint64_t totalTerms;        // Total number of unique terms
+    uint64_t totalPostings;     // Total number of postings
+    uint64_t docCount;          // Total number of documents
+    std::vector<uint32_t> docLengths;  // Document lengths for BM25 avgdl
+
+public:
+    explicit IndexWriter(const std::string& outDir)
+        : outputDir(outDir), headerWritten(false), impactScoring(false), totalTerms(0), totalPostings(0),
+          docCount(0) {
+
+        std::filesystem::create_directories(outputDir);
+
+        docIdsFile.open(outputDir + "/postings.docids.bin",
+                        std::ios::out | std::ios::binary);
+        freqsFile.open(outputDir + "/postings.freqs.bin",
+                       std::ios::out | std::ios::binary);
+        skipsFile.open(outputDir + "/postings.skips.bin",
+                       std::ios::out | std::ios::binary);
+        lexiconFile.open(outputDir + "/lexicon.tsv",
+                         std::ios::out);
+
+        if (!docIdsFile.is_open() || !freqsFile.is_open() || !skipsFile.is_open() ||
+            !lexiconFile.is_open()) {
+            std::cerr << "Failed to open output files" << std::endl;
+            exit(1);
+        }
+    }
+
+    ~IndexWriter() {
+        close();
+    }
+
+    /**
+     * Flush and close the posting and lexicon files (so they can be read back)
+     */
+    void close() {
+        if (docIdsFile.is_open()) docIdsFile.close();
+        if (freqsFile.is_open()) freqsFile.close();
+        if (skipsFile.is_open()) skipsFile.close();
+        if (lexiconFile.is_open()) lexiconFile.close();
+        if (positionsFile.is_open()) positionsFile.close();
+    }
+
+    /**
+     * Also write postings.positions.bin (call before the first list is written)
+     */
+    void enablePositions() {
+        positionsFile.open(outputDir + "/postings.positions.bin", std::ios::out | std::ios::binary);
+        if (!positionsFile.is_open()) {
+            std::cerr << "Failed to open positions file" << std::endl;
+            exit(1);
+        }
+    }
+
+    bool hasPositions() const { return positionsFile.is_open(); }
+
+    /**
+     * Mark the index as a learned sparse index: the tf column holds integer
+     * impacts, scored by dot product instead of BM25
+     */
+    void setImpactScoring(bool impacts) { impactScoring = impacts; }
+    bool hasImpacts() const { return impactScoring; }
+
+    const std::string& directory() const { return outputDir; }
+    const std::vector<uint32_t>& documentLengths() const { return docLengths; }
+
+    /**
+     * Raise the document count (documents without postings still count for N)
+     */
+    void ensureDocCount(uint64_t n) {
+        if (n > docCount) docCount = n;
+    }
+
+    /**
+     * Use the given document lengths instead of the ones accumulated from the
+     * written tfs (an index that drops postings keeps the original lengths)
+     */
+    void setDocumentLengths(const std::vector<uint32_t>& lengths) {
+        docLengths = lengths;
+        ensureDocCount(lengths.size());
+    }
+
+    uint64_t termCount() const { return totalTerms; }
+    uint64_t postingCount() const { return totalPostings; }
+    uint64_t documentCount() const { return docCount; }
+
+    /**
+     * Write inverted list for a single term using block compression
+     *
+     * Format:
+     * - docIDs: block_size + gap-encoded docID sequence (VarByte)
+     * - frequencies: block_size + tf sequence (VarByte)
+     * - lexicon: term metadata (df, cf, offsets, block count)
+     *
+     * Postings must be sorted by docID. If positions are enabled, `positions`
+     * holds each posting's positions in order (frequency values per posting,
+     * ascending within a posting), concatenated over the list.
+     * @return The lexicon entry written for the term
+     */
+    TermMeta writeInvertedList(const std::string& term, const std::vector<Posting>& postings,
+                               const std::vector<uint32_t>* positions = nullptr) {
+        if (postings.empty()) return TermMeta();
+
+        if (!headerWritten) {
+            lexiconFile << "# term\tdf\tcf\tdocids_offset\tfreqs_offset\tblocks_count\tskips_offset"
+                        << (hasPositions() ? "\tpositions_offset" : "") << "\n";
+            headerWritten = true;
+        }
+
+        // Record file offsets before writing
+        uint64_t docIdsOffset = docIdsFile.tellp();
+        uint64_t freqsOffset = freqsFile.tellp();
+        uint64_t skipsOffset = skipsFile.tellp();
+
+        // Calculate statistics
+        uint32_t df = static_cast<uint32_t>(postings.size());  // Document frequency
+        uint64_t cf = 0;  // Collection frequency (sum of all tf)
+
+        // Write in blocks for compression efficiency
+        size_t blocksCount = 0;
+        for (size_t i = 0; i < postings.size(); i += BLOCK_SIZE) {
+            size_t blockLen = std::min(BLOCK_SIZE, postings.size() - i);
+
+            SkipEntry skip;
+            skip.lastDocID = postings[i + blockLen - 1].docID;
+            skip.docidsOffset = static_cast<uint32_t>(static_cast<uint64_t>(docIdsFile.tellp()) - docIdsOffset);
+            skip.freqsOffset = static_cast<uint32_t>(static_cast<uint64_t>(freqsFile.tellp()) - freqsOffset);
+            skip.maxTF = 0;
+            for (size_t j = i; j < i + blockLen; j++) {
+                skip.maxTF = std::max(skip.maxTF, postings[j].frequency);
+            }
+            skipsFile.write(reinterpret_cast<const char*>(&skip), sizeof(SkipEntry));
+
+            writeDocIDsBlock(postings, i, blockLen);
+
+            writeFrequenciesBlock(postings, i, blockLen, cf);
+
+            blocksCount++;
+        }
+
+        lexiconFile << term << "\t"
+                    << df << "\t"
+                    << cf << "\t"
+                    << docIdsOffset << "\t"
+                    << freqsOffset << "\t"
+                    << blocksCount << "\t"
+                    << skipsOffset;
+        uint64_t positionsOffset = 0;
+        if (hasPositions()) {
+            positionsOffset = writePositions(postings, positions);
+            lexiconFile << "\t" << positionsOffset;
+        }
+        lexiconFile << "\n";
+
+        ensureDocCount(static_cast<uint64_t>(postings.back().docID) + 1);
+        totalTerms++;
+        totalPostings += df;
+
+        TermMeta meta;
+        meta.df = df;
+        meta.cf = cf;
+        meta.docids_offset = docIdsOffset;
+        meta.freqs_offset = freqsOffset;
+        meta.blocks = static_cast<uint32_t>(blocksCount);
+        meta.skips_offset = skipsOffset;
+        meta.hasSkips = true;
+        meta.positions_offset = positionsOffset;
+        meta.hasPositions = hasPositions();
+        return meta;
+    }
+
+    /**
+     * Write statistics file and document lengths file
+     *
+     * Outputs:
+     * - doc_len.bin: binary file with document lengths (needed for BM25)
+     * - stats.txt: text file with index statistics (doc_count, avgdl, etc.)
+     */
+    void writeStats() {
+        if (docLengths.size() < docCount) docLengths.resize(docCount, 0);
+
+        std::ofstream docLenFile(outputDir + "/doc_len.bin", std::ios::out | std::ios::binary);
+        if (docLenFile.is_open()) {
+            for (uint32_t len : docLengths) {
+                docLenFile.write(reinterpret_cast<const char*>(&len), sizeof(uint32_t));
+            }
+            docLenFile.close();
+            std::cout << "Wrote document lengths for " << docLengths.size() << " documents" << std::endl;
+        } else {
+            std::cerr << "Warning: Failed to write doc_len.bin" << std::endl;
+        }
+
+        std::ofstream statsFile(outputDir + "/stats.txt", std::ios::out);
+        if (!statsFile.is_open()) {
+            std::cerr << "Failed to open stats file" << std::endl;
+            return;
+        }
+
+        uint64_t totalDocLength = 0;
+        for (uint32_t len : docLengths) {
+            totalDocLength += len;
+        }
+        double avgdl = (docCount > 0) ? static_cast<double>(totalDocLength) / docCount : 0.0;
+
+        statsFile << "# Index Statistics\n";
+        statsFile << "doc_count\t" << docCount << "\n";
+        statsFile << "total_terms\t" << totalTerms << "\n";
+        statsFile << "total_postings\t" << totalPostings << "\n";
+        statsFile << "avgdl\t" << avgdl << "\n";
+        statsFile << "total_doc_length\t" << totalDocLength << "\n";
+        if (impactScoring) statsFile << "scoring\timpact\n";
+
+        statsFile.close();
+
+        std::cout << "Average document length: " << avgdl << std::endl;
+    }
+
+private:
+    /**
+     * Write the positions of one term
+     *
+     * Format: (blocks + 1) uint32 offsets of each block's data, relative to the
+     * end of the table, then per block and per posting the positions as gaps
+     * (first absolute, VarByte). Readers jump to a block through the table and
+     * decode only the postings they need.
+     * @return Offset of the term's table in postings.positions.bin
+     */
+    uint64_t writePositions(const std::vector<Posting>& postings, const std::vector<uint32_t>* positions) {
+        uint64_t offset = positionsFile.tellp();
+        std::vector<uint32_t> blockOffsets;
+        positionBytes.clear();
+
+        size_t next = 0;
+        std::vector<uint32_t> gaps;
+        for (size_t i = 0; i < postings.size(); i++) {
+            if (i % BLOCK_SIZE == 0) blockOffsets.push_back(static_cast<uint32_t>(positionBytes.size()));
+
+            gaps.clear();
+            uint32_t prev = 0;
+            for (uint32_t j = 0; j < postings[i].frequency; j++) {
+                uint32_t pos = (positions && next < positions->size()) ? (*positions)[next++] : 0;
+                gaps.push_back(j == 0 ? pos : pos - prev);
+                prev = pos;
+            }
+            varbyte::encode_batch(positionBytes, gaps);
+        }
+        blockOffsets.push_back(static_cast<uint32_t>(positionBytes.size()));
+
+        positionsFile.write(reinterpret_cast<const char*>(blockOffsets.data()),
+                            blockOffsets.size() * sizeof(uint32_t));
+        positionsFile.write(reinterpret_cast<const char*>(positionBytes.data()), positionBytes.size());
+        return offset;
+    }
+
+    /**
+     * Write docIDs block with gap encoding and VarByte compression
+     *
+     * Block format: block_length + docID_sequence
+     * docID_sequence uses gap encoding: first docID is absolute,
+     * subsequent docIDs are stored as gaps (docID[i] - docID[i-1])
+     */
+    void writeDocIDsBlock(const std::vector<Posting>& postings,
+                          size_t start, size_t length) {
+        varbyte::encode(docIdsFile, static_cast<uint32_t>(length));
+
+        uint32_t prevDocID = 0;
+        for (size_t i = 0; i < length; i++) {
+            uint32_t docID = postings[start + i].docID;
+            uint32_t gap = (i == 0) ? docID : (docID - prevDocID);
+            varbyte::encode(docIdsFile, gap);
+            prevDocID = docID;
+        }
+    }
+
+    /**
+     * Write frequencies block with VarByte compression
+     *
+     * Block format: block_length + tf_sequence
+     * Also updates collection frequency (cf) and document lengths
+     * for BM25 avgdl calculation
+     */
+    void writeFrequenciesBlock(const std::vector<Posting>& postings,
+                               size_t start, size_t length, uint64_t& cf) {
+        varbyte::encode(freqsFile, static_cast<uint32_t>(length));
+
+        for (size_t i = 0; i < length; i++) {
+            uint32_t tf = postings[start + i].frequency;
+            varbyte::encode(freqsFile, tf);
+            cf += tf;
+
+            // Update document length for BM25 avgdl calculation
+            uint32_t docID = postings[start + i].docID;
+            if (docID >= docLengths.size()) {
+                docLengths.resize(docID + 1, 0);
+            }
+            docLengths[docID] += tf;
+        }
+    }
+};
+
+/**
+ * Write postings.dense.bin and dense.tsv in indexDir: Roaring copies
+ * (roaring.hpp) of the given lists, which must already be written and closed
+ * there. Shared by the merger (--dense-ratio) and the tools that rewrite a
+ * dense index.
+ * @return Number of lists written
+ */
+inline size_t writeDenseLists(const std::string& indexDir,
+                              const std::vector<std::pair<std::string, TermMeta>>& lists) {
+    std::ofstream denseFile(indexDir + "/postings.dense.bin", std::ios::binary);
+    std::ofstream denseLexicon(indexDir + "/dense.tsv");
+    if (!denseFile.is_open() || !denseLexicon.is_open()) {
+        std::cerr << "Failed to open dense list files in " << indexDir << std::endl;
+        exit(1);
+    }
+    denseLexicon << "# term\toffset\tbytes\n";
+
+    std::string record;
+    uint64_t offset = 0;
+    size_t written = 0;
+    for (const auto& entry : lists) {
+        auto decoded = PostingList::decodeAll(entry.second, indexDir);
+        if (!decoded) continue;
+
+        record.clear();
+        RoaringPostings::build(decoded->docIDs, decoded->freqs)->serialize(record);
+        denseFile.write(record.data(), record.size());
+        denseLexicon << entry.first << "\t" << offset << "\t" << record.size() << "\n";
+        offset += record.size();
+        written++;
+    }
+    std::cout << "Dense lists: " << written << " terms, " << offset << " bytes" << std::endl;
+    return written;
+}
+
+/**
+ * ForwardIndexWriter: writes the forward index (term vector of every document)
+ *
+ * Fed the inverted lists in term order, it numbers the terms in that order
+ * and, after the last list, writes:
+ * - forward.terms.tsv:  term and df; line i after the header is term ID i
+ * - forward.bin:        documents in docID order, in blocks of BLOCK_DOCS;
+ *                       per document: term count, gap-encoded term IDs, tfs
+ *                       (VarByte)
+ * - forward.blocks.bin: document count, BLOCK_DOCS, then the offset of every
+ *                       block in forward.bin followed by the end offset
+ * While the lists stream in, postings are spilled to one run file per
+ * RANGE_DOCS documents, so only one range is held in memory at the end.
+ */
+class ForwardIndexWriter {
+public:
+    static constexpr uint32_t BLOCK_DOCS = 32;
+    static constexpr uint32_t RANGE_DOCS = 64 * 1024;   // a multiple of BLOCK_DOCS
+
+private:
+    struct Entry {
+        uint32_t docID;
+        uint32_t termID;
+        uint32_t tf;
+    };
+
+    std::string outputDir;
+    std::ofstream termsFile;
+    std::vector<std::unique_ptr<std::ofstream>> runs;   // one per docID range, opened on demand
+    uint32_t nextTermID;
+    uint64_t totalEntries;
+
+    std::string runPath(size_t range) const {
+        return outputDir + "/forward.run" + std::to_string(range) + ".tmp";
+    }
+
+public:
+    explicit ForwardIndexWriter(const std::string& outDir)
+        : outputDir(outDir), nextTermID(0), totalEntries(0) {
+        std::filesystem::create_directories(outputDir);
+        termsFile.open(outputDir + "/forward.terms.tsv", std::ios::out);
+        if (!termsFile.is_open()) {
+            std::cerr << "Failed to open " << outputDir << "/forward.terms.tsv" << std::endl;
+            exit(1);
+        }
+        termsFile << "# term\tdf\n";
+    }
+
+    uint32_t termCount() const { return nextTermID; }
+
+    /**
+     * Add the list of the next term (terms must arrive in lexicon order)
+     */
+    void addList(const std::string& term, const std::vector<IndexWriter::Posting>& postings) {
+        uint32_t termID = nextTermID++;
+        termsFile << term << "\t" << postings.size() << "\n";
+        for (const auto& p : postings) {
+            size_t range = p.docID / RANGE_DOCS;
+            if (range >= runs.size()) runs.resize(range + 1);
+            if (!runs[range]) {
+                runs[range] = std::make_unique<std::ofstream>(runPath(range), std::ios::out | std::ios::binary);
+                if (!runs[range]->is_open()) {
+                    std::cerr << "Failed to open " << runPath(range) << std::endl;
+                    exit(1);
+                }
+            }
+            Entry entry{p.docID, termID, p.frequency};
+            runs[range]->write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        }
+        totalEntries += postings.size();
+    }
+
+    /**
+     * Write forward.bin and forward.blocks.bin for documents [0, docCount)
+     * and remove the run files
+     */
+    void finish(uint64_t docCount) {
+        termsFile.close();
+        for (auto& run : runs) {
+            if (run) run->close();
+        }
+
+        std::ofstream dataFile(outputDir + "/forward.bin", std::ios::out | std::ios::binary);
+        std::ofstream blocksFile(outputDir + "/forward.blocks.bin", std::ios::out | std::ios::binary);
+        if (!dataFile.is_open() || !blocksFile.is_open()) {
+            std::cerr << "Failed to open forward index files in " << outputDir << std::endl;
+            exit(1);
+        }
+        uint32_t blockDocs = BLOCK_DOCS;
+        blocksFile.write(reinterpret_cast<const char*>(&docCount), sizeof(docCount));
+        blocksFile.write(reinterpret_cast<const char*>(&blockDocs), sizeof(blockDocs));
+
+        std::vector<Entry> entries;
+        std::vector<uint32_t> starts(RANGE_DOCS + 1);
+        std::vector<uint32_t> byDoc;
+        std::vector<uint32_t> values;        // one document: count, term ID gaps, tfs
+        std::vector<unsigned char> bytes;    // the current block
+        uint64_t offset = 0;
+        for (uint64_t rangeStart = 0; rangeStart < docCount; rangeStart += RANGE_DOCS) {
+            size_t range = rangeStart / RANGE_DOCS;
+            entries.clear();
+            if (range < runs.size() && runs[range]) {
+                std::ifstream run(runPath(range), std::ios::binary);
+                run.seekg(0, std::ios::end);
+                entries.resize(static_cast<size_t>(run.tellg()) / sizeof(Entry));
+                run.seekg(0);
+                run.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(Entry));
+                run.close();
+                std::filesystem::remove(runPath(range));
+            }
+
+            // counting sort by docID; stable, so term IDs stay ascending
+            std::fill(starts.begin(), starts.end(), 0);
+            for (const auto& e : entries) starts[e.docID - rangeStart + 1]++;
+            for (size_t d = 0; d < RANGE_DOCS; d++) starts[d + 1] += starts[d];
+            byDoc.resize(entries.size());
+            {
+                std::vector<uint32_t> fill(starts.begin(), starts.end() - 1);
+                for (uint32_t i = 0; i < entries.size(); i++) byDoc[fill[entries[i].docID - rangeStart]++] = i;
+            }
+
+            uint64_t rangeEnd = std::min<uint64_t>(rangeStart + RANGE_DOCS, docCount);
+            for (uint64_t doc = rangeStart; doc < rangeEnd; doc++) {
+                if ((doc - rangeStart) % BLOCK_DOCS == 0) {
+                    dataFile.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+                    offset += bytes.size();
+                    bytes.clear();
+                    blocksFile.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+                }
+                uint32_t first = starts[doc - rangeStart];
+                uint32_t last = starts[doc - rangeStart + 1];
+                values.clear();
+                values.push_back(last - first);
+                uint32_t prev = 0;
+                for (uint32_t i = first; i < last; i++) {
+                    values.push_back(entries[byDoc[i]].termID - prev);
+                    prev = entries[byDoc[i]].termID;
+                }
+                for (uint32_t i = first; i < last; i++) values.push_back(entries[byDoc[i]].tf);
+                varbyte::encode_batch(bytes, values);
+            }
+        }
+        dataFile.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        offset += bytes.size();
+        blocksFile.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+        runs.clear();
+
+        std::cout << "Forward index: " << docCount << " documents, " << nextTermID << " terms, "
+                  << totalEntries << " entries, " << offset << " bytes" << std::endl;
+    }
+};
+
+#endif // INDEX_WRITER_HPP
@@ -0,0 +1,459 @@
+#ifndef JSON_HPP
+#define JSON_HPP
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cctype>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Minimal JSON support for the web server.
+ *
+ * Writer: all output is appended to a caller-owned std::string so the same
+ * buffer can be reused across responses (clear() keeps the capacity). Strings
+ * are escaped through a 256-entry lookup table and copied in runs, and numbers
+ * are formatted with std::to_chars, so no iostreams are involved.
+ *
+ * Value/parse: a small recursive-descent parser for request bodies.
+ */
+namespace json {
+
+namespace detail {
+
+/**
+ * @brief Escape table: 0 = copy as is, 'u' = \u00XX, otherwise the character
+ *        that follows the backslash.
+ */
+struct EscapeTable {
+    std::array<char, 256> map{};
+
+    constexpr EscapeTable() {
+        for (int c = 0; c < 32; c++) map[c] = 'u';
+        map['"'] = '"';
+        map['\\'] = '\\';
+        map['\b'] = 'b';
+        map['\f'] = 'f';
+        map['\n'] = 'n';
+        map['\r'] = 'r';
+        map['\t'] = 't';
+    }
+};
+
+inline constexpr EscapeTable kEscape{};
+
+} // namespace detail
+
+/**
+ * @brief Append str to out as JSON string contents (without quotes).
+ * @param out Output buffer
+ * @param str Raw string
+ */
+inline void appendEscaped(std::string& out, std::string_view str) {
+    static constexpr char hex[] = "0123456789abcdef";
+    size_t runStart = 0;
+    for (size_t i = 0; i < str.size(); i++) {
+        char esc = detail::kEscape.map[static_cast<unsigned char>(str[i])];
+        if (esc == 0) continue;
+
+        out.append(str.data() + runStart, i - runStart);
+        if (esc == 'u') {
+            unsigned char c = static_cast<unsigned char>(str[i]);
+            char buf[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+            out.append(buf, sizeof(buf));
+        } else {
+            char buf[2] = {'\\', esc};
+            out.append(buf, sizeof(buf));
+        }
+        runStart = i + 1;
+    }
+    out.append(str.data() + runStart, str.size() - runStart);
+}
+
+/**
+ * @brief Append an integer in decimal form.
+ */
+template <typename Int>
+inline void appendInt(std::string& out, Int value) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, res.ptr - buf);
+}
+
+/**
+ * @brief Append a floating point value with a fixed number of decimals.
+ */
+inline void appendFixed(std::string& out, double value, int precision) {
+    char buf[64];
+    auto res = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed, precision);
+    if (res.ec != std::errc()) {
+        out.append("0");
+        return;
+    }
+    out.append(buf, res.ptr - buf);
+}
+
+/**
+ * @brief Compact JSON writer with automatic comma placement.
+ *
+ * Usage:
+ *   json::Writer w(buffer);
+ *   w.beginObject();
+ *   w.key("num_results"); w.value(10);
+ *   w.endObject();
+ *
+ * Nesting depth is limited to 64 levels (tracked in a bit stack, no allocation).
+ */
+class Writer {
+private:
+    std::string& out;
+    uint64_t hasItems;   // bit i set → level i already has an element
+    int depth;
+    bool afterKey;
+
+    void separate() {
+        if (afterKey) {
+            afterKey = false;
+            return;
+        }
+        if (depth > 0) {
+            uint64_t bit = 1ULL << (depth - 1);
+            if (hasItems & bit) out.push_back(',');
+            hasItems |= bit;
+        }
+    }
+
+    void open(char c) {
+        separate();
+        out.push_back(c);
+        depth++;
+        hasItems &= ~(1ULL << (depth - 1));
+    }
+
+    void close(char c) {
+        depth--;
+        out.push_back(c);
+    }
+
+public:
+    explicit Writer(std::string& buffer)
+        : out(buffer), hasItems(0), depth(0), afterKey(false) {}
+
+    void beginObject() { open('{'); }
+    void endObject() { close('}'); }
+    void beginArray() { open('['); }
+    void endArray() { close(']'); }
+
+    void key(std::string_view k) {
+        separate();
+        out.push_back('"');
+        appendEscaped(out, k);
+        out.append("\":", 2);
+        afterKey = true;
+    }
+
+    void value(std::string_view s) {
+        separate();
+        out.push_back('"');
+        appendEscaped(out, s);
+        out.push_back('"');
+    }
+
+    void value(const char* s) { value(std::string_view(s)); }
+    void value(const std::string& s) { value(std::string_view(s)); }
+
+    void value(bool b) {
+        separate();
+        out.append(b ? "true" : "false");
+    }
+
+    void value(int v) { separate(); appendInt(out, v); }
+    void value(long v) { separate(); appendInt(out, v); }
+    void value(long long v) { separate(); appendInt(out, v); }
+    void value(unsigned v) { separate(); appendInt(out, v); }
+    void value(unsigned long v) { separate(); appendInt(out, v); }
+    void value(unsigned long long v) { separate(); appendInt(out, v); }
+
+    void value(double v, int precision = 4) {
+        separate();
+        appendFixed(out, v, precision);
+    }
+
+    /**
+     * @brief Insert a pre-serialized JSON fragment as the next value.
+     */
+    void raw(std::string_view fragment) {
+        separate();
+        out.append(fragment.data(), fragment.size());
+    }
+};
+
+/**
+ * @brief Parsed JSON value (DOM node).
+ */
+class Value {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string str;
+    std::vector<Value> items;                              // Array
+    std::vector<std::pair<std::string, Value>> members;    // Object (in input order)
+
+    bool isNull() const { return type == Type::Null; }
+    bool isNumber() const { return type == Type::Number; }
+    bool isString() const { return type == Type::String; }
+    bool isArray() const { return type == Type::Array; }
+    bool isObject() const { return type == Type::Object; }
+
+    /**
+     * @brief Member lookup; nullptr if this is not an object or the key is missing.
+     */
+    const Value* get(std::string_view key) const {
+        if (type != Type::Object) return nullptr;
+        for (const auto& m : members) {
+            if (m.first == key) return &m.second;
+        }
+        return nullptr;
+    }
+
+    std::string getString(std::string_view key, const std::string& def) const {
+        const Value* v = get(key);
+        return (v && v->isString()) ? v->str : def;
+    }
+
+    double getNumber(std::string_view key, double def) const {
+        const Value* v = get(key);
+        return (v && v->isNumber()) ? v->number : def;
+    }
+
+    bool getBool(std::string_view key, bool def) const {
+        const Value* v = get(key);
+        return (v && v->type == Type::Bool) ? v->boolean : def;
+    }
+};
+
+namespace detail {
+
+class Parser {
+private:
+    std::string_view text;
+    size_t pos;
+    int depth;
+    std::string error;
+
+    static constexpr int kMaxDepth = 64;
+
+    bool fail(const char* msg) {
+        if (error.empty()) error = std::string(msg) + " at offset " + std::to_string(pos);
+        return false;
+    }
+
+    void skipWhitespace() {
+        while (pos < text.size() &&
+               (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) {
+            pos++;
+        }
+    }
+
+    bool literal(std::string_view word) {
+        if (text.compare(pos, word.size(), word) != 0) return fail("invalid literal");
+        pos += word.size();
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, uint32_t cp) {
+        if (cp < 0x80) {
+            out.push_back(static_cast<char>(cp));
+        } else if (cp < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else if (cp < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    bool hex4(uint32_t& out) {
+        if (pos + 4 > text.size()) return fail("truncated \\u escape");
+        out = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = text[pos++];
+            out <<= 4;
+            if (c >= '0' && c <= '9') out |= c - '0';
+            else if (c >= 'a' && c <= 'f') out |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') out |= c - 'A' + 10;
+            else return fail("invalid \\u escape");
+        }
+        return true;
+    }
+
+    bool parseString(std::string& out) {
+        pos++;  // opening quote
+        while (pos < text.size()) {
+            char c = text[pos++];
+            if (c == '"') return true;
+            if (c != '\\') {
+                out.push_back(c);
+                continue;
+            }
+            if (pos >= text.size()) break;
+            char e = text[pos++];
+            switch (e) {
+                case '"': out.push_back('"'); break;
+                case '\\': out.push_back('\\'); break;
+                case '/': out.push_back('/'); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u': {
+                    uint32_t cp = 0;
+                    if (!hex4(cp)) return false;
+                    // a high surrogate needs a low one (DC00-DFFF) right after it
+                    if (cp >= 0xD800 && cp < 0xDC00) {
+                        if (text.compare(pos, 2, "\\u") != 0) return fail("unpaired surrogate in \\u escape");
+                        pos += 2;
+                        uint32_t low = 0;
+                        if (!hex4(low)) return false;
+                        if (low < 0xDC00 || low > 0xDFFF) return fail("invalid low surrogate in \\u escape");
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                        return fail("unpaired surrogate in \\u escape");
+                    }
+                    appendUtf8(out, cp);
+                    break;
+                }
+                default:
+                    return fail("invalid escape");
+            }
+        }
+        return fail("unterminated string");
+    }
+
+    bool parseNumber(Value& out) {
+        size_t start = pos;
+        if (pos < text.size() && text[pos] == '-') pos++;
+        while (pos < text.size() &&
+               (std::isdigit(static_cast<unsigned char>(text[pos])) || text[pos] == '.' ||
+                text[pos] == 'e' || text[pos] == 'E' || text[pos] == '+' || text[pos] == '-')) {
+            pos++;
+        }
+        std::string num(text.substr(start, pos - start));
+        char* end = nullptr;
+        out.number = std::strtod(num.c_str(), &end);
+        if (num.empty() || end != num.c_str() + num.size()) return fail("invalid number");
+        out.type = Value::Type::Number;
+        return true;
+    }
+
+    bool parseValue(Value& out) {
+        if (++depth > kMaxDepth) return fail("nesting too deep");
+        skipWhitespace();
+        if (pos >= text.size()) return fail("unexpected end of input");
+
+        bool ok = true;
+        char c = text[pos];
+        if (c == '{') {
+            out.type = Value::Type::Object;
+            pos++;
+            skipWhitespace();
+            if (pos < text.size() && text[pos] == '}') {
+                pos++;
+            } else {
+                while (ok) {
+                    skipWhitespace();
+                    if (pos >= text.size() || text[pos] != '"') return fail("expected object key");
+                    std::string key;
+                    if (!parseString(key)) return false;
+                    skipWhitespace();
+                    if (pos >= text.size() || text[pos] != ':') return fail("expected ':'");
+                    pos++;
+                    out.members.emplace_back(std::move(key), Value());
+                    if (!parseValue(out.members.back().second)) return false;
+                    skipWhitespace();
+                    if (pos < text.size() && text[pos] == ',') { pos++; continue; }
+                    if (pos < text.size() && text[pos] == '}') { pos++; break; }
+                    ok = fail("expected ',' or '}'");
+                }
+            }
+        } else if (c == '[') {
+            out.type = Value::Type::Array;
+            pos++;
+            skipWhitespace();
+            if (pos < text.size() && text[pos] == ']') {
+                pos++;
+            } else {
+                while (ok) {
+                    out.items.emplace_back();
+                    if (!parseValue(out.items.back())) return false;
+                    skipWhitespace();
+                    if (pos < text.size() && text[pos] == ',') { pos++; continue; }
+                    if (pos < text.size() && text[pos] == ']') { pos++; break; }
+                    ok = fail("expected ',' or ']'");
+                }
+            }
+        } else if (c == '"') {
+            out.type = Value::Type::String;
+            ok = parseString(out.str);
+        } else if (c == 't') {
+            out.type = Value::Type::Bool;
+            out.boolean = true;
+            ok = literal("true");
+        } else if (c == 'f') {
+            out.type = Value::Type::Bool;
+            ok = literal("false");
+        } else if (c == 'n') {
+            ok = literal("null");
+        } else {
+            ok = parseNumber(out);
+        }
+        depth--;
+        return ok;
+    }
+
+public:
+    explicit Parser(std::string_view t) : text(t), pos(0), depth(0) {}
+
+    bool parse(Value& out) {
+        if (!parseValue(out)) return false;
+        skipWhitespace();
+        if (pos != text.size()) return fail("trailing characters");
+        return true;
+    }
+
+    const std::string& lastError() const { return error; }
+};
+
+} // namespace detail
+
+/**
+ * @brief Parse a JSON document.
+ * @param text Input text
+ * @param out Parsed value
+ * @param error Optional error message on failure
+ * @return true on success
+ */
+inline bool parse(std::string_view text, Value& out, std::string* error = nullptr) {
+    detail::Parser parser(text);
+    if (parser.parse(out)) return true;
+    if (error) *error = parser.lastError();
+    return false;
+}
+
+} // namespace json
+
+#endif // JSON_HPP
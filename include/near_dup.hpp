@@ -0,0 +1,184 @@
+#ifndef NEAR_DUP_HPP
+#define NEAR_DUP_HPP
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "utils.hpp"
+
+/**
+ * @brief MinHash signature of a passage: the minimum of HASHES independent
+ *        hashes over its word 3-shingles (whole tokens for shorter passages).
+ *
+ * Two passages agree on a given minimum with probability equal to the
+ * Jaccard similarity of their shingle sets.
+*/
+struct NearDupSignature {
+    static constexpr size_t HASHES = 64;
+
+    std::array<uint32_t, HASHES> mins;
+    uint32_t distinctTerms;     // postings the passage contributes to the index
+    bool empty;                 // no tokens: never a duplicate
+
+    NearDupSignature() : distinctTerms(0), empty(true) { mins.fill(UINT32_MAX); }
+};
+
+/**
+ * @brief Streaming near-duplicate detection with MinHash + LSH banding.
+ *
+ * Signatures are split into BANDS bands of ROWS minima; a passage whose
+ * band matches the same band of an earlier canonical passage becomes a
+ * candidate, and is a near-duplicate if the signatures agree on at least
+ * `threshold` of their minima (estimated Jaccard similarity). With 8 x 8
+ * bands, pairs at similarity 0.9 are found with probability ~0.99 and pairs
+ * below 0.6 are rarely even compared. Only canonical passages are added, so
+ * every duplicate links directly to a canonical one.
+ *
+ * Per canonical passage the detector keeps one bucket entry per band and a
+ * 16-bit fingerprint of each minimum for verification (b-bit MinHash).
+*/
+class NearDupDetector {
+public:
+    static constexpr size_t HASHES = NearDupSignature::HASHES;
+    static constexpr size_t BANDS = 8;
+    static constexpr size_t ROWS = HASHES / BANDS;
+
+private:
+    double threshold;
+    std::array<std::unordered_map<uint64_t, uint32_t>, BANDS> buckets;   // band hash -> slot
+    std::vector<uint16_t> fingerprints;   // HASHES per slot
+    std::vector<uint32_t> slotDocs;       // slot -> canonical docID
+
+    static uint64_t mix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    static uint64_t bandHash(const NearDupSignature& sig, size_t band) {
+        uint64_t h = band;
+        for (size_t r = 0; r < ROWS; r++) h = mix(h ^ sig.mins[band * ROWS + r]);
+        return h;
+    }
+
+public:
+    explicit NearDupDetector(double similarity) : threshold(similarity) {}
+
+    static NearDupSignature signature(const std::string& content) {
+        NearDupSignature sig;
+        std::vector<std::string> tokens = tokenize_words(content);
+        if (tokens.empty()) return sig;
+        sig.empty = false;
+
+        std::vector<uint64_t> tokenHashes;
+        tokenHashes.reserve(tokens.size());
+        std::unordered_set<uint64_t> distinct;
+        for (const auto& t : tokens) {
+            uint64_t h = mix(std::hash<std::string>()(t));
+            tokenHashes.push_back(h);
+            distinct.insert(h);
+        }
+        sig.distinctTerms = static_cast<uint32_t>(distinct.size());
+
+        size_t width = tokenHashes.size() >= 3 ? 3 : 1;
+        std::unordered_set<uint64_t> shingles;
+        for (size_t i = 0; i + width <= tokenHashes.size(); i++) {
+            uint64_t h = 0;
+            for (size_t j = 0; j < width; j++) h = mix(h ^ tokenHashes[i + j]);
+            if (!shingles.insert(h).second) continue;
+            for (size_t k = 0; k < HASHES; k++) {
+                uint32_t v = static_cast<uint32_t>(mix(h ^ (k * 0x2545f4914f6cdd1dULL)) >> 32);
+                if (v < sig.mins[k]) sig.mins[k] = v;
+            }
+        }
+        return sig;
+    }
+
+    /**
+     * @brief Canonical passage sig is a near-duplicate of, with the
+     *        estimated similarity; false if there is none.
+     */
+    bool find(const NearDupSignature& sig, uint32_t& canonical, double& similarity) const {
+        if (sig.empty) return false;
+        uint32_t checked[BANDS];
+        size_t nChecked = 0;
+        for (size_t band = 0; band < BANDS; band++) {
+            auto it = buckets[band].find(bandHash(sig, band));
+            if (it == buckets[band].end()) continue;
+            uint32_t slot = it->second;
+            bool seen = false;
+            for (size_t i = 0; i < nChecked; i++) seen = seen || checked[i] == slot;
+            if (seen) continue;
+            checked[nChecked++] = slot;
+
+            const uint16_t* fp = &fingerprints[static_cast<size_t>(slot) * HASHES];
+            size_t agree = 0;
+            for (size_t k = 0; k < HASHES; k++) agree += fp[k] == static_cast<uint16_t>(sig.mins[k]);
+            double estimate = static_cast<double>(agree) / HASHES;
+            if (estimate >= threshold) {
+                canonical = slotDocs[slot];
+                similarity = estimate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // register a canonical passage (buckets already taken keep their passage)
+    void add(const NearDupSignature& sig, uint32_t docID) {
+        if (sig.empty) return;
+        uint32_t slot = static_cast<uint32_t>(slotDocs.size());
+        slotDocs.push_back(docID);
+        for (size_t k = 0; k < HASHES; k++) fingerprints.push_back(static_cast<uint16_t>(sig.mins[k]));
+        for (size_t band = 0; band < BANDS; band++) buckets[band].emplace(bandHash(sig, band), slot);
+    }
+};
+
+/**
+ * @brief docID -> canonical docID of its near-duplicate cluster
+ *        (doc_canonical.bin, written by indexer --near-dups=link).
+ *
+ * One uint32 per indexer docID; canonical passages map to themselves.
+*/
+class DocClusters {
+private:
+    std::vector<uint32_t> canonicals;
+    size_t duplicates;
+
+public:
+    DocClusters() : duplicates(0) {}
+
+    // false if the file does not exist (index built without --near-dups=link)
+    bool load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in.is_open()) return false;
+        std::streamsize bytes = in.tellg();
+        in.seekg(0);
+        canonicals.resize(static_cast<size_t>(bytes) / sizeof(uint32_t));
+        in.read(reinterpret_cast<char*>(canonicals.data()), canonicals.size() * sizeof(uint32_t));
+        if (!in) {
+            canonicals.clear();
+            return false;
+        }
+        duplicates = 0;
+        for (size_t d = 0; d < canonicals.size(); d++) duplicates += canonicals[d] != d;
+        std::cout << "Loaded near-duplicate clusters: " << duplicates << " of " << canonicals.size()
+                  << " documents are duplicates" << std::endl;
+        return true;
+    }
+
+    bool loaded() const { return !canonicals.empty(); }
+    size_t duplicateCount() const { return duplicates; }
+
+    uint32_t canonical(uint32_t docID) const {
+        return docID < canonicals.size() ? canonicals[docID] : docID;
+    }
+};
+
+#endif // NEAR_DUP_HPP
@@ -6,14 +6,23 @@
 #include <string>
 #include <vector>
 #include <queue>
+#include <functional>
 #include <algorithm>
 #include <unordered_set>
+#include <unordered_map>
+#include <memory>
 #include <iomanip>
 #include <chrono>
 #include <cctype>  
 #include "index_reader.hpp"
 #include "bm25.hpp"
 #include "utils.hpp"
+#include "reranker.hpp"
+#include "term_expansion.hpp"
+#include "fuzzy.hpp"
+#include "feedback.hpp"
+#include "near_dup.hpp"
+#include "boolean_query.hpp"
 
 /**
  * @brief A helper class for generating and highlighting query-dependent snippets.
@@ -225,6 +234,8 @@ private:
  * 
  * The comparison operator is inverted so that it can be used
  * directly in a std::priority_queue as a min-heap for Top-K retrieval.
+ * Equal scores are ordered by docID (smaller first in result order), so the
+ * top-k of a query is well defined and pages do not overlap.
  */
 struct QueryResult {
     uint32_t docID;
@@ -232,12 +243,437 @@ struct QueryResult {
     
     QueryResult(uint32_t d, double s) : docID(d), score(s) {}
     
-    // min-heap based on score
+    // min-heap based on score; the top is the last result in result order
     bool operator<(const QueryResult& other) const {
-        return score > other.score;
+        return score != other.score ? score > other.score : docID < other.docID;
     }
 };
 
+/**
+ * @brief Positional condition on a group of query terms.
+ *
+ * Phrase ("new york"): the terms occur at consecutive positions, in order.
+ * NEAR/k (apple NEAR/3 pie): one occurrence of every term, in any order,
+ * within a span of at most k positions.
+*/
+struct PositionalConstraint {
+    std::vector<std::string> terms;
+    bool phrase;
+    uint32_t window;
+    
+    PositionalConstraint() : phrase(true), window(0) {}
+};
+
+/**
+ * @brief A query split into scoring terms and positional constraints, or a
+ *        boolean query tree.
+*/
+struct ParsedQuery {
+    std::vector<std::string> terms;                  // unique terms, first-occurrence order
+    std::vector<PositionalConstraint> constraints;   // empty for bag-of-words queries
+    std::shared_ptr<const BooleanNode> boolean;      // set for boolean syntax (terms: non-excluded)
+    
+    bool positional() const { return !constraints.empty(); }
+};
+
+/**
+ * @brief Parses query strings with "quoted phrases" and NEAR/k operators.
+ *
+ * Everything else is tokenized as before, except that bare words keep '*'
+ * (patterns such as comput*, expanded by the evaluator). NEAR binds the single
+ * terms on its two sides (chains extend the group); "NEAR" without /k means
+ * NEAR/10. Malformed operators degrade to plain terms. Queries using boolean
+ * syntax (see BooleanParser) are parsed into a tree instead.
+*/
+class QueryParser {
+public:
+    static constexpr uint32_t DEFAULT_NEAR_WINDOW = 10;
+    
+    static ParsedQuery parse(const std::string& text) {
+        ParsedQuery query;
+        if (BooleanParser::detect(text)) {
+            auto root = std::make_shared<BooleanNode>(BooleanParser::parse(text));
+            BooleanParser::positiveTerms(*root, query.terms);
+            query.boolean = std::move(root);
+            return query;
+        }
+        std::unordered_set<std::string> seen;
+        auto addTerm = [&](const std::string& term) {
+            if (seen.insert(term).second) query.terms.push_back(term);
+        };
+        
+        // one item per bare term, phrase or operator, in query order
+        struct Item {
+            std::vector<std::string> terms;
+            bool quoted;
+            bool nearOp;
+            uint32_t window;
+        };
+        std::vector<Item> items;
+        
+        size_t i = 0;
+        while (i < text.size()) {
+            if (text[i] == '"') {
+                size_t close = text.find('"', i + 1);
+                if (close == std::string::npos) close = text.size();
+                items.push_back({tokenize_words(text.substr(i + 1, close - i - 1)), true, false, 0});
+                i = close + 1;
+                continue;
+            }
+            if (std::isspace(static_cast<unsigned char>(text[i]))) {
+                i++;
+                continue;
+            }
+            size_t end = i;
+            while (end < text.size() && text[end] != '"' &&
+                   !std::isspace(static_cast<unsigned char>(text[end]))) {
+                end++;
+            }
+            std::string word = text.substr(i, end - i);
+            uint32_t window;
+            if (parseNear(word, window)) {
+                items.push_back({{}, false, true, window});
+            } else {
+                for (auto& token : tokenize_words(word, true)) {
+                    if (token.find_first_not_of('*') == std::string::npos) continue;   // bare "*"
+                    items.push_back({{token}, false, false, 0});
+                }
+            }
+            i = end;
+        }
+        
+        for (size_t j = 0; j < items.size(); j++) {
+            const Item& item = items[j];
+            for (const auto& term : item.terms) addTerm(term);
+            
+            if (item.quoted && item.terms.size() > 1) {
+                PositionalConstraint phrase;
+                phrase.terms = item.terms;
+                query.constraints.push_back(phrase);
+            }
+            
+            // term NEAR/k term [NEAR/k term ...]
+            bool single = !item.nearOp && item.terms.size() == 1;
+            if (single && j + 2 < items.size() && items[j + 1].nearOp &&
+                !items[j + 2].nearOp && items[j + 2].terms.size() == 1) {
+                PositionalConstraint near;
+                near.phrase = false;
+                near.window = items[j + 1].window;
+                near.terms.push_back(item.terms[0]);
+                while (j + 2 < items.size() && items[j + 1].nearOp &&
+                       !items[j + 2].nearOp && items[j + 2].terms.size() == 1) {
+                    near.window = std::max(near.window, items[j + 1].window);
+                    const std::string& term = items[j + 2].terms[0];
+                    if (std::find(near.terms.begin(), near.terms.end(), term) == near.terms.end()) {
+                        near.terms.push_back(term);
+                    }
+                    addTerm(term);
+                    j += 2;
+                }
+                if (near.terms.size() > 1) query.constraints.push_back(near);
+            }
+        }
+        return query;
+    }
+    
+private:
+    // "NEAR" or "NEAR/k"
+    static bool parseNear(const std::string& word, uint32_t& window) {
+        if (word.compare(0, 4, "NEAR") != 0) return false;
+        if (word.size() == 4) {
+            window = DEFAULT_NEAR_WINDOW;
+            return true;
+        }
+        if (word.size() < 6 || word.size() > 14 || word[4] != '/') return false;
+        for (size_t i = 5; i < word.size(); i++) {
+            if (!std::isdigit(static_cast<unsigned char>(word[i]))) return false;
+        }
+        window = static_cast<uint32_t>(std::stoul(word.substr(5)));
+        return true;
+    }
+};
+
+/**
+ * @brief Cooperative evaluation budget for a single query.
+ *
+ * Limits evaluation by wall-clock deadline and/or by the number of postings
+ * scored. The DAAT loops call exhausted() once per candidate document; the
+ * clock is only read every CHECK_INTERVAL calls. Once the budget runs out the
+ * loops stop and the best results found so far are returned, with `partial`
+ * set. On a prior-ordered index (see DocPriors) the documents visited first
+ * are the high-prior ones, which makes the early top-k a good approximation.
+*/
+struct QueryBudget {
+    using Clock = std::chrono::steady_clock;
+    static constexpr uint32_t CHECK_INTERVAL = 1024;
+    
+    Clock::time_point deadline;
+    bool hasDeadline;
+    uint64_t maxPostings;      // 0 = unlimited
+    uint64_t postingsScored;
+    bool partial;        // evaluation stopped before the lists were exhausted
+    uint32_t ticks;
+    
+    QueryBudget() : hasDeadline(false), maxPostings(0), postingsScored(0), partial(false), ticks(0) {}
+    
+    /**
+     * @brief Budget expiring at the given time point.
+    */
+    static QueryBudget until(Clock::time_point t) {
+        QueryBudget budget;
+        budget.deadline = t;
+        budget.hasDeadline = true;
+        return budget;
+    }
+    
+    void charge(uint32_t postings) { postingsScored += postings; }
+    
+    bool exhausted() {
+        if (partial) return true;
+        if (maxPostings > 0 && postingsScored >= maxPostings) {
+            partial = true;
+            return true;
+        }
+        if (!hasDeadline || (++ticks % CHECK_INTERVAL) != 0) return false;
+        if (Clock::now() >= deadline) partial = true;
+        return partial;
+    }
+};
+
+/**
+ * @brief Number of documents matching a query (count-only evaluation).
+*/
+struct MatchCount {
+    uint64_t count;
+    bool exact;          // false: estimated from df / sampled postings
+    bool supported;      // false: phrase / NEAR queries are not counted
+    uint64_t postings;   // docIDs visited
+    
+    MatchCount() : count(0), exact(true), supported(true), postings(0) {}
+};
+
+/**
+ * @brief Metadata restrictions of a query (see QueryEvaluator::setFilter).
+ *
+ * DocIDs are external (indexer) docIDs, as in results; all set restrictions
+ * must hold. An empty allow-list with hasIDs matches nothing.
+*/
+struct FilterOptions {
+    std::vector<std::pair<uint32_t, uint32_t>> docRanges;   // inclusive, e.g. the docIDs of one source
+    std::vector<uint32_t> docIDs;                           // allow-list
+    bool hasIDs;
+    uint32_t minLength;   // passage length in tokens
+    uint32_t maxLength;   // UINT32_MAX = no bound
+
+    FilterOptions() : hasIDs(false), minLength(0), maxLength(UINT32_MAX) {}
+
+    bool active() const {
+        return !docRanges.empty() || hasIDs || minLength > 0 || maxLength != UINT32_MAX;
+    }
+
+    // "lo-hi,lo-hi,id" (a single docID is a range of one); false if malformed
+    static bool parseRanges(const std::string& text, std::vector<std::pair<uint32_t, uint32_t>>& out) {
+        out.clear();
+        std::istringstream in(text);
+        std::string item;
+        while (std::getline(in, item, ',')) {
+            size_t dash = item.find('-');
+            uint32_t lo, hi;
+            if (!parseNumber(item.substr(0, dash), lo)) return false;
+            hi = lo;
+            if (dash != std::string::npos && !parseNumber(item.substr(dash + 1), hi)) return false;
+            if (lo > hi) return false;
+            out.push_back({lo, hi});
+        }
+        return !out.empty();
+    }
+
+    // "1,2,3"; false if malformed
+    static bool parseIDs(const std::string& text, std::vector<uint32_t>& out) {
+        out.clear();
+        std::istringstream in(text);
+        std::string item;
+        while (std::getline(in, item, ',')) {
+            uint32_t id;
+            if (!parseNumber(item, id)) return false;
+            out.push_back(id);
+        }
+        return true;
+    }
+
+    static bool parseNumber(const std::string& text, uint32_t& out) {
+        if (text.empty() || text.size() > 10 ||
+            !std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isdigit(c); })) {
+            return false;
+        }
+        uint64_t value = std::stoull(text);
+        if (value > UINT32_MAX) return false;
+        out = static_cast<uint32_t>(value);
+        return true;
+    }
+};
+
+/**
+ * @brief Second-stage re-ranking settings (depth 0 = off).
+ *
+ * The first stage retrieves max(k, depth) documents with the usual evaluator;
+ * features are extracted for the top `depth` of them, which are then re-scored
+ * and re-sorted. Without a model the score is
+ *     first-stage score + pairWeight * termPair + spanWeight * span
+ * (a fixed linear model); a loaded model replaces it. Positions are read only
+ * if the model uses a positional feature.
+*/
+struct RerankOptions {
+    size_t depth;          // number of first-stage candidates to re-rank
+    double pairWeight;     // weight of the BM25TP term-pair score
+    double spanWeight;     // weight of the minimal-span score
+    uint32_t window;       // max distance of an occurrence pair
+    std::shared_ptr<const Reranker> model;   // learned reranker (optional)
+    
+    RerankOptions() : depth(0), pairWeight(1.0), spanWeight(1.0), window(5) {}
+};
+
+/**
+ * @brief Term proximity features over the positions of one document.
+ *
+ * positions[i] holds the (ascending) positions of query term i, empty if the
+ * term does not occur.
+*/
+class ProximityScorer {
+public:
+    /**
+     * @brief BM25TP term-pair score (Rasolofo & Savoy).
+     *
+     * Every pair of occurrences of two different query terms at distance
+     * d <= window contributes 1/d^2 (weighted by the other term's idf) to an
+     * accumulator per term, which is then saturated like a tf:
+     *     sum_t min(1, idf_t) * acc_t * (k1 + 1) / (acc_t + K)
+     * with K = k1 * (1 - b + b * dl / avgdl).
+     */
+    static double termPair(const std::vector<std::vector<uint32_t>>& positions,
+                           const std::vector<double>& idfs, uint32_t window,
+                           double k1, double K) {
+        double total = 0.0;
+        for (size_t a = 0; a < positions.size(); a++) {
+            if (positions[a].empty()) continue;
+            double acc = 0.0;
+            for (size_t b = 0; b < positions.size(); b++) {
+                if (b == a || positions[b].empty()) continue;
+                for (uint32_t pa : positions[a]) {
+                    uint32_t from = pa > window ? pa - window : 0;
+                    auto it = std::lower_bound(positions[b].begin(), positions[b].end(), from);
+                    for (; it != positions[b].end() && *it <= pa + window; ++it) {
+                        if (*it == pa) continue;
+                        double d = static_cast<double>(*it > pa ? *it - pa : pa - *it);
+                        acc += idfs[b] / (d * d);
+                    }
+                }
+            }
+            if (acc > 0.0) total += std::min(1.0, idfs[a]) * acc * (k1 + 1.0) / (acc + K);
+        }
+        return total;
+    }
+    
+    /**
+     * @brief Minimal-span score: matched / (span + 1) for the shortest window
+     *        covering one occurrence of every matched term (0 if fewer than 2).
+     */
+    static double span(const std::vector<std::vector<uint32_t>>& positions) {
+        std::vector<const std::vector<uint32_t>*> present;
+        for (const auto& p : positions) {
+            if (!p.empty()) present.push_back(&p);
+        }
+        if (present.size() < 2) return 0.0;
+        
+        std::vector<size_t> idx(present.size(), 0);
+        uint32_t best = UINT32_MAX;
+        while (true) {
+            size_t minList = 0;
+            uint32_t lo = UINT32_MAX;
+            uint32_t hi = 0;
+            for (size_t i = 0; i < present.size(); i++) {
+                uint32_t p = (*present[i])[idx[i]];
+                if (p < lo) {
+                    lo = p;
+                    minList = i;
+                }
+                hi = std::max(hi, p);
+            }
+            best = std::min(best, hi - lo);
+            if (++idx[minList] >= present[minList]->size()) break;
+        }
+        return static_cast<double>(present.size()) / (best + 1.0);
+    }
+};
+
+/**
+ * @brief Term state shared by the queries of one batch.
+ *
+ * Lexicon lookups are done once per distinct term, and posting lists of terms
+ * that occur in at least two queries are decoded once into memory so every
+ * query in the batch traverses the same decoded blocks. The cache is built
+ * before evaluation and is read-only afterwards, so it can be used from
+ * several worker threads at once.
+*/
+class BatchTermCache {
+public:
+    struct Entry {
+        TermMeta meta;
+        std::shared_ptr<const DecodedPostings> postings;  // null → read from disk
+    };
+
+private:
+    std::unordered_map<std::string, Entry> entries;
+    size_t sharedTerms;
+    
+public:
+    /**
+     * @param queries Term lists of all queries in the batch.
+     * @param maxSharedPostings Upper bound on postings decoded into memory.
+    */
+    BatchTermCache(const Lexicon& lexicon, const std::string& indexDir,
+                   const std::vector<std::vector<std::string>>& queries,
+                   size_t maxSharedPostings = 16 * 1024 * 1024)
+        : sharedTerms(0) {
+        std::unordered_map<std::string, int> queryCount;
+        for (const auto& terms : queries) {
+            std::unordered_set<std::string> seen(terms.begin(), terms.end());
+            for (const auto& term : seen) queryCount[term]++;
+        }
+        
+        // decode shared terms, shortest lists first, within the memory budget
+        std::vector<std::pair<uint32_t, std::string>> candidates;
+        for (const auto& [term, count] : queryCount) {
+            Entry entry;
+            if (!lexicon.find(term, entry.meta)) continue;
+            if (count >= 2) candidates.push_back({entry.meta.df, term});
+            entries.emplace(term, std::move(entry));
+        }
+        std::sort(candidates.begin(), candidates.end());
+        
+        size_t decodedPostings = 0;
+        for (const auto& [df, term] : candidates) {
+            if (decodedPostings + df > maxSharedPostings) break;
+            Entry& entry = entries[term];
+            entry.postings = PostingList::decodeAll(entry.meta, indexDir);
+            if (entry.postings) {
+                decodedPostings += df;
+                sharedTerms++;
+            }
+        }
+    }
+    
+    /**
+     * @brief Look up a term; nullptr if it is not in the lexicon.
+    */
+    const Entry* find(const std::string& term) const {
+        auto it = entries.find(term);
+        return it == entries.end() ? nullptr : &it->second;
+    }
+    
+    size_t sharedCount() const { return sharedTerms; }
+};
+
 /**
  * @brief QueryEvaluator handles query processing, scoring, and ranking using BM25.
  * 
@@ -249,106 +685,1565 @@ private:
     Lexicon& lexicon;
     Stats& stats;
 
-    const std::string& indexDir;
-    DocLen& docLen;        // Document length manager
-    DocTable& docTable;    // Document metadata (titles, IDs, etc.)
-    DocContentFile& docContent; // File for reading document snippets
+    const std::string& indexDir;
+    DocLen& docLen;        // Document length manager
+    DocTable& docTable;    // Document metadata (titles, IDs, etc.)
+    DocContentFile& docContent; // File for reading document snippets
+
+    bm25::Params bm25Params;
+    std::ifstream docidsFile;
+    std::ifstream freqsFile;
+    
+    const DocPriors* docPriors;   // optional static priors / docID order
+    double priorWeight;           // weight of the prior added to BM25 scores
+    
+    const TierIndex* tierIndex;   // optional high-impact tier (OR mode)
+    bool answeredFromTier;        // last query was answered without the full lists
+    
+    const PairIndex* pairIndex;   // optional intersections of frequent pairs (AND mode)
+    std::vector<std::string> pairsUsed;   // pair keys substituted in the last query
+    
+    RerankOptions rerank;         // optional second stage
+    std::shared_ptr<const Reranker> defaultModel;   // weighted proximity sum
+    FeatureMatrix features;       // candidates of the last re-ranked query
+    std::vector<uint32_t> featureDocs;
+    
+    ExpansionOptions expansionOptions;   // caps for '*' patterns
+    ExpansionStats expansion;            // cost of the last query's expansions
+    
+    const FuzzyIndex* fuzzyIndex;        // typo tolerance for unknown terms
+    FuzzyOptions fuzzy;
+    std::vector<FuzzyMatch> corrections; // substitutions made for the last query
+    
+    bool hasSearchAfter;          // only rank results after (afterScore, afterDoc)
+    double afterScore;
+    uint32_t afterDoc;            // index docID
+    
+    const ForwardIndex* forwardIndex;    // document vectors for feedback
+    FeedbackOptions feedbackOptions;
+    FeedbackStats feedback;              // expansion of the last query
+    TermAccumulator feedbackTerms;
+    bool inFeedback;                     // running the first pass
+    
+    const DocClusters* docClusters;      // near-duplicate clusters (indexer --near-dups=link)
+    size_t collapseDepth;                // candidates collapsed to one per cluster (0 = off)
+    size_t collapsed;                    // results dropped by the last query's collapsing
+    
+    DocFilter filter;                    // metadata restrictions, in index docIDs
+
+
+public:
+    /**
+     * @brief Constructor that initializes all references and opens posting files.
+    */
+    QueryEvaluator(Lexicon& lex, Stats& st, DocLen& dl, DocTable& dt, DocContentFile& dc,
+                   const std::string& indexDir, bm25::Params params)
+        : lexicon(lex), stats(st), docLen(dl), docTable(dt), docContent(dc), 
+        indexDir(indexDir), bm25Params(params), docPriors(nullptr), priorWeight(0.0),
+        tierIndex(nullptr), answeredFromTier(false), pairIndex(nullptr), fuzzyIndex(nullptr),
+        hasSearchAfter(false), afterScore(0.0), afterDoc(0), forwardIndex(nullptr), inFeedback(false),
+        docClusters(nullptr), collapseDepth(0), collapsed(0) {}
+
+    /**
+     * @brief Use static document priors: results are mapped back to indexer
+     *        docIDs and, if weight != 0, weight * prior is added to each score.
+    */
+    void setDocPriors(const DocPriors* priors, double weight = 0.0) {
+        docPriors = priors;
+        priorWeight = (priors && priors->hasPriors()) ? weight : 0.0;
+    }
+
+    /**
+     * @brief Answer OR queries from the high-impact tier when that is provably safe.
+     *        Used only when k1/b match the tier and no prior weight is applied.
+    */
+    void setTierIndex(const TierIndex* tiers) {
+        tierIndex = (tiers && tiers->available()) ? tiers : nullptr;
+    }
+    
+    // whether the last processQuery() call was answered from tier 1
+    bool lastAnsweredFromTier() const { return answeredFromTier; }
+    
+    /**
+     * @brief Substitute precomputed pair lists for term pairs of AND queries.
+    */
+    void setPairIndex(const PairIndex* pairs) {
+        pairIndex = (pairs && pairs->available()) ? pairs : nullptr;
+    }
+    
+    // pair lists (a|b keys) used by the last processQuery() call
+    const std::vector<std::string>& lastPairs() const { return pairsUsed; }
+    
+    /**
+     * @brief Re-rank the top candidates with options.model, or by term
+     *        proximity without one (needs a positional index; without
+     *        positions the proximity features are 0).
+    */
+    void setRerank(const RerankOptions& options) {
+        rerank = options;
+        defaultModel.reset();
+        if (!rerank.model) {
+            auto linear = std::make_shared<LinearReranker>();
+            linear->setWeight(features::BM25, 1.0);
+            linear->setWeight(features::TERM_PAIR, rerank.pairWeight);
+            linear->setWeight(features::SPAN, rerank.spanWeight);
+            defaultModel = linear;
+        }
+    }
+
+    /**
+     * @brief Collapse near-duplicates: of the top `depth` candidates (at least
+     *        k), only the best of each cluster is kept. depth = 0 turns it off.
+     *
+     * Costs one array lookup per candidate; a page comes out short only if
+     * duplicates fill the whole candidate window.
+    */
+    void setCollapse(const DocClusters* clusters, size_t depth) {
+        docClusters = (clusters && clusters->loaded()) ? clusters : nullptr;
+        collapseDepth = docClusters ? depth : 0;
+    }
+    
+    // results removed as near-duplicates by the last query
+    size_t lastCollapsed() const { return collapsed; }
+
+    /**
+     * @brief Only return documents passing options; inactive options remove
+     *        the filter. Call after setDocPriors().
+     *
+     * The options are compiled into a DocFilter attached to every posting
+     * list of the query, so all evaluators skip rejected documents (and whole
+     * blocks of them) inside the DAAT loop rather than filtering the top-k.
+     * DocID ranges stay ranges unless the index is prior-ordered, where they
+     * become a bitmap of the mapped docIDs, as do allow-lists. The high-impact
+     * tier is not used while filtering.
+    */
+    void setFilter(const FilterOptions& options) {
+        filter.clear();
+        if (!options.active()) return;
+        
+        bool reordered = docPriors && docPriors->reordered();
+        uint64_t n = std::max<uint64_t>(stats.doc_count, docLen.size());
+        auto allow = [this, reordered](std::vector<uint64_t>& bits, uint32_t docID) {
+            uint32_t doc = reordered ? docPriors->toInternal(docID) : docID;
+            if (doc / 64 < bits.size()) bits[doc / 64] |= 1ULL << (doc % 64);
+        };
+        if (!options.docRanges.empty() && reordered) {
+            std::vector<uint64_t> bits((n + 63) / 64, 0);
+            for (const auto& [lo, hi] : options.docRanges) {
+                for (uint64_t d = lo; d <= hi && d < n; d++) allow(bits, static_cast<uint32_t>(d));
+            }
+            filter.restrictTo(bits);
+        } else if (!options.docRanges.empty()) {
+            for (const auto& [lo, hi] : options.docRanges) filter.addRange(lo, hi);
+            filter.normalize();
+        }
+        if (options.hasIDs) {
+            std::vector<uint64_t> bits((n + 63) / 64, 0);
+            for (uint32_t id : options.docIDs) allow(bits, id);
+            filter.restrictTo(bits);
+        }
+        if (options.minLength > 0 || options.maxLength != UINT32_MAX) {
+            filter.setLengthRange(&docLen, options.minLength, options.maxLength);
+        }
+    }
+    
+    bool filtered() const { return filter.active(); }
+
+    /**
+     * @brief Features of the candidates re-ranked by the last query, one row
+     *        per lastFeatureDocs() entry (external docIDs), in first-stage order.
+    */
+    const FeatureMatrix& lastFeatures() const { return features; }
+    const std::vector<uint32_t>& lastFeatureDocs() const { return featureDocs; }
+
+    /**
+     * @brief Caps applied when expanding '*' patterns.
+    */
+    void setExpansionOptions(const ExpansionOptions& options) {
+        expansionOptions = options;
+    }
+    
+    // expansion cost of the last processQuery() call (patterns == 0 if none)
+    const ExpansionStats& lastExpansion() const { return expansion; }
+
+    /**
+     * @brief Replace query terms missing from the lexicon by their closest
+     *        indexed term when options.enabled; patterns are not corrected.
+    */
+    void setFuzzy(const FuzzyIndex* index, const FuzzyOptions& options) {
+        fuzzyIndex = (index && index->available()) ? index : nullptr;
+        fuzzy = options;
+    }
+    
+    // terms replaced in the last processQuery() call
+    const std::vector<FuzzyMatch>& lastCorrections() const { return corrections; }
+
+    /**
+     * @brief Rank only results that come after (score, docID) in result order
+     *        (score descending, then docID ascending), i.e. the page after the
+     *        one that ended there. docID is an index docID (see
+     *        DocPriors::toInternal). The high-impact tier is not used, since it
+     *        only holds the top of each list. Scores within 1e-9 (relative)
+     *        count as equal, so a bound taken from another evaluation order
+     *        neither repeats nor skips documents.
+    */
+    void setSearchAfter(double score, uint32_t docID) {
+        hasSearchAfter = true;
+        afterScore = score;
+        afterDoc = docID;
+    }
+    
+    void clearSearchAfter() { hasSearchAfter = false; }
+
+    /**
+     * @brief Expand bag-of-words queries with RM3 pseudo-relevance feedback
+     *        when options.enabled (needs a forward index, merger --forward).
+     *        Phrase, boolean and wildcard queries are evaluated as is.
+    */
+    void setFeedback(const ForwardIndex* index, const FeedbackOptions& options) {
+        forwardIndex = (index && index->loaded()) ? index : nullptr;
+        feedbackOptions = options;
+    }
+    
+    // expansion and stage timings of the last processQuery() call
+    const FeedbackStats& lastFeedback() const { return feedback; }
+
+    /**
+     * @brief Update BM25 parameters k1 and b.
+    */
+    void updateBM25Params(double k1, double b) {
+        bm25Params = bm25::Params(k1, b);
+    }
+    
+    /**
+     * @brief Get current BM25 parameters.(Used for debugging)
+    */
+    bm25::Params getBM25Params() const {
+        return bm25Params;
+    }
+
+    /**
+     * @brief Process a given query string and return ranked results.
+     * 
+     * @param queryTerms The input query string.
+     * @param mode Query mode: "and" or "or".
+     * @param topK Number of results to return.
+     * @param cache Optional batch cache providing lexicon entries and shared decoded lists.
+     * @param budget Optional deadline / postings budget; on expiry the best-so-far
+     *               Top-K is returned and budget->partial is set.
+     * @return std::vector<QueryResult> Top-K ranked results.
+     */
+    std::vector<QueryResult> processQuery(const std::vector<std::string>& queryTerms, const std::string& mode, int k,
+                                          const BatchTermCache* cache = nullptr,
+                                          QueryBudget* budget = nullptr) {
+        if (!inFeedback) {
+            feedback = FeedbackStats();
+            if (forwardIndex && feedbackOptions.enabled && feedbackOptions.docs > 0 &&
+                std::none_of(queryTerms.begin(), queryTerms.end(), wildcard::isPattern)) {
+                return processFeedback(queryTerms, mode, k, cache, budget);
+            }
+        }
+        
+        // Fetch posting lists and term metas for query terms
+        std::vector<TermMeta> metas;
+        std::vector<PostingList> lists;
+        std::vector<double> idfs;
+        std::vector<std::string> terms;
+        answeredFromTier = false;
+        pairsUsed.clear();
+        expansion = ExpansionStats();
+        corrections.clear();
+        
+        for (const auto& term : queryTerms) {
+            TermMeta meta;
+            PostingList list;
+            bool opened = false;
+            bool known = true;
+            std::string name = term;
+            if (wildcard::isPattern(term)) {
+                // union of the expansions, read as one term
+                opened = TermExpander::open(lexicon, indexDir, term, expansionOptions, expansion, meta, list);
+            } else if (cache) {
+                const BatchTermCache::Entry* entry = cache->find(term);
+                known = entry != nullptr;
+                if (entry) {
+                    meta = entry->meta;
+                    opened = entry->postings ? list.open(entry->postings) : list.open(meta, indexDir);
+                }
+            } else if (lexicon.find(term, meta)) {
+                opened = list.open(meta, indexDir);
+            } else {
+                known = false;
+            }
+            if (!known && correctTerm(term, name) &&
+                std::find(queryTerms.begin(), queryTerms.end(), name) == queryTerms.end() &&
+                std::find(terms.begin(), terms.end(), name) == terms.end() && lexicon.find(name, meta)) {
+                opened = list.open(meta, indexDir);
+            }
+            if (opened) {
+                applyFilter(list);
+                metas.push_back(meta);
+                lists.push_back(std::move(list));
+                idfs.push_back(termWeight(meta.scoringDf()));
+                terms.push_back(name);
+            }
+        }
+        
+        if (lists.empty()) {
+            return {};
+        }
+
+        std::string lowerMode = mode;
+        std::transform(lowerMode.begin(), lowerMode.end(), lowerMode.begin(),
+                    [](unsigned char c){ return std::tolower(c); });
+
+        // first stage retrieves enough candidates for the re-ranker
+        int firstK = candidateDepth(k);
+        int finalK = k;
+        k = firstK;
+
+        // Get Top-K results
+        std::priority_queue<QueryResult> topK;
+        bool useHead = tierIndex && !stats.impacts && priorWeight == 0.0 && k > 0 && expansion.patterns == 0 &&
+                       !hasSearchAfter && !filter.active();
+        std::vector<double> bounds;
+        double seed = 0.0;
+        if (useHead && lists.size() == 1 && tierIndex->matches(bm25Params.k1, bm25Params.b) &&
+            evaluateHead(terms[0], idfs[0], k, budget, topK)) {
+            answeredFromTier = true;
+        } else if (mode == "and") {
+            std::vector<double> pairIdfs;
+            if (pairIndex) planPairs(terms, metas, lists, idfs, pairIdfs);
+            topK = evaluateAND(metas, lists, idfs, k, budget, pairIdfs.empty() ? nullptr : &pairIdfs);
+        } else if (useHead && !cache && tierIndex->matches(bm25Params.k1, bm25Params.b) &&
+                   evaluateTiered(terms, metas, lists, idfs, k, budget, topK)) {
+            answeredFromTier = true;
+        } else if (useHead && headBounds(terms, idfs, k, bounds, seed)) {
+            topK = evaluateMaxScore(lists, idfs, bounds, seed, k, budget);
+        } else if (stats.impacts && priorWeight == 0.0 && k > 0) {
+            topK = evaluateBlockMax(lists, idfs, 0.0, k, budget);
+        } else {
+            topK = evaluateOR(metas, lists, idfs, k, budget);
+        }
+
+        return collectResults(topK, terms, finalK, budget);
+    }
+
+    /**
+     * @brief Process a parsed query; phrase / NEAR constraints are checked on
+     *        positions, other queries go through the bag-of-words path above.
+     *
+     * Documents must contain every constrained term (conjunctive docID filter)
+     * and satisfy every constraint; positions are decoded only for documents
+     * that pass the filter. Remaining terms add to the BM25 score if present.
+     * On an index without positions the constraints reduce to the conjunction.
+     */
+    std::vector<QueryResult> processQuery(const ParsedQuery& query, const std::string& mode, int k,
+                                          const BatchTermCache* cache = nullptr,
+                                          QueryBudget* budget = nullptr) {
+        if (query.boolean) {
+            return processBoolean(*query.boolean, mode, k, cache, budget);
+        }
+        if (!query.positional()) {
+            return processQuery(query.terms, mode, k, cache, budget);
+        }
+        answeredFromTier = false;
+        pairsUsed.clear();
+        expansion = ExpansionStats();
+        corrections.clear();
+        feedback = FeedbackStats();
+        
+        // unknown terms are replaced in the scoring terms and in the constraints
+        ParsedQuery corrected;
+        const ParsedQuery* q = &query;
+        if (fuzzyIndex && fuzzy.enabled) {
+            std::unordered_map<std::string, std::string> replaced;
+            for (const auto& term : query.terms) {
+                TermMeta meta;
+                std::string name;
+                if (!lexicon.find(term, meta) && correctTerm(term, name)) {
+                    replaced[term] = name;
+                }
+            }
+            if (!replaced.empty()) {
+                corrected = query;
+                // scoring terms stay unique; constraint terms map 1:1 so
+                // phrases keep their repeated words and positions
+                std::vector<std::string> scoring;
+                for (const auto& term : corrected.terms) {
+                    auto it = replaced.find(term);
+                    const std::string& name = it == replaced.end() ? term : it->second;
+                    if (std::find(scoring.begin(), scoring.end(), name) == scoring.end()) scoring.push_back(name);
+                }
+                corrected.terms.swap(scoring);
+                for (auto& c : corrected.constraints) {
+                    for (auto& term : c.terms) {
+                        auto it = replaced.find(term);
+                        if (it != replaced.end()) term = it->second;
+                    }
+                }
+                q = &corrected;
+            }
+        }
+        
+        int firstK = candidateDepth(k);
+        std::priority_queue<QueryResult> topK = evaluatePositional(*q, firstK, budget);
+        return collectResults(topK, q->terms, k, budget);
+    }
+
+    /**
+     * @brief Evaluate a boolean query tree; juxtaposed clauses follow mode
+     *        ("and": required, otherwise optional).
+     *
+     * The tree is compiled into nested cursors (see BooleanCursor) and the
+     * root is walked DAAT; a document scores the weighted BM25 of the
+     * non-excluded terms it contains. Unknown terms are dropped unless
+     * explicitly required (+term, AND), which makes their group empty.
+     */
+    std::vector<QueryResult> processBoolean(const BooleanNode& root, const std::string& mode, int k,
+                                            const BatchTermCache* cache = nullptr,
+                                            QueryBudget* budget = nullptr) {
+        answeredFromTier = false;
+        pairsUsed.clear();
+        expansion = ExpansionStats();
+        corrections.clear();
+        feedback = FeedbackStats();
+        
+        std::vector<std::string> terms;
+        std::unique_ptr<QueryCursor> cursor = compile(root, mode == "and", cache, terms, false);
+        
+        int firstK = candidateDepth(k);
+        std::priority_queue<QueryResult> topK;
+        if (cursor && cursor->nextGEQ(0)) {
+            do {
+                if (budget && budget->exhausted()) break;
+                uint32_t doc = cursor->doc();
+                uint32_t matched = 0;
+                double score = cursor->score(docLen.len(doc), matched);
+                if (priorWeight != 0.0) score += priorWeight * docPriors->prior(doc);
+                if (budget) budget->charge(matched);
+                
+                offer(topK, firstK, doc, score);
+            } while (cursor->next());
+        }
+        return collectResults(topK, terms, k, budget);
+    }
+
+    /**
+     * @brief Count the documents matching a query without scoring them.
+     *
+     * Lists are opened without their tfs. A single term is answered from the
+     * lexicon; AND intersects the lists smallest first with nextGEQ, so the
+     * skip table (or the Roaring containers of dense terms) jumps over
+     * everything between candidates; OR sets the docIDs in a collection-wide
+     * bitmap (dense terms OR in whole containers) and counts its bits.
+     * Boolean queries walk their compiled cursor without scoring.
+     *
+     * With approximate set, AND queries whose smallest list is long read only
+     * SAMPLE_PROBES runs of SAMPLE_RUN postings of it, spread over the docID
+     * range, and scale the matching fraction by its df; OR queries are
+     * estimated from the dfs assuming independent terms. Boolean and filtered
+     * queries are always counted exactly. On budget expiry the count so far is
+     * returned with budget->partial set.
+     */
+    MatchCount countQuery(const ParsedQuery& query, const std::string& mode, bool approximate = false,
+                          QueryBudget* budget = nullptr) {
+        answeredFromTier = false;
+        pairsUsed.clear();
+        expansion = ExpansionStats();
+        corrections.clear();
+        
+        MatchCount result;
+        if (query.positional()) {
+            result.supported = false;
+            return result;
+        }
+        
+        if (query.boolean) {
+            std::vector<std::string> terms;
+            std::unique_ptr<QueryCursor> cursor = compile(*query.boolean, mode == "and", nullptr, terms, false);
+            if (cursor && cursor->nextGEQ(0)) {
+                do {
+                    if (budget && budget->exhausted()) break;
+                    if (budget) budget->charge(1);
+                    result.count++;
+                } while (cursor->next());
+            }
+            result.postings = result.count;
+            return result;
+        }
+        
+        std::vector<TermMeta> metas;
+        std::vector<PostingList> lists;
+        for (const auto& term : query.terms) {
+            TermMeta meta;
+            PostingList list;
+            std::string name;
+            bool opened = false;
+            if (wildcard::isPattern(term)) {
+                opened = TermExpander::open(lexicon, indexDir, term, expansionOptions, expansion, meta, list);
+            } else if (lexicon.find(term, meta) || (correctTerm(term, name) && lexicon.find(name, meta))) {
+                opened = list.open(meta, indexDir, false);
+            }
+            if (opened) {
+                applyFilter(list);
+                metas.push_back(meta);
+                lists.push_back(std::move(list));
+            } else if (mode == "and") {
+                return result;   // an unknown term matches nothing
+            }
+        }
+        
+        if (lists.empty()) return result;
+        if (filter.active()) {
+            approximate = false;   // dfs and samples do not reflect the filter
+        } else if (lists.size() == 1) {
+            result.count = metas[0].df;
+            return result;
+        }
+        if (mode == "and" && lists.size() > 1) {
+            // a list the filter emptied matches nothing
+            if (std::any_of(lists.begin(), lists.end(), [](const PostingList& l) { return !l.valid(); })) {
+                return result;
+            }
+            std::vector<size_t> order(lists.size());
+            for (size_t i = 0; i < order.size(); i++) order[i] = i;
+            std::sort(order.begin(), order.end(), [&metas](size_t a, size_t b) { return metas[a].df < metas[b].df; });
+            std::vector<PostingList> sorted;
+            for (size_t i : order) sorted.push_back(std::move(lists[i]));
+            
+            if (approximate && sorted[0].size() > SAMPLE_PROBES * SAMPLE_RUN) {
+                estimateAND(sorted, result);
+            } else {
+                countAND(sorted, result, budget);
+            }
+        } else if (approximate) {
+            // P(no term) under independence, bounded by the exact extremes
+            double N = static_cast<double>(std::max<uint64_t>(stats.doc_count, 1));
+            double none = 1.0;
+            uint64_t largest = 0, sum = 0;
+            for (const auto& meta : metas) {
+                none *= 1.0 - std::min(1.0, meta.df / N);
+                largest = std::max<uint64_t>(largest, meta.df);
+                sum += meta.df;
+            }
+            uint64_t estimate = static_cast<uint64_t>(std::llround(N * (1.0 - none)));
+            result.count = std::min(std::max(estimate, largest), sum);
+            result.exact = false;
+        } else {
+            countOR(lists, result, budget);
+        }
+        return result;
+    }
+
+
+private:
+    // approximate AND counting: probes over the docID range x postings per probe
+    static constexpr uint32_t SAMPLE_PROBES = 16;
+    static constexpr uint32_t SAMPLE_RUN = 128;
+    
+    // lists sorted by df ascending
+    void countAND(std::vector<PostingList>& lists, MatchCount& result, QueryBudget* budget) {
+        if (lists.size() == 2 && lists[0].denseSet() && lists[1].denseSet()) {
+            result.count = RoaringPostings::andCount(*lists[0].denseSet(), *lists[1].denseSet());
+            result.postings = lists[0].size() + lists[1].size();
+            return;
+        }
+        
+        PostingList& lead = lists[0];
+        uint32_t target = lead.doc();
+        size_t i = 1;
+        while (true) {
+            if (budget && budget->exhausted()) return;
+            if (i == lists.size()) {
+                // every list is on target
+                result.count++;
+                if (!lead.next()) return;
+                target = lead.doc();
+                i = 1;
+                continue;
+            }
+            result.postings++;
+            if (budget) budget->charge(1);
+            if (!lists[i].nextGEQ(target)) return;
+            if (lists[i].doc() == target) {
+                i++;
+                continue;
+            }
+            // overshoot: move the lead and restart the round
+            if (!lead.nextGEQ(lists[i].doc())) return;
+            target = lead.doc();
+            i = 1;
+        }
+    }
+    
+    void estimateAND(std::vector<PostingList>& lists, MatchCount& result) {
+        PostingList& lead = lists[0];
+        uint64_t N = std::max<uint64_t>(stats.doc_count, 1);
+        uint64_t sampled = 0, matched = 0;
+        for (uint32_t probe = 0; probe < SAMPLE_PROBES && lead.valid(); probe++) {
+            uint32_t start = static_cast<uint32_t>(N * probe / SAMPLE_PROBES);
+            if (!lead.nextGEQ(start)) break;
+            for (uint32_t n = 0; n < SAMPLE_RUN; n++) {
+                uint32_t doc = lead.doc();
+                bool all = true;
+                for (size_t i = 1; i < lists.size() && all; i++) {
+                    all = lists[i].valid() && lists[i].nextGEQ(doc) && lists[i].doc() == doc;
+                }
+                sampled++;
+                matched += all;
+                if (!lead.next()) break;
+            }
+        }
+        result.postings = sampled * lists.size();
+        result.count = sampled ? static_cast<uint64_t>(std::llround(
+            static_cast<double>(matched) / sampled * lists[0].size())) : 0;
+        result.exact = false;
+    }
+    
+    void countOR(std::vector<PostingList>& lists, MatchCount& result, QueryBudget* budget) {
+        std::vector<uint64_t> bits(stats.doc_count / 64 + 1, 0);
+        for (auto& list : lists) {
+            if (const RoaringPostings* set = list.denseSet()) {
+                set->orInto(bits.data(), bits.size());
+                result.postings += set->cardinality();
+                continue;
+            }
+            for (; list.valid(); list.next()) {
+                if (budget && budget->exhausted()) break;
+                uint32_t doc = list.doc();
+                if (doc / 64 >= bits.size()) bits.resize(doc / 64 + 1, 0);
+                bits[doc / 64] |= 1ULL << (doc % 64);
+                result.postings++;
+                if (budget) budget->charge(1);
+            }
+        }
+        for (uint64_t word : bits) result.count += popcount64(word);
+    }
+
+    /**
+     * @brief Build the cursor of a boolean (sub)query; nullptr if it can
+     *        match nothing. Scoring terms are appended to terms.
+    */
+    std::unique_ptr<QueryCursor> compile(const BooleanNode& node, bool defaultAnd,
+                                         const BatchTermCache* cache,
+                                         std::vector<std::string>& terms, bool excluded) {
+        if (node.leaf()) {
+            TermMeta meta;
+            PostingList list;
+            std::string name = node.term;
+            bool opened = false;
+            if (wildcard::isPattern(node.term)) {
+                opened = TermExpander::open(lexicon, indexDir, node.term, expansionOptions, expansion, meta, list);
+            } else if (const BatchTermCache::Entry* entry = cache ? cache->find(node.term) : nullptr) {
+                meta = entry->meta;
+                opened = entry->postings ? list.open(entry->postings) : list.open(meta, indexDir);
+            } else if (lexicon.find(node.term, meta) ||
+                       (!excluded && correctTerm(node.term, name) && lexicon.find(name, meta))) {
+                opened = list.open(meta, indexDir);
+            }
+            if (!opened) return nullptr;
+            applyFilter(list);
+            if (!excluded && std::find(terms.begin(), terms.end(), name) == terms.end()) terms.push_back(name);
+            return std::make_unique<TermCursor>(std::move(list), meta.scoringDf(), stats.doc_count, stats.avgdl,
+                                                bm25Params, node.weight, stats.impacts);
+        }
+        
+        std::vector<std::unique_ptr<QueryCursor>> must, should, mustNot;
+        for (const auto& clause : node.clauses) {
+            BooleanClause::Occur occur = clause.occur;
+            if (occur == BooleanClause::DEFAULT) occur = defaultAnd ? BooleanClause::MUST : BooleanClause::SHOULD;
+            bool negated = excluded || occur == BooleanClause::MUST_NOT;
+            auto child = compile(clause.node, defaultAnd, cache, terms, negated);
+            if (!child) {
+                // an explicitly required clause that cannot match empties the group
+                if (clause.occur == BooleanClause::MUST) return nullptr;
+                continue;
+            }
+            if (occur == BooleanClause::MUST) {
+                must.push_back(std::move(child));
+            } else if (occur == BooleanClause::SHOULD) {
+                should.push_back(std::move(child));
+            } else {
+                mustNot.push_back(std::move(child));
+            }
+        }
+        if (must.empty() && should.empty()) return nullptr;
+        return std::make_unique<BooleanCursor>(std::move(must), std::move(should), std::move(mustNot), node.weight);
+    }
+
+    /**
+     * @brief RM3 evaluation of a bag-of-words query, in three timed stages.
+     *
+     * 1. The original query (in `mode`, without re-ranking or a search-after
+     *    bound) retrieves the top feedbackOptions.docs documents.
+     * 2. Their forward-index vectors are read in one batch and RelevanceModel
+     *    picks the expansion terms and the weights of the mixed query.
+     * 3. The weighted query is evaluated disjunctively: a term's weight scales
+     *    its idf, so MaxScore's bounds stay safe, and the feedback documents'
+     *    exact scores (computed from their vectors) seed the threshold. With a
+     *    prior weight the plain DAAT OR is used, since the bounds ignore priors.
+     * If the first pass runs out of budget or finds nothing, its results are
+     * returned.
+    */
+    std::vector<QueryResult> processFeedback(const std::vector<std::string>& queryTerms, const std::string& mode,
+                                             int k, const BatchTermCache* cache, QueryBudget* budget) {
+        using Clock = std::chrono::steady_clock;
+        auto elapsedMs = [](Clock::time_point from) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - from).count();
+        };
+        
+        auto start = Clock::now();
+        size_t rerankDepth = rerank.depth;
+        bool searchAfter = hasSearchAfter;
+        rerank.depth = 0;
+        hasSearchAfter = false;
+        inFeedback = true;
+        std::vector<QueryResult> firstPass = processQuery(queryTerms, mode, static_cast<int>(feedbackOptions.docs),
+                                                          cache, budget);
+        inFeedback = false;
+        rerank.depth = rerankDepth;
+        hasSearchAfter = searchAfter;
+        feedback.firstPassMs = elapsedMs(start);
+        if (firstPass.empty() || (budget && budget->partial)) {
+            if (firstPass.size() > static_cast<size_t>(std::max(k, 0))) {
+                firstPass.erase(firstPass.begin() + std::max(k, 0), firstPass.end());
+            }
+            return firstPass;
+        }
+        
+        // the first pass's corrections apply to the expanded query too
+        std::vector<std::string> original = queryTerms;
+        for (const auto& c : corrections) {
+            std::replace(original.begin(), original.end(), c.original, c.term);
+        }
+        
+        auto selection = Clock::now();
+        std::vector<uint32_t> docIDs;     // first-pass results carry external docIDs, as the forward index
+        std::vector<double> scores;
+        for (const auto& r : firstPass) {
+            docIDs.push_back(r.docID);
+            scores.push_back(r.score);
+        }
+        std::vector<DocVector> vectors = forwardIndex->getBatch(docIDs);
+        std::vector<FeedbackTerm> expanded = RelevanceModel::expand(*forwardIndex, original, vectors, scores,
+                                                                    feedbackOptions, feedbackTerms, feedback);
+        feedback.feedbackDocs = firstPass.size();
+        feedback.selectionMs = elapsedMs(selection);
+        
+        auto second = Clock::now();
+        std::vector<TermMeta> metas;
+        std::vector<PostingList> lists;
+        std::vector<double> idfs;          // weight * idf
+        std::vector<uint32_t> termIDs;     // forward-index IDs, for the seed scores
+        for (const auto& t : expanded) {
+            TermMeta meta;
+            PostingList list;
+            const BatchTermCache::Entry* entry = cache ? cache->find(t.term) : nullptr;
+            bool opened = false;
+            if (entry) {
+                meta = entry->meta;
+                opened = entry->postings ? list.open(entry->postings) : list.open(meta, indexDir);
+            } else if (lexicon.find(t.term, meta)) {
+                opened = list.open(meta, indexDir);
+            }
+            uint32_t termID;
+            if (!opened || !forwardIndex->termID(t.term, termID)) continue;
+            applyFilter(list);
+            metas.push_back(meta);
+            lists.push_back(std::move(list));
+            idfs.push_back(t.weight * termWeight(meta.scoringDf()));
+            termIDs.push_back(termID);
+            feedback.terms.push_back(t);
+        }
+        feedback.applied = true;
+        answeredFromTier = false;
+        
+        int firstK = candidateDepth(k);
+        std::priority_queue<QueryResult> topK;
+        if (priorWeight != 0.0) {
+            topK = evaluateOR(metas, lists, idfs, firstK, budget);
+        } else {
+            std::vector<double> bounds;
+            if (!stats.impacts) {
+                for (double idf : idfs) bounds.push_back(idf * (bm25Params.k1 + 1.0) * (1.0 + 1e-9));
+            }
+            
+            // the k-th best expanded score among the feedback documents
+            double seed = 0.0;
+            if (!hasSearchAfter && vectors.size() >= static_cast<size_t>(firstK) && firstK > 0) {
+                std::vector<double> exact;
+                for (const auto& v : vectors) {
+                    uint32_t doc = (docPriors && docPriors->reordered()) ? docPriors->toInternal(v.docID) : v.docID;
+                    uint32_t dl = docLen.len(doc);
+                    double score = 0.0;
+                    for (size_t i = 0; i < termIDs.size(); i++) {
+                        auto it = std::lower_bound(v.termIDs.begin(), v.termIDs.end(), termIDs[i]);
+                        if (it == v.termIDs.end() || *it != termIDs[i]) continue;
+                        score += termScore(idfs[i], v.freqs[it - v.termIDs.begin()], dl);
+                    }
+                    exact.push_back(score);
+                }
+                std::nth_element(exact.begin(), exact.begin() + (firstK - 1), exact.end(), std::greater<double>());
+                seed = exact[firstK - 1] * (1.0 - 1e-9);
+            }
+            topK = stats.impacts ? evaluateBlockMax(lists, idfs, seed, firstK, budget)
+                                 : evaluateMaxScore(lists, idfs, bounds, seed, firstK, budget);
+        }
+        std::vector<QueryResult> results = collectResults(topK, original, k, budget);
+        feedback.secondPassMs = elapsedMs(second);
+        return results;
+    }
+
+    // closest dictionary term for an unknown term (recorded in corrections)
+    bool correctTerm(const std::string& term, std::string& replacement) {
+        if (!fuzzyIndex || !fuzzy.enabled || wildcard::isPattern(term)) return false;
+        FuzzyMatch match;
+        if (!fuzzyIndex->bestMatch(term, fuzzy, match)) return false;
+        replacement = match.term;
+        corrections.push_back(match);
+        return true;
+    }
 
-    bm25::Params bm25Params;
-    std::ifstream docidsFile;
-    std::ifstream freqsFile;
+    // whether a result comes after the search-after bound
+    bool afterBound(uint32_t doc, double score) const {
+        double tolerance = 1e-9 * std::max(1.0, std::abs(afterScore));
+        if (score < afterScore - tolerance) return true;
+        return score <= afterScore + tolerance && doc > afterDoc;
+    }
+    
+    // score contribution of a posting: BM25, or weight * impact on an impact-scored index
+    double termScore(double weight, uint32_t tf, uint32_t dl) const {
+        if (stats.impacts) return weight * tf;
+        return bm25::score(weight, tf, dl, stats.avgdl, bm25Params);
+    }
+    
+    // query-independent weight of a term: its idf, or 1 on an impact-scored index
+    double termWeight(uint32_t df) const {
+        return stats.impacts ? 1.0 : bm25::idf(stats.doc_count, df);
+    }
+    
+    // add a candidate to the top-k min-heap
+    void offer(std::priority_queue<QueryResult>& topK, int k, uint32_t doc, double score) const {
+        if (hasSearchAfter && !afterBound(doc, score)) return;
+        if (topK.size() < static_cast<size_t>(k)) {
+            topK.push(QueryResult(doc, score));
+        } else if (QueryResult(doc, score) < topK.top()) {
+            topK.pop();
+            topK.push(QueryResult(doc, score));
+        }
+    }
 
+    // drain the min-heap into result order, run the second
+    // stage, keep the top k and map docIDs for the caller
+    std::vector<QueryResult> collectResults(std::priority_queue<QueryResult>& topK,
+                                            const std::vector<std::string>& terms, int k,
+                                            QueryBudget* budget) {
+        std::vector<QueryResult> results;
+        while (!topK.empty()) {
+            results.push_back(topK.top());
+            topK.pop();
+        }
+        std::sort(results.begin(), results.end());
+        
+        // the second stage is skipped once the budget has run out
+        bool overBudget = budget && (budget->partial ||
+            (budget->hasDeadline && QueryBudget::Clock::now() >= budget->deadline));
+        features.reset(0);
+        featureDocs.clear();
+        if (rerank.depth > 0 && !overBudget) {
+            rerankCandidates(results, terms);
+        }
+        collapsed = 0;
+        if (collapseDepth > 0) collapseDuplicates(results);
+        if (results.size() > static_cast<size_t>(std::max(k, 0))) {
+            results.erase(results.begin() + std::max(k, 0), results.end());
+        }
+        
+        if (docPriors && docPriors->reordered()) {
+            for (auto& r : results) r.docID = docPriors->toExternal(r.docID);
+            for (auto& d : featureDocs) d = docPriors->toExternal(d);
+        }
+        
+        return results;
+    }
 
-public:
-    /**
-     * @brief Constructor that initializes all references and opens posting files.
-    */
-    QueryEvaluator(Lexicon& lex, Stats& st, DocLen& dl, DocTable& dt, DocContentFile& dc,
-                   const std::string& indexDir, bm25::Params params)
-        : lexicon(lex), stats(st), docLen(dl), docTable(dt), docContent(dc), 
-        indexDir(indexDir), bm25Params(params) {}
+    // restrict a freshly opened list to the documents passing the filter
+    void applyFilter(PostingList& list) const {
+        if (filter.active()) list.setFilter(&filter);
+    }
 
-    /**
-     * @brief Update BM25 parameters k1 and b.
-    */
-    void updateBM25Params(double k1, double b) {
-        bm25Params = bm25::Params(k1, b);
+    // first-stage depth: the re-ranker and collapsing look past the top k
+    int candidateDepth(int k) const {
+        size_t depth = std::max(rerank.depth, collapseDepth);
+        return depth > 0 ? std::max(k, static_cast<int>(depth)) : k;
     }
     
+    // keep the first (best) result of each near-duplicate cluster
+    void collapseDuplicates(std::vector<QueryResult>& results) {
+        bool reordered = docPriors && docPriors->reordered();
+        std::unordered_set<uint32_t> seen;
+        size_t kept = 0;
+        for (size_t i = 0; i < results.size(); i++) {
+            uint32_t doc = reordered ? docPriors->toExternal(results[i].docID) : results[i].docID;
+            if (!seen.insert(docClusters->canonical(doc)).second) continue;
+            results[kept++] = results[i];
+        }
+        collapsed = results.size() - kept;
+        results.erase(results.begin() + kept, results.end());
+    }
+
     /**
-     * @brief Get current BM25 parameters.(Used for debugging)
+     * @brief Second stage: extract features for the top `depth` results, score
+     *        them with the model and re-sort them.
     */
-    bm25::Params getBM25Params() const {
-        return bm25Params;
+    void rerankCandidates(std::vector<QueryResult>& results, const std::vector<std::string>& terms) {
+        size_t depth = std::min(results.size(), rerank.depth);
+        if (depth == 0) return;
+        const Reranker& model = rerank.model ? *rerank.model : *defaultModel;
+        
+        extractFeatures(results, depth, terms,
+                        model.uses(features::TERM_PAIR) || model.uses(features::SPAN));
+        
+        std::vector<double> scores;
+        model.score(features, scores);
+        for (size_t i = 0; i < depth; i++) results[i].score = scores[i];
+        
+        std::stable_sort(results.begin(), results.begin() + depth,
+                         [](const QueryResult& a, const QueryResult& b) { return a.score > b.score; });
     }
 
     /**
-     * @brief Process a given query string and return ranked results.
-     * 
-     * @param queryTerms The input query string.
-     * @param mode Query mode: "and" or "or".
-     * @param topK Number of results to return.
-     * @return std::vector<QueryResult> Top-K ranked results.
-     */
-    std::vector<QueryResult> processQuery(const std::vector<std::string>& queryTerms, const std::string& mode, int k) {
-        // Fetch posting lists and term metas for query terms
-        std::vector<TermMeta> metas;
-        std::vector<PostingList> lists;
-        std::vector<double> idfs;
+     * @brief Fill one feature row per candidate (rows in first-stage order).
+     *        Candidates are visited in docID order so each term's posting list
+     *        is traversed forward once with nextGEQ.
+    */
+    void extractFeatures(const std::vector<QueryResult>& results, size_t depth,
+                         const std::vector<std::string>& terms, bool needPositions) {
+        features.reset(depth);
+        featureDocs.resize(depth);
         
-        for (const auto& term : queryTerms) {
+        std::vector<PostingList> lists(terms.size());
+        std::vector<double> idfs(terms.size(), 0.0);
+        size_t withPositions = 0;
+        for (size_t i = 0; i < terms.size(); i++) {
             TermMeta meta;
-            if (lexicon.find(term, meta)) {
-                PostingList list;
-                if (list.open(meta, indexDir)) {
-                    metas.push_back(meta);
-                    lists.push_back(std::move(list));
-                    idfs.push_back(bm25::idf(stats.doc_count, meta.df));
-                }
+            if (lexicon.find(terms[i], meta) && lists[i].open(meta, indexDir)) {
+                idfs[i] = termWeight(meta.scoringDf());
+                if (lists[i].hasPositions()) withPositions++;
+            } else {
+                lists[i] = PostingList();
             }
         }
+        needPositions = needPositions && withPositions >= 2;
         
-        if (lists.empty()) {
-            return {};
+        std::vector<size_t> order(depth);
+        for (size_t i = 0; i < depth; i++) order[i] = i;
+        std::sort(order.begin(), order.end(),
+                  [&results](size_t a, size_t b) { return results[a].docID < results[b].docID; });
+        
+        std::vector<std::vector<uint32_t>> positions(terms.size());
+        for (size_t idx : order) {
+            uint32_t doc = results[idx].docID;
+            uint32_t dl = docLen.len(doc);
+            float* row = features.row(idx);
+            featureDocs[idx] = doc;
+            
+            double maxTerm = 0.0, minTerm = 0.0;
+            size_t matched = 0;
+            for (size_t i = 0; i < lists.size(); i++) {
+                positions[i].clear();
+                if (!lists[i].valid() || !lists[i].nextGEQ(doc) || lists[i].doc() != doc) continue;
+                double s = termScore(idfs[i], lists[i].freq(), dl);
+                maxTerm = matched == 0 ? s : std::max(maxTerm, s);
+                minTerm = matched == 0 ? s : std::min(minTerm, s);
+                matched++;
+                if (needPositions && lists[i].hasPositions()) lists[i].positions(positions[i]);
+            }
+            
+            row[features::BM25] = static_cast<float>(results[idx].score);
+            row[features::BM25_MAX] = static_cast<float>(maxTerm);
+            row[features::BM25_MIN] = static_cast<float>(minTerm);
+            row[features::MATCHED] = terms.empty() ? 0.0f : static_cast<float>(matched) / terms.size();
+            row[features::DOC_LEN] = static_cast<float>(std::log1p(static_cast<double>(dl)));
+            row[features::PRIOR] = docPriors ? docPriors->prior(doc) : 0.0f;
+            row[features::QUERY_LEN] = static_cast<float>(terms.size());
+            if (needPositions) {
+                double K = bm25Params.k1 * (1.0 - bm25Params.b + bm25Params.b * dl / stats.avgdl);
+                row[features::TERM_PAIR] = static_cast<float>(
+                    ProximityScorer::termPair(positions, idfs, rerank.window, bm25Params.k1, K));
+                row[features::SPAN] = static_cast<float>(ProximityScorer::span(positions));
+            }
         }
+    }
 
-        std::string lowerMode = mode;
-        std::transform(lowerMode.begin(), lowerMode.end(), lowerMode.begin(),
-                    [](unsigned char c){ return std::tolower(c); });
+    // phrase: positions p, p+1, ... in term order
+    static bool matchPhrase(const std::vector<const std::vector<uint32_t>*>& positions) {
+        for (uint32_t start : *positions[0]) {
+            bool match = true;
+            for (size_t i = 1; i < positions.size() && match; i++) {
+                match = std::binary_search(positions[i]->begin(), positions[i]->end(),
+                                           start + static_cast<uint32_t>(i));
+            }
+            if (match) return true;
+        }
+        return false;
+    }
 
-        // Get Top-K results
+    // NEAR/k: smallest span covering one occurrence of every term is <= window
+    static bool matchWindow(const std::vector<const std::vector<uint32_t>*>& positions, uint32_t window) {
+        std::vector<size_t> idx(positions.size(), 0);
+        while (true) {
+            size_t minList = 0;
+            uint32_t lo = UINT32_MAX;
+            uint32_t hi = 0;
+            for (size_t i = 0; i < positions.size(); i++) {
+                uint32_t p = (*positions[i])[idx[i]];
+                if (p < lo) {
+                    lo = p;
+                    minList = i;
+                }
+                hi = std::max(hi, p);
+            }
+            if (hi - lo <= window) return true;
+            if (++idx[minList] >= positions[minList]->size()) return false;
+        }
+    }
+
+    /**
+     * @brief Conjunctive evaluation with lazy position checks (see processQuery).
+    */
+    std::priority_queue<QueryResult> evaluatePositional(const ParsedQuery& query, int k, QueryBudget* budget) {
         std::priority_queue<QueryResult> topK;
-        if (mode == "and") {
-            topK = evaluateAND(metas, lists, idfs, k);
-        } else {
-            topK = evaluateOR(metas, lists, idfs, k);
+        
+        // required lists: every term of a constraint; optional: the rest
+        std::vector<std::string> required;
+        for (const auto& c : query.constraints) {
+            for (const auto& term : c.terms) {
+                if (std::find(required.begin(), required.end(), term) == required.end()) {
+                    required.push_back(term);
+                }
+            }
+        }
+        
+        std::vector<PostingList> lists;
+        std::vector<double> idfs;
+        lists.reserve(query.terms.size());
+        for (const auto& term : required) {
+            TermMeta meta;
+            PostingList list;
+            if (!lexicon.find(term, meta) || !list.open(meta, indexDir)) return topK;
+            applyFilter(list);
+            lists.push_back(std::move(list));
+            idfs.push_back(termWeight(meta.scoringDf()));
+        }
+        size_t requiredCount = lists.size();
+        for (const auto& term : query.terms) {
+            if (std::find(required.begin(), required.end(), term) != required.end()) continue;
+            TermMeta meta;
+            PostingList list;
+            if (lexicon.find(term, meta) && list.open(meta, indexDir)) {
+                applyFilter(list);
+                lists.push_back(std::move(list));
+                idfs.push_back(termWeight(meta.scoringDf()));
+            }
+        }
+        
+        // constraint terms as indexes into the required lists
+        std::vector<std::vector<size_t>> constraintLists;
+        for (const auto& c : query.constraints) {
+            std::vector<size_t> ids;
+            for (const auto& term : c.terms) {
+                ids.push_back(std::find(required.begin(), required.end(), term) - required.begin());
+            }
+            constraintLists.push_back(ids);
+        }
+        
+        bool usePositions = true;
+        for (size_t i = 0; i < requiredCount; i++) usePositions = usePositions && lists[i].hasPositions();
+        
+        std::vector<std::vector<uint32_t>> positions(requiredCount);
+        std::vector<bool> decoded(requiredCount);
+        std::vector<const std::vector<uint32_t>*> group;
+        
+        while (true) {
+            if (budget && budget->exhausted()) break;
+            
+            // align the required lists on one docID
+            uint32_t doc = lists[0].doc();
+            bool aligned = false;
+            bool exhausted = false;
+            while (!aligned && !exhausted) {
+                aligned = true;
+                for (size_t i = 0; i < requiredCount; i++) {
+                    if (!lists[i].nextGEQ(doc)) {
+                        exhausted = true;
+                        break;
+                    }
+                    if (lists[i].doc() != doc) {
+                        doc = lists[i].doc();
+                        aligned = false;
+                        break;
+                    }
+                }
+            }
+            if (exhausted) break;
+            
+            // positional check, decoding each list's positions at most once
+            bool match = true;
+            if (usePositions) {
+                std::fill(decoded.begin(), decoded.end(), false);
+                for (size_t c = 0; c < constraintLists.size() && match; c++) {
+                    group.clear();
+                    for (size_t id : constraintLists[c]) {
+                        if (!decoded[id]) {
+                            lists[id].positions(positions[id]);
+                            decoded[id] = true;
+                        }
+                        if (positions[id].empty()) {
+                            match = false;
+                            break;
+                        }
+                        group.push_back(&positions[id]);
+                    }
+                    if (match) {
+                        const PositionalConstraint& pc = query.constraints[c];
+                        match = pc.phrase ? matchPhrase(group) : matchWindow(group, pc.window);
+                    }
+                }
+            }
+            
+            if (match) {
+                double score = 0.0;
+                uint32_t dl = docLen.len(doc);
+                uint32_t matched = 0;
+                for (size_t i = 0; i < lists.size(); i++) {
+                    if (i >= requiredCount && !(lists[i].nextGEQ(doc) && lists[i].doc() == doc)) continue;
+                    score += termScore(idfs[i], lists[i].freq(), dl);
+                    matched++;
+                }
+                if (priorWeight != 0.0) score += priorWeight * docPriors->prior(doc);
+                if (budget) budget->charge(matched);
+                
+                offer(topK, k, doc, score);
+            } else if (budget) {
+                budget->charge(static_cast<uint32_t>(requiredCount));
+            }
+            
+            if (!lists[0].next()) break;
         }
+        return topK;
+    }
 
-        // Extract results from min-heap
-        std::vector<QueryResult> results;
-        while (!topK.empty()) {
-            results.push_back(topK.top());
-            topK.pop();
+    /**
+     * @brief Evaluate an OR query on tier 1, proving the result safe.
+     *
+     * 1. DAAT OR over the tier-1 lists (full lists for untiered terms); each
+     *    candidate gets a lower bound (its tier-1 score) and the set of terms seen.
+     * 2. theta0 = k-th best lower bound. A candidate's upper bound adds the tail
+     *    bound of every term it was not seen in; those below theta0 are dropped.
+     * 3. The remaining candidates are scored exactly by probing the full lists
+     *    with nextGEQ (skip table), giving the final top-k and its threshold theta.
+     * 4. A document missing from every tier-1 list scores at most the sum of the
+     *    tail bounds; if that is below theta the top-k equals the full evaluation.
+     *
+     * @return false if safety cannot be proven (caller falls back to full lists).
+    */
+    bool evaluateTiered(const std::vector<std::string>& terms,
+                        std::vector<TermMeta>& metas,
+                        std::vector<PostingList>& lists,
+                        std::vector<double>& idfs,
+                        int k,
+                        QueryBudget* budget,
+                        std::priority_queue<QueryResult>& topK) {
+        size_t n = lists.size();
+        if (n > 64) return false;
+        
+        std::vector<TermMeta> tierMetas(n);
+        std::vector<double> tailBound(n, 0.0);
+        std::vector<bool> tiered(n, false);
+        bool anyTiered = false;
+        for (size_t i = 0; i < n; i++) {
+            if (tierIndex->find(terms[i], tierMetas[i], tailBound[i])) {
+                tiered[i] = anyTiered = true;
+            }
         }
-        std::reverse(results.begin(), results.end());
+        if (!anyTiered) return false;
         
-        return results;
+        // tier-1 cursors: tier lists for tiered terms, the (short) full list otherwise
+        std::vector<PostingList> tierLists(n);
+        std::vector<PostingList*> cursors(n);
+        std::vector<bool> consumed(n, false);
+        for (size_t i = 0; i < n; i++) {
+            if (tiered[i]) {
+                if (!tierLists[i].open(tierMetas[i], tierIndex->directory())) return false;
+                cursors[i] = &tierLists[i];
+            } else {
+                cursors[i] = &lists[i];
+                consumed[i] = true;
+            }
+        }
+        
+        // the caller evaluates the full lists on failure: rewind what was used here
+        auto fallBack = [&]() {
+            for (size_t i = 0; i < n; i++) {
+                if (!consumed[i]) continue;
+                lists[i] = PostingList();
+                lists[i].open(metas[i], indexDir);
+            }
+            topK = std::priority_queue<QueryResult>();
+            return false;
+        };
+        
+        struct Candidate {
+            uint32_t docID;
+            double lower;
+            double upper;
+            uint64_t seen;
+        };
+        std::vector<Candidate> candidates;
+        std::vector<uint32_t> tfs;        // n tier-1 tfs per candidate (0 = not seen)
+        
+        // 1. DAAT OR over tier 1
+        while (true) {
+            if (budget && budget->exhausted()) return fallBack();
+            
+            uint32_t minDoc = UINT32_MAX;
+            for (size_t i = 0; i < n; i++) {
+                if (cursors[i]->valid() && cursors[i]->doc() < minDoc) {
+                    minDoc = cursors[i]->doc();
+                }
+            }
+            if (minDoc == UINT32_MAX) break;
+            
+            Candidate c{minDoc, 0.0, 0.0, 0};
+            uint32_t dl = docLen.len(minDoc);
+            uint32_t matched = 0;
+            for (size_t i = 0; i < n; i++) {
+                uint32_t tf = 0;
+                if (cursors[i]->valid() && cursors[i]->doc() == minDoc) {
+                    tf = cursors[i]->freq();
+                    c.lower += termScore(idfs[i], tf, dl);
+                    c.seen |= (1ULL << i);
+                    cursors[i]->next();
+                    matched++;
+                } else {
+                    c.upper += tailBound[i];
+                }
+                tfs.push_back(tf);
+            }
+            c.upper += c.lower;
+            if (budget) budget->charge(matched);
+            candidates.push_back(c);
+        }
+        
+        double unseenBound = 0.0;
+        for (double t : tailBound) unseenBound += t;
+        if (candidates.size() < static_cast<size_t>(k)) return fallBack();
+        
+        // 2. theta0 from lower bounds; give up early if even the k-th best
+        //    upper bound cannot beat an unseen document
+        std::vector<double> bounds;
+        bounds.reserve(candidates.size());
+        for (const auto& c : candidates) bounds.push_back(c.upper);
+        std::nth_element(bounds.begin(), bounds.begin() + (k - 1), bounds.end(), std::greater<double>());
+        if (unseenBound >= bounds[k - 1]) return fallBack();
+        
+        bounds.clear();
+        for (const auto& c : candidates) bounds.push_back(c.lower);
+        std::nth_element(bounds.begin(), bounds.begin() + (k - 1), bounds.end(), std::greater<double>());
+        double theta0 = bounds[k - 1];
+        if (unseenBound >= theta0) return fallBack();
+        
+        // 3. exact scores for candidates that can still reach theta0 (docID order);
+        //    only tiered terms the candidate was not seen in are probed
+        for (size_t c = 0; c < candidates.size(); c++) {
+            const Candidate& cand = candidates[c];
+            if (cand.upper < theta0) continue;
+            
+            double score = 0.0;
+            uint32_t dl = docLen.len(cand.docID);
+            for (size_t i = 0; i < n; i++) {
+                uint32_t tf = tfs[c * n + i];
+                if (tf == 0 && tiered[i] && tailBound[i] > 0.0) {
+                    consumed[i] = true;
+                    if (lists[i].nextGEQ(cand.docID) && lists[i].doc() == cand.docID) {
+                        tf = lists[i].freq();
+                        if (budget) budget->charge(1);
+                    }
+                }
+                if (tf > 0) score += termScore(idfs[i], tf, dl);
+            }
+            
+            offer(topK, k, cand.docID, score);
+        }
+        
+        // 4. safe only if no unseen document can enter the top-k
+        if (topK.size() < static_cast<size_t>(k) || unseenBound >= topK.top().score) {
+            return fallBack();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Impacts of a term's tier-1 list, scored with the query's k1/b.
+     *
+     * The tier holds the term's highest-impact postings at the tier's k1/b
+     * (merger --tiers=N: top N for every term with df > N), i.e. a
+     * precomputed top-N result list for the single-term query.
+     * @return false if the term has no tier-1 list.
+    */
+    bool headImpacts(const std::string& term, double idf, std::vector<uint32_t>& docIDs,
+                     std::vector<double>& impacts, double& tailBound) const {
+        TermMeta meta;
+        if (!tierIndex->find(term, meta, tailBound)) return false;
+        auto head = PostingList::decodeAll(meta, tierIndex->directory());
+        if (!head) return false;
+        docIDs = head->docIDs;
+        impacts.resize(docIDs.size());
+        for (size_t i = 0; i < docIDs.size(); i++) {
+            impacts[i] = termScore(idf, head->freqs[i], docLen.len(docIDs[i]));
+        }
+        return true;
+    }
+    
+    /**
+     * @brief Answer a single-term query from its precomputed top list.
+     * @return false if the list is shorter than k or its k-th impact does not
+     *         beat every posting left in the tail (ties): use the full list.
+    */
+    bool evaluateHead(const std::string& term, double idf, int k, QueryBudget* budget,
+                      std::priority_queue<QueryResult>& topK) {
+        std::vector<uint32_t> docIDs;
+        std::vector<double> impacts;
+        double tailBound;
+        if (!headImpacts(term, idf, docIDs, impacts, tailBound)) return false;
+        if (impacts.size() < static_cast<size_t>(k)) return false;
+        
+        std::vector<double> sorted = impacts;
+        std::nth_element(sorted.begin(), sorted.begin() + (k - 1), sorted.end(), std::greater<double>());
+        if (sorted[k - 1] <= tailBound) return false;
+        
+        for (size_t i = 0; i < docIDs.size(); i++) {
+            offer(topK, k, docIDs[i], impacts[i]);
+        }
+        if (budget) budget->charge(static_cast<uint32_t>(docIDs.size()));
+        return true;
+    }
+    
+    /**
+     * @brief Score upper bounds per term and an initial threshold for an OR
+     *        query, from the terms' precomputed top lists.
+     *
+     * The k-th best impact of any term's top list is a lower bound on the
+     * k-th best OR score (those k documents score at least that much), so it
+     * seeds the pruning threshold before the first document is scored. A
+     * tiered term's bound is its top impact when the tier matches k1/b;
+     * otherwise BM25's limit idf * (k1 + 1) is used.
+     * @return false if no query term has a top list.
+    */
+    bool headBounds(const std::vector<std::string>& terms, const std::vector<double>& idfs, int k,
+                    std::vector<double>& bounds, double& seed) const {
+        bool matches = tierIndex->matches(bm25Params.k1, bm25Params.b);
+        bool any = false;
+        bounds.assign(terms.size(), 0.0);
+        seed = 0.0;
+        std::vector<uint32_t> docIDs;
+        std::vector<double> impacts;
+        for (size_t i = 0; i < terms.size(); i++) {
+            bounds[i] = idfs[i] * (bm25Params.k1 + 1.0);
+            double tailBound;
+            if (!headImpacts(terms[i], idfs[i], docIDs, impacts, tailBound) || impacts.empty()) continue;
+            any = true;
+            if (matches) {
+                bounds[i] = std::max(tailBound, *std::max_element(impacts.begin(), impacts.end()));
+            }
+            if (impacts.size() >= static_cast<size_t>(k)) {
+                std::nth_element(impacts.begin(), impacts.begin() + (k - 1), impacts.end(), std::greater<double>());
+                seed = std::max(seed, impacts[k - 1]);
+            }
+        }
+        // absorb rounding differences between bound sums and document scores
+        for (double& b : bounds) b *= 1.0 + 1e-9;
+        return any;
+    }
+    
+    /**
+     * @brief OR evaluation with MaxScore pruning, starting from threshold seed.
+     *
+     * Terms are sorted by bound; the prefix whose bounds sum below the
+     * threshold is non-essential: a document occurring only there cannot
+     * reach the top-k, so candidates come from the essential lists and the
+     * others are probed with nextGEQ only while the document can still reach
+     * the threshold. The threshold rises with the k-th best score. The result
+     * equals evaluateOR's (bounds and seed are safe).
+    */
+    std::priority_queue<QueryResult> evaluateMaxScore(std::vector<PostingList>& lists,
+                                                      const std::vector<double>& idfs,
+                                                      const std::vector<double>& bounds,
+                                                      double seed,
+                                                      int k,
+                                                      QueryBudget* budget) {
+        std::priority_queue<QueryResult> topK;
+        size_t n = lists.size();
+        std::vector<size_t> order(n);
+        for (size_t i = 0; i < n; i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&bounds](size_t a, size_t b) { return bounds[a] < bounds[b]; });
+        std::vector<double> prefix(n);
+        for (size_t i = 0; i < n; i++) prefix[i] = bounds[order[i]] + (i > 0 ? prefix[i - 1] : 0.0);
+        
+        double threshold = seed;
+        size_t essential = 0;   // order[essential..n) are essential
+        while (essential < n && prefix[essential] < threshold) essential++;
+        
+        while (essential < n) {
+            if (budget && budget->exhausted()) break;
+            
+            uint32_t minDoc = UINT32_MAX;
+            for (size_t e = essential; e < n; e++) {
+                const PostingList& list = lists[order[e]];
+                if (list.valid() && list.doc() < minDoc) minDoc = list.doc();
+            }
+            if (minDoc == UINT32_MAX) break;
+            
+            double score = 0.0;
+            uint32_t dl = docLen.len(minDoc);
+            uint32_t matched = 0;
+            for (size_t e = essential; e < n; e++) {
+                PostingList& list = lists[order[e]];
+                if (list.valid() && list.doc() == minDoc) {
+                    score += termScore(idfs[order[e]], list.freq(), dl);
+                    list.next();
+                    matched++;
+                }
+            }
+            for (size_t e = essential; e-- > 0;) {
+                if (score + prefix[e] < threshold) break;
+                PostingList& list = lists[order[e]];
+                if (list.nextGEQ(minDoc) && list.doc() == minDoc) {
+                    score += termScore(idfs[order[e]], list.freq(), dl);
+                    matched++;
+                }
+            }
+            if (budget) budget->charge(matched);
+            
+            offer(topK, k, minDoc, score);
+            if (topK.size() == static_cast<size_t>(k) && topK.top().score > threshold) {
+                threshold = topK.top().score;
+                while (essential < n && prefix[essential] < threshold) essential++;
+            }
+        }
+        return topK;
     }
 
+    /**
+     * @brief OR evaluation of an impact-scored index with block-max pruning.
+     *
+     * A term's score is weight * impact, so weight * (largest impact) bounds
+     * it over the whole list and weight * (block's max tf, from the skip
+     * table) over one block. Lists are split into essential and non-essential
+     * ones as in evaluateMaxScore. Once there is a threshold, the block bounds
+     * of all lists at the candidate are summed first: if the sum cannot reach
+     * the threshold, no document up to the nearest block end can, and the
+     * essential lists skip past it without decoding or scoring anything.
+     * Non-essential lists are probed only while the candidate's score plus
+     * their block bounds can still reach the threshold.
+    */
+    std::priority_queue<QueryResult> evaluateBlockMax(std::vector<PostingList>& lists,
+                                                      const std::vector<double>& weights,
+                                                      double seed,
+                                                      int k,
+                                                      QueryBudget* budget) {
+        std::priority_queue<QueryResult> topK;
+        size_t n = lists.size();
+        std::vector<double> bounds(n);
+        for (size_t i = 0; i < n; i++) bounds[i] = weights[i] * lists[i].maxFreq() * (1.0 + 1e-9);
+        std::vector<size_t> order(n);
+        for (size_t i = 0; i < n; i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&bounds](size_t a, size_t b) { return bounds[a] < bounds[b]; });
+        std::vector<double> prefix(n);
+        for (size_t i = 0; i < n; i++) prefix[i] = bounds[order[i]] + (i > 0 ? prefix[i - 1] : 0.0);
+        
+        double threshold = seed;
+        size_t essential = 0;   // order[essential..n) are essential
+        while (essential < n && prefix[essential] < threshold) essential++;
+        
+        std::vector<double> blockPrefix(n);   // prefix sums of the block bounds, in order
+        while (essential < n) {
+            if (budget && budget->exhausted()) break;
+            
+            uint32_t minDoc = UINT32_MAX;
+            for (size_t e = essential; e < n; e++) {
+                const PostingList& list = lists[order[e]];
+                if (list.valid() && list.doc() < minDoc) minDoc = list.doc();
+            }
+            if (minDoc == UINT32_MAX) break;
+            
+            bool blockBounds = threshold > 0.0;
+            if (blockBounds) {
+                uint32_t boundary = UINT32_MAX;   // the bounds hold for [minDoc, boundary]
+                for (size_t e = 0; e < n; e++) {
+                    uint32_t lastDoc;
+                    double bound = weights[order[e]] * lists[order[e]].blockMax(minDoc, lastDoc) * (1.0 + 1e-9);
+                    blockPrefix[e] = std::min(bounds[order[e]], bound) + (e > 0 ? blockPrefix[e - 1] : 0.0);
+                    boundary = std::min(boundary, lastDoc);
+                }
+                if (blockPrefix[n - 1] < threshold) {
+                    if (boundary == UINT32_MAX) break;
+                    for (size_t e = essential; e < n; e++) {
+                        PostingList& list = lists[order[e]];
+                        if (list.valid() && list.doc() <= boundary) list.nextGEQ(boundary + 1);
+                    }
+                    continue;
+                }
+            }
+            
+            double score = 0.0;
+            uint32_t dl = docLen.len(minDoc);
+            uint32_t matched = 0;
+            for (size_t e = essential; e < n; e++) {
+                PostingList& list = lists[order[e]];
+                if (list.valid() && list.doc() == minDoc) {
+                    score += termScore(weights[order[e]], list.freq(), dl);
+                    list.next();
+                    matched++;
+                }
+            }
+            for (size_t e = essential; e-- > 0;) {
+                double rest = blockBounds ? std::min(prefix[e], blockPrefix[e]) : prefix[e];
+                if (score + rest < threshold) break;
+                PostingList& list = lists[order[e]];
+                if (list.nextGEQ(minDoc) && list.doc() == minDoc) {
+                    score += termScore(weights[order[e]], list.freq(), dl);
+                    matched++;
+                }
+            }
+            if (budget) budget->charge(matched);
+            
+            offer(topK, k, minDoc, score);
+            if (topK.size() == static_cast<size_t>(k) && topK.top().score > threshold) {
+                threshold = topK.top().score;
+                while (essential < n && prefix[essential] < threshold) essential++;
+            }
+        }
+        return topK;
+    }
 
-private:
     /**
      * @brief Evaluate query in OR mode: documents should contain at least query terms.
     */
     std::priority_queue<QueryResult> evaluateOR(std::vector<TermMeta>& metas,
                                             std::vector<PostingList>& lists,
                                             std::vector<double>& idfs,
-                                            int k) {
+                                            int k,
+                                            QueryBudget* budget) {
         // Top-K min-heap
         std::priority_queue<QueryResult> topK;
         
         // DAAT OR iteration
         while (true) {
+            if (budget && budget->exhausted()) break;
+            
             // find the minimum current docID among all lists
             uint32_t minDoc = UINT32_MAX;
             for (size_t i = 0; i < lists.size(); i++) {
@@ -362,38 +2257,104 @@ private:
             // calculate BM25 score for minDoc
             double score = 0.0;
             uint32_t dl = docLen.len(minDoc);
+            uint32_t matched = 0;
             
             for (size_t i = 0; i < lists.size(); i++) {
                 if (lists[i].valid() && lists[i].doc() == minDoc) {
                     uint32_t tf = lists[i].freq();
-                    score += bm25::score(idfs[i], tf, dl, stats.avgdl, bm25Params);
+                    score += termScore(idfs[i], tf, dl);
                     lists[i].next();
+                    matched++;
                 }
             }
+            if (priorWeight != 0.0) score += priorWeight * docPriors->prior(minDoc);
+            if (budget) budget->charge(matched);
             
             // update Top-K
-            if (topK.size() < static_cast<size_t>(k)) {
-                topK.push(QueryResult(minDoc, score));
-            } else if (score > topK.top().score) {
-                topK.pop();
-                topK.push(QueryResult(minDoc, score));
-            }
+            offer(topK, k, minDoc, score);
         }
         return topK;
     }
         
+    /**
+     * @brief AND-query planner: replace term pairs that have a precomputed
+     *        intersection by the pair list.
+     *
+     * Pairs are taken most selective first (smallest intersection) and never
+     * share a term. A pair list takes the slot of its two terms: idfs[i] is
+     * the idf of the key's first term and pairIdfs[i] that of the second
+     * (pairIdfs[i] == 0 for single-term lists; a real idf is always > 0).
+    */
+    void planPairs(const std::vector<std::string>& terms,
+                   std::vector<TermMeta>& metas,
+                   std::vector<PostingList>& lists,
+                   std::vector<double>& idfs,
+                   std::vector<double>& pairIdfs) {
+        struct Option {
+            uint32_t df;
+            size_t first;     // index of the key's first (smaller) term
+            size_t second;
+            TermMeta meta;
+        };
+        std::vector<Option> options;
+        for (size_t i = 0; i < terms.size(); i++) {
+            for (size_t j = i + 1; j < terms.size(); j++) {
+                TermMeta meta;
+                if (!pairIndex->find(terms[i], terms[j], meta)) continue;
+                bool ordered = terms[i] < terms[j];
+                options.push_back({meta.df, ordered ? i : j, ordered ? j : i, meta});
+            }
+        }
+        if (options.empty()) return;
+        std::sort(options.begin(), options.end(),
+                  [](const Option& a, const Option& b) { return a.df < b.df; });
+        
+        std::vector<TermMeta> plannedMetas;
+        std::vector<PostingList> plannedLists;
+        std::vector<double> plannedIdfs;
+        std::vector<bool> covered(terms.size(), false);
+        for (const Option& o : options) {
+            if (covered[o.first] || covered[o.second]) continue;
+            PostingList list;
+            if (!list.open(o.meta, pairIndex->directory())) continue;
+            applyFilter(list);
+            covered[o.first] = covered[o.second] = true;
+            plannedMetas.push_back(o.meta);
+            plannedLists.push_back(std::move(list));
+            plannedIdfs.push_back(idfs[o.first]);
+            pairIdfs.push_back(idfs[o.second]);
+            pairsUsed.push_back(PairIndex::key(terms[o.first], terms[o.second]));
+        }
+        if (plannedLists.empty()) return;
+        for (size_t i = 0; i < terms.size(); i++) {
+            if (covered[i]) continue;
+            plannedMetas.push_back(metas[i]);
+            plannedLists.push_back(std::move(lists[i]));
+            plannedIdfs.push_back(idfs[i]);
+            pairIdfs.push_back(0.0);
+        }
+        metas.swap(plannedMetas);
+        lists.swap(plannedLists);
+        idfs.swap(plannedIdfs);
+    }
+    
     /**
      * @brief Evaluate query in AND mode: documents must contain all query terms.
+     *        Lists marked in pairIdfs are pair lists scored for both terms.
     */
     std::priority_queue<QueryResult> evaluateAND(std::vector<TermMeta>& metas,
                                         std::vector<PostingList>& lists,
                                         std::vector<double>& idfs,
-                                        int k) {
+                                        int k,
+                                        QueryBudget* budget,
+                                        const std::vector<double>* pairIdfs = nullptr) {
         // Top-K min-heap
         std::priority_queue<QueryResult> topK;
         
         // DAAT AND iteration
         while (true) {
+            if (budget && budget->exhausted()) break;
+            
             // find the maximum current docID among all lists
             uint32_t maxDoc = 0;
             bool allValid = true;
@@ -436,16 +2397,18 @@ private:
             
             for (size_t i = 0; i < lists.size(); i++) {
                 uint32_t tf = lists[i].freq();
-                score += bm25::score(idfs[i], tf, dl, stats.avgdl, bm25Params);
+                if (pairIdfs && (*pairIdfs)[i] > 0.0) {
+                    score += termScore(idfs[i], PairIndex::firstTf(tf), dl) +
+                             termScore((*pairIdfs)[i], PairIndex::secondTf(tf), dl);
+                } else {
+                    score += termScore(idfs[i], tf, dl);
+                }
             }
+            if (priorWeight != 0.0) score += priorWeight * docPriors->prior(maxDoc);
+            if (budget) budget->charge(static_cast<uint32_t>(lists.size()));
             
             // update Top-K
-            if (topK.size() < static_cast<size_t>(k)) {
-                topK.push(QueryResult(maxDoc, score));
-            } else if (score > topK.top().score) {
-                topK.pop();
-                topK.push(QueryResult(maxDoc, score));
-            }
+            offer(topK, k, maxDoc, score);
             
             // push all lists to next document
             for (size_t i = 0; i < lists.size(); i++) {
@@ -0,0 +1,338 @@
+#ifndef RERANKER_HPP
+#define RERANKER_HPP
+
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Second-stage features of the re-ranking pipeline.
+ *
+ * The evaluator fills one row per candidate document; rerankers refer to the
+ * columns by name in their model files.
+*/
+namespace features {
+
+enum Id {
+    BM25 = 0,        // first-stage BM25 score (sum over matched terms)
+    BM25_MAX,        // largest per-term BM25 contribution
+    BM25_MIN,        // smallest per-term contribution among matched terms
+    MATCHED,         // fraction of query terms present in the document
+    DOC_LEN,         // log(1 + document length)
+    TERM_PAIR,       // BM25TP term-pair proximity (needs positions)
+    SPAN,            // matched / (minimal covering span + 1) (needs positions)
+    PRIOR,           // static document prior (0 without doc_prior.bin)
+    QUERY_LEN,       // number of query terms
+    COUNT
+};
+
+inline const char* name(size_t id) {
+    static const char* names[COUNT] = {
+        "bm25", "bm25_max", "bm25_min", "matched", "doc_len",
+        "term_pair", "span", "prior", "query_len"
+    };
+    return id < COUNT ? names[id] : "";
+}
+
+// column index of a feature name, or -1
+inline int find(const std::string& featureName) {
+    for (size_t i = 0; i < COUNT; i++) {
+        if (featureName == name(i)) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+// whether a feature requires reading positions
+inline bool positional(size_t id) {
+    return id == TERM_PAIR || id == SPAN;
+}
+
+} // namespace features
+
+/**
+ * @brief Candidate features in one contiguous row-major block
+ *        (row = document, COUNT floats per row).
+*/
+struct FeatureMatrix {
+    size_t rows;
+    std::vector<float> values;
+
+    FeatureMatrix() : rows(0) {}
+
+    void reset(size_t numRows) {
+        rows = numRows;
+        values.assign(numRows * features::COUNT, 0.0f);
+    }
+
+    float* row(size_t r) { return values.data() + r * features::COUNT; }
+    const float* row(size_t r) const { return values.data() + r * features::COUNT; }
+};
+
+/**
+ * @brief Scores candidate rows; implementations are immutable after loading
+ *        and may be shared by concurrent evaluators.
+*/
+class Reranker {
+public:
+    virtual ~Reranker() = default;
+
+    virtual void score(const FeatureMatrix& matrix, std::vector<double>& out) const = 0;
+
+    // whether the model reads the given feature column
+    virtual bool uses(size_t feature) const = 0;
+
+    virtual const char* kind() const = 0;
+};
+
+/**
+ * @brief Linear model: bias + sum of weight * feature.
+ *
+ * File format (after the "linear" line): "<feature> <weight>" lines and an
+ * optional "bias <value>" line.
+*/
+class LinearReranker : public Reranker {
+private:
+    double bias;
+    double weights[features::COUNT];
+
+public:
+    LinearReranker() : bias(0.0) {
+        for (double& w : weights) w = 0.0;
+    }
+
+    void setWeight(size_t feature, double weight) { weights[feature] = weight; }
+    void setBias(double value) { bias = value; }
+
+    bool load(std::istream& in, std::string* error) {
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream iss(line);
+            std::string featureName;
+            double value;
+            if (!(iss >> featureName >> value)) continue;
+            if (featureName == "bias") {
+                bias = value;
+                continue;
+            }
+            int id = features::find(featureName);
+            if (id < 0) {
+                if (error) *error = "unknown feature: " + featureName;
+                return false;
+            }
+            weights[id] = value;
+        }
+        return true;
+    }
+
+    void score(const FeatureMatrix& matrix, std::vector<double>& out) const override {
+        out.resize(matrix.rows);
+        for (size_t r = 0; r < matrix.rows; r++) {
+            const float* x = matrix.row(r);
+            double s = bias;
+            for (size_t f = 0; f < features::COUNT; f++) s += weights[f] * x[f];
+            out[r] = s;
+        }
+    }
+
+    bool uses(size_t feature) const override { return weights[feature] != 0.0; }
+
+    const char* kind() const override { return "linear"; }
+};
+
+/**
+ * @brief Ensemble of regression trees (e.g. exported from a GBDT trainer).
+ *
+ * File format (after the "gbdt" line):
+ *     base <value>                         initial score (optional)
+ *     tree                                 starts a tree; nodes follow, root first
+ *     <id> <feature> <threshold> <left> <right>   split: x[feature] <= threshold goes left
+ *     <id> leaf <value>                    leaf (learning rate already applied)
+ * Node ids are local to their tree. Trees are stored flattened so scoring a
+ * row walks contiguous arrays.
+*/
+class TreeEnsembleReranker : public Reranker {
+private:
+    struct Node {
+        int feature;        // -1 for leaves
+        float threshold;
+        int32_t left;       // absolute node index
+        int32_t right;
+        double value;       // leaf value
+    };
+
+    double base;
+    std::vector<Node> nodes;
+    std::vector<int32_t> roots;
+    bool used[features::COUNT];
+
+    // convert one tree's local ids to absolute indexes; false if malformed
+    bool finishTree(size_t start, const std::vector<int32_t>& localIds, std::string* error) {
+        if (localIds.empty()) {
+            if (error) *error = "tree without nodes";
+            return false;
+        }
+        std::unordered_map<int32_t, int32_t> index;   // local id -> absolute index
+        for (size_t i = 0; i < localIds.size(); i++) {
+            if (!index.emplace(localIds[i], static_cast<int32_t>(start + i)).second) {
+                if (error) *error = "duplicate node id " + std::to_string(localIds[i]);
+                return false;
+            }
+        }
+        for (size_t i = start; i < nodes.size(); i++) {
+            Node& n = nodes[i];
+            if (n.feature < 0) continue;
+            auto left = index.find(n.left);
+            auto right = index.find(n.right);
+            if (left == index.end() || right == index.end()) {
+                if (error) *error = "tree references a missing node";
+                return false;
+            }
+            n.left = left->second;
+            n.right = right->second;
+            // children must come after their parent (no cycles)
+            if (n.left <= static_cast<int32_t>(i) || n.right <= static_cast<int32_t>(i)) {
+                if (error) *error = "tree nodes must be listed parents first";
+                return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    TreeEnsembleReranker() : base(0.0) {
+        for (bool& u : used) u = false;
+    }
+
+    bool load(std::istream& in, std::string* error) {
+        std::string line;
+        size_t treeStart = 0;
+        std::vector<int32_t> localIds;
+        bool inTree = false;
+
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream iss(line);
+            std::string first;
+            iss >> first;
+
+            if (first == "base") {
+                if (!(iss >> base)) {
+                    if (error) *error = "malformed base: " + line;
+                    return false;
+                }
+                continue;
+            }
+            if (first == "tree") {
+                if (inTree && !finishTree(treeStart, localIds, error)) return false;
+                treeStart = nodes.size();
+                localIds.clear();
+                roots.push_back(static_cast<int32_t>(treeStart));
+                inTree = true;
+                continue;
+            }
+            if (!inTree) {
+                if (error) *error = "node outside of a tree: " + line;
+                return false;
+            }
+
+            // local node id: a non-negative integer, unique within the tree
+            char* end = nullptr;
+            long localId = std::strtol(first.c_str(), &end, 10);
+            if (end == first.c_str() || *end != '\0' || localId < 0 || localId > INT32_MAX) {
+                if (error) *error = "bad node id: " + line;
+                return false;
+            }
+
+            Node node{-1, 0.0f, -1, -1, 0.0};
+            std::string featureName;
+            if (!(iss >> featureName)) {
+                if (error) *error = "malformed node: " + line;
+                return false;
+            }
+            if (featureName == "leaf") {
+                if (!(iss >> node.value)) {
+                    if (error) *error = "leaf without a value: " + line;
+                    return false;
+                }
+            } else {
+                int id = features::find(featureName);
+                if (id < 0) {
+                    if (error) *error = "unknown feature: " + featureName;
+                    return false;
+                }
+                if (!(iss >> node.threshold >> node.left >> node.right)) {
+                    if (error) *error = "malformed split: " + line;
+                    return false;
+                }
+                node.feature = id;
+                used[id] = true;
+            }
+            localIds.push_back(static_cast<int32_t>(localId));
+            nodes.push_back(node);
+        }
+        if (inTree && !finishTree(treeStart, localIds, error)) return false;
+        return true;
+    }
+
+    void score(const FeatureMatrix& matrix, std::vector<double>& out) const override {
+        out.assign(matrix.rows, base);
+        // tree-major: one tree stays in cache while all candidates pass through it
+        for (int32_t root : roots) {
+            for (size_t r = 0; r < matrix.rows; r++) {
+                const float* x = matrix.row(r);
+                const Node* n = &nodes[root];
+                while (n->feature >= 0) {
+                    n = &nodes[x[n->feature] <= n->threshold ? n->left : n->right];
+                }
+                out[r] += n->value;
+            }
+        }
+    }
+
+    bool uses(size_t feature) const override { return used[feature]; }
+
+    size_t treeCount() const { return roots.size(); }
+
+    const char* kind() const override { return "gbdt"; }
+};
+
+/**
+ * @brief Load a model file whose first line is "linear" or "gbdt".
+ * @return nullptr on error (message in *error).
+*/
+inline std::shared_ptr<const Reranker> loadReranker(const std::string& path, std::string* error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        if (error) *error = "cannot open " + path;
+        return nullptr;
+    }
+
+    std::string kind;
+    while (std::getline(file, kind)) {
+        if (!kind.empty() && kind[0] != '#') break;
+    }
+    while (!kind.empty() && std::isspace(static_cast<unsigned char>(kind.back()))) kind.pop_back();
+
+    if (kind == "linear") {
+        auto model = std::make_shared<LinearReranker>();
+        if (!model->load(file, error)) return nullptr;
+        return model;
+    }
+    if (kind == "gbdt") {
+        auto model = std::make_shared<TreeEnsembleReranker>();
+        if (!model->load(file, error)) return nullptr;
+        return model;
+    }
+    if (error) *error = "unknown model type '" + kind + "' (expected linear or gbdt)";
+    return nullptr;
+}
+
+#endif // RERANKER_HPP
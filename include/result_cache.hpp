@@ -0,0 +1,92 @@
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "querier.hpp"
+
+/**
+ * @brief Short-lived cache of ranked result lists for pagination.
+ *
+ * Keyed by the normalized query and every parameter that affects ranking.
+ * An entry holds the first results of a query in result order (usually a few
+ * pages more than were asked for), so the following pages are sliced from it
+ * instead of evaluating the query again. Entries are immutable and shared;
+ * extending a list replaces its entry. Least recently used entries are evicted
+ * beyond `capacity`, and entries older than `ttl` are ignored, so results
+ * never lag the index by more than the TTL.
+*/
+class ResultCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::vector<QueryResult> results;   // external docIDs, result order
+        bool complete;                      // the query has no further results
+        Clock::time_point created;
+
+        Entry() : complete(false) {}
+
+        // results [offset, offset + count) are all available
+        bool covers(size_t offset, size_t count) const {
+            return complete || results.size() >= offset + count;
+        }
+    };
+
+private:
+    using LruList = std::list<std::string>;
+
+    struct Slot {
+        std::shared_ptr<const Entry> entry;
+        LruList::iterator lru;
+    };
+
+    std::mutex mutex;
+    size_t capacity;
+    Clock::duration ttl;
+    std::unordered_map<std::string, Slot> slots;
+    LruList lru;              // most recently used first
+
+public:
+    ResultCache(size_t maxEntries, std::chrono::milliseconds timeToLive)
+        : capacity(maxEntries), ttl(timeToLive) {}
+
+    bool enabled() const { return capacity > 0; }
+
+    // fresh entry for key, or nullptr
+    std::shared_ptr<const Entry> find(const std::string& key) {
+        if (capacity == 0) return nullptr;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = slots.find(key);
+        if (it == slots.end() || Clock::now() - it->second.entry->created > ttl) return nullptr;
+        lru.splice(lru.begin(), lru, it->second.lru);
+        return it->second.entry;
+    }
+
+    void put(const std::string& key, std::shared_ptr<Entry> entry) {
+        if (capacity == 0) return;
+        entry->created = Clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = slots.find(key);
+        if (it != slots.end()) {
+            it->second.entry = std::move(entry);
+            lru.splice(lru.begin(), lru, it->second.lru);
+            return;
+        }
+        lru.push_front(key);
+        slots[key] = Slot{std::move(entry), lru.begin()};
+        while (slots.size() > capacity) {
+            slots.erase(lru.back());
+            lru.pop_back();
+        }
+    }
+};
+
+#endif // RESULT_CACHE_HPP
@@ -0,0 +1,454 @@
+#ifndef ROARING_HPP
+#define ROARING_HPP
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "utils.hpp"
+
+/**
+ * @brief Roaring-style docID set with a parallel tf array, used for very
+ *        dense terms (postings.dense.bin, written by merger --dense-ratio).
+ *
+ * DocIDs are split into 64K chunks by their high 16 bits; each chunk is stored
+ * as whichever container is smallest: a sorted array of low halves (at most
+ * 4096 values), a 65536-bit bitmap, or a list of runs (start, length - 1).
+ * Containers know the number of postings before them, so the rank of a docID
+ * (its index in the list) is cheap to keep while iterating; tfs are stored by
+ * rank, one byte each, with larger values in a sorted overflow table.
+ *
+ * Record layout (little-endian):
+ *     uint32 containerCount, cardinality, shortCount, wordCount, overflowCount
+ *     Container containers[containerCount]
+ *     uint16 shorts[shortCount]        (array values and run pairs)
+ *     uint64 words[wordCount]          (1024 per bitmap container)
+ *     uint8 tfs[cardinality]
+ *     Overflow overflow[overflowCount]
+*/
+class RoaringPostings {
+public:
+    enum : uint16_t { ARRAY = 0, BITMAP = 1, RUN = 2 };
+
+    static constexpr uint32_t CHUNK_WORDS = 1024;   // 65536 bits
+    static constexpr uint32_t MAX_ARRAY = 4096;     // larger arrays are bigger than a bitmap
+    static constexpr uint8_t TF_ESCAPE = 255;       // tf is in the overflow table
+
+    struct Container {
+        uint16_t key;           // docID >> 16
+        uint16_t type;
+        uint32_t cardinality;
+        uint32_t offset;        // into shorts (ARRAY, RUN) or words (BITMAP)
+        uint32_t length;        // shorts or words used
+        uint32_t rank;          // postings in earlier containers
+    };
+
+    struct Overflow {
+        uint32_t rank;
+        uint32_t tf;
+    };
+
+    std::vector<Container> containers;
+    std::vector<uint16_t> shorts;
+    std::vector<uint64_t> words;
+    std::vector<uint8_t> tfs;
+    std::vector<Overflow> overflow;
+
+    uint32_t cardinality() const { return static_cast<uint32_t>(tfs.size()); }
+
+    /**
+     * @brief Build from a docID-sorted list (docIDs and tfs of equal length).
+     */
+    static std::shared_ptr<RoaringPostings> build(const std::vector<uint32_t>& docIDs,
+                                                  const std::vector<uint32_t>& freqs) {
+        auto set = std::make_shared<RoaringPostings>();
+        size_t n = docIDs.size();
+        for (size_t i = 0; i < n;) {
+            uint16_t key = static_cast<uint16_t>(docIDs[i] >> 16);
+            size_t j = i + 1;
+            uint32_t runs = 1;
+            while (j < n && (docIDs[j] >> 16) == key) {
+                if (docIDs[j] != docIDs[j - 1] + 1) runs++;
+                j++;
+            }
+
+            Container c{key, ARRAY, static_cast<uint32_t>(j - i), 0, 0, static_cast<uint32_t>(i)};
+            size_t arrayBytes = c.cardinality <= MAX_ARRAY ? 2 * c.cardinality : SIZE_MAX;
+            size_t bitmapBytes = CHUNK_WORDS * sizeof(uint64_t);
+            size_t runBytes = 4 * static_cast<size_t>(runs);
+
+            if (runBytes < std::min(arrayBytes, bitmapBytes)) {
+                c.type = RUN;
+                c.offset = static_cast<uint32_t>(set->shorts.size());
+                for (size_t s = i; s < j;) {
+                    size_t e = s + 1;
+                    while (e < j && docIDs[e] == docIDs[e - 1] + 1) e++;
+                    set->shorts.push_back(static_cast<uint16_t>(docIDs[s]));
+                    set->shorts.push_back(static_cast<uint16_t>(e - s - 1));
+                    s = e;
+                }
+                c.length = 2 * runs;
+            } else if (arrayBytes <= bitmapBytes) {
+                c.offset = static_cast<uint32_t>(set->shorts.size());
+                for (size_t s = i; s < j; s++) set->shorts.push_back(static_cast<uint16_t>(docIDs[s]));
+                c.length = c.cardinality;
+            } else {
+                c.type = BITMAP;
+                c.offset = static_cast<uint32_t>(set->words.size());
+                set->words.resize(set->words.size() + CHUNK_WORDS, 0);
+                uint64_t* bits = set->words.data() + c.offset;
+                for (size_t s = i; s < j; s++) {
+                    uint32_t low = docIDs[s] & 0xFFFF;
+                    bits[low >> 6] |= 1ULL << (low & 63);
+                }
+                c.length = CHUNK_WORDS;
+            }
+            set->containers.push_back(c);
+            i = j;
+        }
+
+        set->tfs.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            if (freqs[i] < TF_ESCAPE) {
+                set->tfs[i] = static_cast<uint8_t>(freqs[i]);
+            } else {
+                set->tfs[i] = TF_ESCAPE;
+                set->overflow.push_back({static_cast<uint32_t>(i), freqs[i]});
+            }
+        }
+        return set;
+    }
+
+    void serialize(std::string& out) const {
+        uint32_t header[5] = {static_cast<uint32_t>(containers.size()), cardinality(),
+                              static_cast<uint32_t>(shorts.size()), static_cast<uint32_t>(words.size()),
+                              static_cast<uint32_t>(overflow.size())};
+        out.append(reinterpret_cast<const char*>(header), sizeof(header));
+        append(out, containers);
+        append(out, shorts);
+        append(out, words);
+        append(out, tfs);
+        append(out, overflow);
+    }
+
+    bool deserialize(const char* data, size_t size) {
+        uint32_t header[5];
+        if (size < sizeof(header)) return false;
+        std::memcpy(header, data, sizeof(header));
+        size_t pos = sizeof(header);
+        return extract(data, size, pos, containers, header[0]) && extract(data, size, pos, shorts, header[2]) &&
+               extract(data, size, pos, words, header[3]) && extract(data, size, pos, tfs, header[1]) &&
+               extract(data, size, pos, overflow, header[4]) && pos == size;
+    }
+
+    /**
+     * @brief Read one record of a postings.dense.bin file.
+     *
+     * Dense lists are few and are traversed by most queries that contain
+     * them, so every record is kept once it has been read (process-wide,
+     * shared by all threads).
+     * @return nullptr if the record cannot be read.
+     */
+    static std::shared_ptr<const RoaringPostings> load(const std::string& path, uint64_t offset, uint64_t bytes) {
+        static std::mutex cacheMutex;
+        static std::unordered_map<std::string, std::shared_ptr<const RoaringPostings>> cache;
+
+        std::string key = path + "@" + std::to_string(offset);
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = cache.find(key);
+        if (it != cache.end()) return it->second;
+
+        std::ifstream file(path, std::ios::binary);
+        std::string data(bytes, '\0');
+        file.seekg(offset);
+        file.read(&data[0], bytes);
+        auto set = std::make_shared<RoaringPostings>();
+        if (!file || !set->deserialize(data.data(), data.size())) return nullptr;
+        return cache[key] = set;
+    }
+
+    // tf of the posting with the given rank
+    uint32_t tf(uint32_t rank) const {
+        uint8_t t = tfs[rank];
+        if (t != TF_ESCAPE) return t;
+        auto it = std::lower_bound(overflow.begin(), overflow.end(), rank,
+                                   [](const Overflow& o, uint32_t r) { return o.rank < r; });
+        return it->tf;
+    }
+
+    bool contains(uint32_t docID) const {
+        const Container* c = findContainer(static_cast<uint16_t>(docID >> 16));
+        return c && containerContains(*c, docID & 0xFFFF);
+    }
+
+    // |a AND b|, container by container
+    static uint64_t andCount(const RoaringPostings& a, const RoaringPostings& b) {
+        uint64_t count = 0;
+        size_t i = 0, j = 0;
+        uint64_t bitsA[CHUNK_WORDS], bitsB[CHUNK_WORDS];
+        while (i < a.containers.size() && j < b.containers.size()) {
+            const Container& ca = a.containers[i];
+            const Container& cb = b.containers[j];
+            if (ca.key < cb.key) {
+                i++;
+            } else if (ca.key > cb.key) {
+                j++;
+            } else {
+                if (ca.type == ARRAY || cb.type == ARRAY) {
+                    // probe the smaller side's values in the other container
+                    bool probeA = ca.type == ARRAY && (cb.type != ARRAY || ca.cardinality <= cb.cardinality);
+                    const RoaringPostings& small = probeA ? a : b;
+                    const RoaringPostings& large = probeA ? b : a;
+                    const Container& cs = probeA ? ca : cb;
+                    const Container& cl = probeA ? cb : ca;
+                    for (uint32_t k = 0; k < cs.cardinality; k++) {
+                        count += large.containerContains(cl, small.shorts[cs.offset + k]);
+                    }
+                } else {
+                    a.toBitmap(ca, bitsA);
+                    b.toBitmap(cb, bitsB);
+                    for (uint32_t w = 0; w < CHUNK_WORDS; w++) count += popcount64(bitsA[w] & bitsB[w]);
+                }
+                i++;
+                j++;
+            }
+        }
+        return count;
+    }
+
+    // set the bit of every docID in a collection-wide bitmap of wordCount words
+    void orInto(uint64_t* bits, size_t wordCount) const {
+        uint64_t chunk[CHUNK_WORDS];
+        for (const Container& c : containers) {
+            size_t base = static_cast<size_t>(c.key) * CHUNK_WORDS;
+            if (base >= wordCount) break;
+            toBitmap(c, chunk);
+            size_t n = std::min<size_t>(CHUNK_WORDS, wordCount - base);
+            for (size_t w = 0; w < n; w++) bits[base + w] |= chunk[w];
+        }
+    }
+
+    // |a AND NOT b|
+    static uint64_t andNotCount(const RoaringPostings& a, const RoaringPostings& b) {
+        return a.cardinality() - andCount(a, b);
+    }
+
+private:
+    template <typename T>
+    static void append(std::string& out, const std::vector<T>& values) {
+        out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    template <typename T>
+    static bool extract(const char* data, size_t size, size_t& pos, std::vector<T>& out, uint32_t count) {
+        size_t bytes = static_cast<size_t>(count) * sizeof(T);
+        if (size - pos < bytes) return false;
+        out.resize(count);
+        if (bytes > 0) std::memcpy(out.data(), data + pos, bytes);
+        pos += bytes;
+        return true;
+    }
+
+    const Container* findContainer(uint16_t key) const {
+        auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                                   [](const Container& c, uint16_t k) { return c.key < k; });
+        return (it != containers.end() && it->key == key) ? &*it : nullptr;
+    }
+
+    bool containerContains(const Container& c, uint32_t low) const {
+        const uint16_t* values = shorts.data() + c.offset;
+        switch (c.type) {
+            case ARRAY:
+                return std::binary_search(values, values + c.length, static_cast<uint16_t>(low));
+            case BITMAP:
+                return (words[c.offset + (low >> 6)] >> (low & 63)) & 1;
+            default: {
+                // last run starting at or before low
+                uint32_t lo = 0, hi = c.length / 2;
+                while (lo < hi) {
+                    uint32_t mid = (lo + hi) / 2;
+                    if (values[2 * mid] <= low) lo = mid + 1;
+                    else hi = mid;
+                }
+                return lo > 0 && low <= static_cast<uint32_t>(values[2 * (lo - 1)]) + values[2 * (lo - 1) + 1];
+            }
+        }
+    }
+
+    void toBitmap(const Container& c, uint64_t* bits) const {
+        if (c.type == BITMAP) {
+            std::memcpy(bits, words.data() + c.offset, CHUNK_WORDS * sizeof(uint64_t));
+            return;
+        }
+        std::memset(bits, 0, CHUNK_WORDS * sizeof(uint64_t));
+        const uint16_t* values = shorts.data() + c.offset;
+        if (c.type == ARRAY) {
+            for (uint32_t k = 0; k < c.length; k++) bits[values[k] >> 6] |= 1ULL << (values[k] & 63);
+            return;
+        }
+        for (uint32_t r = 0; r < c.length; r += 2) {
+            uint32_t end = static_cast<uint32_t>(values[r]) + values[r + 1];
+            for (uint32_t v = values[r]; v <= end; v++) bits[v >> 6] |= 1ULL << (v & 63);
+        }
+    }
+};
+
+/**
+ * @brief Forward cursor over a RoaringPostings set (next / nextGEQ), used by
+ *        PostingList for dense terms.
+ *
+ * nextGEQ binary-searches the container keys, then seeks inside one
+ * container: a binary search in an array, a word scan in a bitmap or a run
+ * scan; the rank (and so the tf) is updated along the way.
+*/
+class RoaringCursor {
+private:
+    using Container = RoaringPostings::Container;
+
+    const RoaringPostings* set;
+    uint32_t index;        // current container
+    uint32_t local;        // rank within the container
+    uint32_t low;          // low 16 bits of the current docID
+    uint32_t run;          // current run (RUN containers)
+    uint32_t runRank;      // local rank of the current run's first value
+    bool valid_;
+
+    const Container& container() const { return set->containers[index]; }
+
+    // first set bit >= from, or 65536
+    uint32_t nextSetBit(const Container& c, uint32_t from) const {
+        const uint64_t* bits = set->words.data() + c.offset;
+        uint32_t w = from >> 6;
+        uint64_t word = bits[w] & (~0ULL << (from & 63));
+        while (word == 0) {
+            if (++w == RoaringPostings::CHUNK_WORDS) return 65536;
+            word = bits[w];
+        }
+        return w * 64 + ctz64(word);
+    }
+
+    // set bits in [from, to]
+    uint32_t countBits(const Container& c, uint32_t from, uint32_t to) const {
+        const uint64_t* bits = set->words.data() + c.offset;
+        uint32_t first = from >> 6, last = to >> 6;
+        uint64_t lowMask = ~0ULL << (from & 63);
+        uint64_t highMask = (to & 63) == 63 ? ~0ULL : ((1ULL << ((to & 63) + 1)) - 1);
+        if (first == last) return popcount64(bits[first] & lowMask & highMask);
+        uint32_t count = popcount64(bits[first] & lowMask) + popcount64(bits[last] & highMask);
+        for (uint32_t w = first + 1; w < last; w++) count += popcount64(bits[w]);
+        return count;
+    }
+
+    // position at the first value of container i
+    void enter(uint32_t i) {
+        index = i;
+        if (index >= set->containers.size()) {
+            valid_ = false;
+            return;
+        }
+        const Container& c = container();
+        local = 0;
+        run = 0;
+        runRank = 0;
+        low = c.type == RoaringPostings::BITMAP ? nextSetBit(c, 0) : set->shorts[c.offset];
+    }
+
+    // move to the first value >= target inside the current container
+    bool seek(uint32_t target) {
+        const Container& c = container();
+        const uint16_t* values = set->shorts.data() + c.offset;
+        switch (c.type) {
+            case RoaringPostings::ARRAY: {
+                const uint16_t* pos = std::lower_bound(values + local, values + c.length, static_cast<uint16_t>(target));
+                if (pos == values + c.length) return false;
+                local = static_cast<uint32_t>(pos - values);
+                low = *pos;
+                return true;
+            }
+            case RoaringPostings::BITMAP: {
+                uint32_t found = nextSetBit(c, target);
+                if (found >= 65536) return false;
+                local += countBits(c, low + 1, found);
+                low = found;
+                return true;
+            }
+            default: {
+                uint32_t runs = c.length / 2;
+                while (run < runs && static_cast<uint32_t>(values[2 * run]) + values[2 * run + 1] < target) {
+                    runRank += values[2 * run + 1] + 1u;
+                    run++;
+                }
+                if (run == runs) return false;
+                uint32_t start = values[2 * run];
+                low = std::max(start, target);
+                local = runRank + (low - start);
+                return true;
+            }
+        }
+    }
+
+public:
+    RoaringCursor() : set(nullptr), index(0), local(0), low(0), run(0), runRank(0), valid_(false) {}
+
+    bool open(const RoaringPostings* postings) {
+        set = postings;
+        valid_ = set && !set->containers.empty();
+        if (valid_) enter(0);
+        return valid_;
+    }
+
+    bool valid() const { return valid_; }
+    uint32_t doc() const { return (static_cast<uint32_t>(container().key) << 16) | low; }
+    uint32_t freq() const { return set->tf(container().rank + local); }
+
+    bool next() {
+        if (!valid_) return false;
+        const Container& c = container();
+        if (local + 1 >= c.cardinality) {
+            enter(index + 1);
+            return valid_;
+        }
+        local++;
+        const uint16_t* values = set->shorts.data() + c.offset;
+        switch (c.type) {
+            case RoaringPostings::ARRAY:
+                low = values[local];
+                break;
+            case RoaringPostings::BITMAP:
+                low = nextSetBit(c, low + 1);
+                break;
+            default:
+                if (low < static_cast<uint32_t>(values[2 * run]) + values[2 * run + 1]) {
+                    low++;
+                } else {
+                    run++;
+                    runRank = local;
+                    low = values[2 * run];
+                }
+        }
+        return true;
+    }
+
+    bool nextGEQ(uint32_t target) {
+        if (!valid_) return false;
+        if (doc() >= target) return true;
+
+        uint16_t key = static_cast<uint16_t>(target >> 16);
+        if (container().key < key) {
+            auto begin = set->containers.begin();
+            auto it = std::lower_bound(begin + index + 1, set->containers.end(), key,
+                                       [](const Container& c, uint16_t k) { return c.key < k; });
+            enter(static_cast<uint32_t>(it - begin));
+            if (!valid_ || doc() >= target) return valid_;
+        }
+        if (!seek(target & 0xFFFF)) enter(index + 1);
+        return valid_;
+    }
+};
+
+#endif // ROARING_HPP
@@ -0,0 +1,119 @@
+#ifndef SINGLEFLIGHT_HPP
+#define SINGLEFLIGHT_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief Coalesces identical concurrent requests into one evaluation.
+ *
+ * The first request for a key becomes the leader: it evaluates and publishes
+ * the result with finish(). Requests for the same key arriving meanwhile are
+ * followers: they wait() for the leader's result instead of evaluating, each
+ * up to its own deadline. Once finished, the key is free again, so later
+ * requests start a new evaluation (or are served by a cache in front of this).
+ * A leader that cannot produce a result finishes with nullptr, which tells
+ * its followers to evaluate on their own; a Guard does that automatically.
+*/
+template <typename T>
+class SingleFlight {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    class Call {
+        friend class SingleFlight;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::shared_ptr<const T> result;
+        bool done = false;
+    };
+
+private:
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<Call>> calls;
+
+public:
+    /**
+     * @brief Join the evaluation of key; leader is set if the caller must
+     *        evaluate and finish() the returned call.
+     */
+    std::shared_ptr<Call> join(const std::string& key, bool& leader) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = calls.find(key);
+        if (it != calls.end()) {
+            leader = false;
+            return it->second;
+        }
+        leader = true;
+        auto call = std::make_shared<Call>();
+        calls[key] = call;
+        return call;
+    }
+
+    // publish the leader's result (nullptr: followers evaluate themselves)
+    void finish(const std::string& key, const std::shared_ptr<Call>& call, std::shared_ptr<const T> result) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = calls.find(key);
+            if (it != calls.end() && it->second == call) calls.erase(it);
+        }
+        {
+            std::lock_guard<std::mutex> lock(call->mutex);
+            call->result = std::move(result);
+            call->done = true;
+        }
+        call->cv.notify_all();
+    }
+
+    /**
+     * @brief Leader side of a call: publish() hands the result to the
+     *        followers; if the leader leaves its scope without publishing
+     *        (early return or exception), the call is finished with nullptr,
+     *        so followers never wait on an abandoned call. Does nothing for
+     *        followers.
+     */
+    class Guard {
+        SingleFlight& flight;
+        std::string key;
+        std::shared_ptr<Call> call;
+        bool pending;
+
+    public:
+        Guard(SingleFlight& owner, const std::string& callKey, std::shared_ptr<Call> joined, bool leader)
+            : flight(owner), key(callKey), call(std::move(joined)), pending(leader) {}
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard() {
+            if (pending) flight.finish(key, call, nullptr);
+        }
+
+        void publish(std::shared_ptr<const T> result) {
+            if (!pending) return;
+            pending = false;
+            flight.finish(key, call, std::move(result));
+        }
+    };
+
+    /**
+     * @brief Wait for the leader; false if the deadline passed first.
+     */
+    bool wait(const std::shared_ptr<Call>& call, bool hasDeadline, Clock::time_point deadline,
+              std::shared_ptr<const T>& result) {
+        std::unique_lock<std::mutex> lock(call->mutex);
+        auto ready = [&call] { return call->done; };
+        if (hasDeadline) {
+            if (!call->cv.wait_until(lock, deadline, ready)) return false;
+        } else {
+            call->cv.wait(lock, ready);
+        }
+        result = call->result;
+        return true;
+    }
+};
+
+#endif // SINGLEFLIGHT_HPP
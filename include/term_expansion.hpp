@@ -0,0 +1,186 @@
+#ifndef TERM_EXPANSION_HPP
+#define TERM_EXPANSION_HPP
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include "index_reader.hpp"
+
+// '*' patterns over the term dictionary, e.g. comput* or colo*r
+namespace wildcard {
+
+inline bool isPattern(const std::string& term) {
+    return term.find('*') != std::string::npos;
+}
+
+// characters before the first '*'
+inline std::string literalPrefix(const std::string& pattern) {
+    return pattern.substr(0, pattern.find('*'));
+}
+
+// glob match where '*' matches any (possibly empty) run of characters
+inline bool match(const std::string& pattern, const std::string& text) {
+    size_t p = 0, t = 0;
+    size_t star = std::string::npos, resume = 0;
+    while (t < text.size()) {
+        if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            resume = t;
+        } else if (p < pattern.size() && pattern[p] == text[t]) {
+            p++;
+            t++;
+        } else if (star != std::string::npos) {
+            p = star + 1;
+            t = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') p++;
+    return p == pattern.size();
+}
+
+} // namespace wildcard
+
+/**
+ * @brief Caps on the expansion of one pattern.
+*/
+struct ExpansionOptions {
+    size_t maxTerms;          // most frequent matching terms kept
+    uint64_t maxPostings;     // postings merged into the union list
+    size_t minPrefix;         // literal characters required before the first '*'
+
+    ExpansionOptions() : maxTerms(50), maxPostings(2000000), minPrefix(2) {}
+};
+
+/**
+ * @brief Cost of the expansions done for one query.
+*/
+struct ExpansionStats {
+    size_t patterns;          // patterns in the query
+    size_t matchedTerms;      // dictionary terms matching them
+    size_t expandedTerms;     // terms merged after applying the caps
+    uint64_t mergedPostings;  // postings read from the expanded lists
+    uint64_t unionPostings;   // documents in the resulting union lists
+    bool truncated;           // a cap dropped matching terms
+    double expandMs;          // dictionary scan
+    double mergeMs;           // building the union lists
+
+    ExpansionStats() : patterns(0), matchedTerms(0), expandedTerms(0), mergedPostings(0),
+                       unionPostings(0), truncated(false), expandMs(0.0), mergeMs(0.0) {}
+};
+
+/**
+ * @brief Expands '*' patterns against the sorted lexicon and merges the
+ *        matching posting lists into one virtual list.
+ *
+ * Matching terms are taken in decreasing df order until maxTerms or
+ * maxPostings is reached (the most frequent match is always kept). The union
+ * list holds every document containing any expansion with the tfs summed, so
+ * the pattern scores like a single term whose df is the union size; it is
+ * opened as a DecodedPostings and feeds the AND/OR evaluators unchanged.
+*/
+class TermExpander {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Open the union list of a pattern.
+     * @param meta Receives df (union size) and cf of the virtual term.
+     * @return false if the pattern is rejected or matches nothing.
+     */
+    static bool open(const Lexicon& lexicon, const std::string& indexDir, const std::string& pattern,
+                     const ExpansionOptions& options, ExpansionStats& stats,
+                     TermMeta& meta, PostingList& list) {
+        stats.patterns++;
+        std::vector<const TermMeta*> metas = expand(lexicon, pattern, options, stats);
+        if (metas.empty()) return false;
+
+        auto mergeStart = Clock::now();
+        auto postings = unionOf(metas, indexDir, stats);
+        stats.mergeMs += std::chrono::duration<double, std::milli>(Clock::now() - mergeStart).count();
+        if (!postings || postings->docIDs.empty()) return false;
+
+        meta = TermMeta();
+        meta.df = static_cast<uint32_t>(postings->docIDs.size());
+        for (const TermMeta* m : metas) meta.cf += m->cf;
+        stats.unionPostings += meta.df;
+        return list.open(std::move(postings));
+    }
+
+    /**
+     * @brief Matching terms within the caps, most frequent first.
+     */
+    static std::vector<const TermMeta*> expand(const Lexicon& lexicon, const std::string& pattern,
+                                               const ExpansionOptions& options, ExpansionStats& stats) {
+        std::vector<const TermMeta*> selected;
+        std::string prefix = wildcard::literalPrefix(pattern);
+        if (prefix.size() < options.minPrefix) {
+            stats.truncated = true;
+            return selected;
+        }
+
+        auto expandStart = Clock::now();
+        std::vector<const TermMeta*> matches;
+        bool prefixOnly = pattern.find('*') == pattern.size() - 1;
+        lexicon.forEachPrefix(prefix, [&](const std::string& term, const TermMeta& meta) {
+            if (prefixOnly || wildcard::match(pattern, term)) matches.push_back(&meta);
+            return true;
+        });
+        stats.matchedTerms += matches.size();
+
+        size_t keep = std::min(matches.size(), std::max<size_t>(options.maxTerms, 1));
+        std::partial_sort(matches.begin(), matches.begin() + keep, matches.end(),
+                          [](const TermMeta* a, const TermMeta* b) { return a->df > b->df; });
+
+        uint64_t postings = 0;
+        for (size_t i = 0; i < keep; i++) {
+            if (!selected.empty() && postings + matches[i]->df > options.maxPostings) break;
+            postings += matches[i]->df;
+            selected.push_back(matches[i]);
+        }
+        if (selected.size() < matches.size()) stats.truncated = true;
+        stats.expandedTerms += selected.size();
+        stats.expandMs += std::chrono::duration<double, std::milli>(Clock::now() - expandStart).count();
+        return selected;
+    }
+
+private:
+    // k-way merge of the expanded lists, summing tfs of shared documents
+    static std::shared_ptr<DecodedPostings> unionOf(const std::vector<const TermMeta*>& metas,
+                                                    const std::string& indexDir, ExpansionStats& stats) {
+        std::vector<PostingList> lists(metas.size());
+        using Head = std::pair<uint32_t, size_t>;   // (docID, list)
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+        uint64_t total = 0;
+        for (size_t i = 0; i < metas.size(); i++) {
+            if (lists[i].open(*metas[i], indexDir)) {
+                heads.push({lists[i].doc(), i});
+                total += metas[i]->df;
+            }
+        }
+
+        auto merged = std::make_shared<DecodedPostings>();
+        merged->docIDs.reserve(total);
+        merged->freqs.reserve(total);
+        while (!heads.empty()) {
+            auto [doc, i] = heads.top();
+            heads.pop();
+            if (!merged->docIDs.empty() && merged->docIDs.back() == doc) {
+                merged->freqs.back() += lists[i].freq();
+            } else {
+                merged->docIDs.push_back(doc);
+                merged->freqs.push_back(lists[i].freq());
+            }
+            if (lists[i].next()) heads.push({lists[i].doc(), i});
+        }
+        stats.mergedPostings += total;
+        return merged;
+    }
+};
+
+#endif // TERM_EXPANSION_HPP
@@ -0,0 +1,84 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed-size worker pool with a FIFO task queue.
+ *
+ * Tasks are submitted as callables and their results are returned through
+ * std::future. Workers are joined on destruction after the queue drains.
+*/
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable cv;
+    bool stopping;
+
+    void workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t numThreads) : stopping(false) {
+        if (numThreads == 0) numThreads = 1;
+        workers.reserve(numThreads);
+        for (size_t i = 0; i < numThreads; i++) {
+            workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto& w : workers) {
+            if (w.joinable()) w.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Queue a task for execution.
+     * @return Future holding the task's result (or exception).
+     */
+    template <typename F>
+    auto submit(F&& f) -> std::future<decltype(f())> {
+        using R = decltype(f());
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        std::future<R> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            tasks.emplace([task] { (*task)(); });
+        }
+        cv.notify_one();
+        return result;
+    }
+
+    size_t size() const { return workers.size(); }
+};
+
+#endif // THREAD_POOL_HPP
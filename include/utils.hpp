@@ -4,14 +4,41 @@
 #include <vector>
 #include <string>
 #include <cctype>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
-inline std::vector<std::string> tokenize_words(const std::string& text) {
+// number of set bits
+inline uint32_t popcount64(uint64_t x) {
+#ifdef _MSC_VER
+    return static_cast<uint32_t>(__popcnt64(x));
+#else
+    return static_cast<uint32_t>(__builtin_popcountll(x));
+#endif
+}
+
+// index of the lowest set bit; x must not be 0
+inline uint32_t ctz64(uint64_t x) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return static_cast<uint32_t>(index);
+#else
+    return static_cast<uint32_t>(__builtin_ctzll(x));
+#endif
+}
+
+// keepWildcards: '*' stays part of a token (query patterns such as comput*)
+inline std::vector<std::string> tokenize_words(const std::string& text, bool keepWildcards = false) {
     std::vector<std::string> tokens;
     std::string cur;
     cur.reserve(text.size());      
 
     for (unsigned char uc : text) {     
-        if (std::isalnum(uc)) {
+        if (keepWildcards && uc == '*') {
+            cur.push_back(static_cast<char>(uc));
+        } else if (std::isalnum(uc)) {
             cur.push_back(std::tolower(uc));
         } else if (!cur.empty()) {      
             tokens.push_back(std::move(cur));
@@ -6,8 +6,15 @@
 #include <vector>
 #include <algorithm>
 #include <cctype>
+#include <cmath>
+#include <cstdlib>
 #include <filesystem>
+#include <iomanip>
+#include <memory>
+#include <thread>
 #include "utils.hpp"
+#include "near_dup.hpp"
+#include "thread_pool.hpp"
 
 namespace fs = std::filesystem;
 
@@ -46,12 +53,30 @@ inline std::string makeSnippet(const std::string& text, size_t maxLen = 60) {
  * This class processes the raw document collection and generates:
  * 1. Document table mapping internal docIDs to original IDs
  * 2. Document content storage for snippet generation
- * 3. Flat posting files (term, docID, tf triples)
+ * 3. Flat posting files (term, docID, tf triples; with positions enabled a
+ *    4th column lists the term's token positions, comma-separated)
  * 
  * Features:
  * - Streaming processing for memory efficiency
  * - Automatic partitioning into multiple files to avoid single huge files
  * - Preserves all terms (no stopword filtering)
+ *
+ * With --weighted[=SCALE], documents come pre-weighted by an offline term
+ * weighting / expansion model instead of as raw text:
+ *     docID \t term:weight term:weight ... [\t text]
+ * Each weight is quantized to the integer impact round(weight * SCALE)
+ * (default 100) and written in the tf column; terms whose impact rounds to
+ * 0 are dropped. The optional text column is stored for snippets (the term
+ * list otherwise). Merge the postings with merger --impacts.
+ *
+ * With --near-dups=drop|link, passages are read in batches whose MinHash
+ * signatures are computed in parallel; each passage is then checked against
+ * the canonical passages before it (NearDupDetector, near_dup.hpp). A
+ * near-duplicate is either dropped (no docID, postings or content) or
+ * indexed and linked to its canonical docID in doc_canonical.bin, which
+ * lets queries collapse each cluster to its best result. Every duplicate
+ * is listed in near_dups.tsv, and the postings / content bytes it costs
+ * are reported at the end.
  */
 class IndexBuilder {
 private:
@@ -68,6 +93,31 @@ private:
     size_t partByteLimit;           // Byte threshold for each partition
     size_t bytesWrittenInPart;      // Bytes written in current partition
     size_t linesWrittenInPart;      // Lines written in current partition
+    bool withPositions;             // Emit the positions column
+    double impactScale;             // > 0: input is term:weight lists, quantized with this scale
+    uint64_t malformedWeights;      // term:weight entries that could not be parsed
+    uint64_t totalPostings;         // postings written over all partitions
+    
+    // near-duplicate stage (--near-dups)
+    static constexpr size_t DEDUP_BATCH = 8192;   // passages per parallel signature batch
+    
+    struct PendingDoc {
+        std::string name;
+        std::string content;
+        std::string weights;
+        bool weighted;
+    };
+    
+    std::string nearDupMode;                    // "", "drop" or "link"
+    std::unique_ptr<NearDupDetector> detector;
+    std::unique_ptr<ThreadPool> signaturePool;
+    std::vector<PendingDoc> pending;
+    std::ofstream nearDupReport;                // near_dups.tsv
+    std::vector<uint32_t> canonicalOf;          // docID -> canonical docID (link mode)
+    uint64_t inputDocs;
+    uint64_t nearDups;
+    uint64_t nearDupPostings;                   // postings of the duplicates (distinct terms)
+    uint64_t nearDupBytes;                      // content bytes of the duplicates
     
     /**
      * Open a new posting partition file
@@ -101,10 +151,149 @@ private:
         }
     }
     
+    /**
+     * Write postings: term<TAB>docID<TAB>tf
+     */
+    void writePostings(const std::string& content) {
+        // Compute term frequencies for this document
+        std::unordered_map<std::string, uint32_t> termFreq;
+        termFreq.reserve(256);  // Pre-allocate to reduce rehashing
+        
+        for (const auto& token : tokenize_words(content)) {
+            termFreq[token]++;
+        }
+        
+        for (const auto& kv : termFreq) {
+            const std::string& term = kv.first;
+            uint32_t tf = kv.second;
+            
+            postingsOut << term << "\t" << currentDocID << "\t" << tf << "\n";
+            
+            // Estimate bytes written (avoid frequent tellp() calls for efficiency)
+            bytesWrittenInPart += term.size() + 1 + 10 + 1 + 5 + 1;
+            linesWrittenInPart++;
+            totalPostings++;
+        }
+    }
+    
+    /**
+     * Write impact postings: term<TAB>docID<TAB>impact, from "term:weight ..."
+     * (weights of repeated terms add up)
+     */
+    void writeImpactPostings(const std::string& weights) {
+        std::unordered_map<std::string, double> termWeight;
+        termWeight.reserve(256);
+        
+        std::istringstream in(weights);
+        std::string entry;
+        while (in >> entry) {
+            size_t colon = entry.rfind(':');
+            char* end = nullptr;
+            double weight = colon == std::string::npos ? 0.0 : std::strtod(entry.c_str() + colon + 1, &end);
+            if (colon == 0 || colon == std::string::npos || end == entry.c_str() + colon + 1 || *end != '\0' ||
+                !std::isfinite(weight)) {
+                malformedWeights++;
+                continue;
+            }
+            termWeight[entry.substr(0, colon)] += weight;
+        }
+        
+        for (const auto& kv : termWeight) {
+            long impact = std::lround(kv.second * impactScale);
+            if (impact <= 0) continue;
+            
+            postingsOut << kv.first << "\t" << currentDocID << "\t" << impact << "\n";
+            
+            bytesWrittenInPart += kv.first.size() + 1 + 10 + 1 + 5 + 1;
+            linesWrittenInPart++;
+            totalPostings++;
+        }
+    }
+    
+    /**
+     * Index a batch of passages with near-duplicate detection
+     *
+     * Signatures are independent, so they are computed on the pool; the
+     * LSH lookups run in input order, so a passage is only ever linked to
+     * an earlier canonical passage and the result does not depend on the
+     * number of threads.
+     */
+    void flushPending() {
+        std::vector<NearDupSignature> signatures(pending.size());
+        size_t chunk = (pending.size() + signaturePool->size() - 1) / signaturePool->size();
+        std::vector<std::future<void>> done;
+        for (size_t begin = 0; begin < pending.size(); begin += chunk) {
+            size_t end = std::min(pending.size(), begin + chunk);
+            done.push_back(signaturePool->submit([this, &signatures, begin, end] {
+                for (size_t i = begin; i < end; i++) signatures[i] = NearDupDetector::signature(pending[i].content);
+            }));
+        }
+        for (auto& f : done) f.get();
+        
+        for (size_t i = 0; i < pending.size(); i++) {
+            PendingDoc& doc = pending[i];
+            uint32_t canonical;
+            double similarity;
+            bool duplicate = detector->find(signatures[i], canonical, similarity);
+            if (duplicate) {
+                nearDups++;
+                nearDupPostings += signatures[i].distinctTerms;
+                nearDupBytes += doc.content.size();
+                nearDupReport << doc.name << "\t";
+                if (nearDupMode == "link") {
+                    nearDupReport << currentDocID;
+                } else {
+                    nearDupReport << "-";
+                }
+                nearDupReport << "\t" << canonical << "\t" << similarity << "\n";
+                if (nearDupMode == "drop") continue;
+            } else {
+                canonical = currentDocID;
+                detector->add(signatures[i], canonical);
+            }
+            if (nearDupMode == "link") canonicalOf.push_back(canonical);
+            parseDocument(doc.name, doc.content, doc.weighted ? &doc.weights : nullptr);
+        }
+        pending.clear();
+    }
+    
+    /**
+     * Write postings with positions: term<TAB>docID<TAB>tf<TAB>p1,p2,...
+     * (0-based token positions, ascending)
+     */
+    void writePositionalPostings(const std::string& content) {
+        std::unordered_map<std::string, std::vector<uint32_t>> termPositions;
+        termPositions.reserve(256);
+        
+        uint32_t position = 0;
+        for (auto& token : tokenize_words(content)) {
+            termPositions[std::move(token)].push_back(position++);
+        }
+        
+        for (const auto& kv : termPositions) {
+            const std::string& term = kv.first;
+            const std::vector<uint32_t>& positions = kv.second;
+            
+            postingsOut << term << "\t" << currentDocID << "\t" << positions.size() << "\t";
+            for (size_t i = 0; i < positions.size(); i++) {
+                if (i > 0) postingsOut << ',';
+                postingsOut << positions[i];
+            }
+            postingsOut << "\n";
+            
+            bytesWrittenInPart += term.size() + 1 + 10 + 1 + 5 + 1 + positions.size() * 5;
+            linesWrittenInPart++;
+            totalPostings++;
+        }
+    }
+    
 public:
-    IndexBuilder(const std::string& outDir, size_t partBytes = (size_t)2ULL * 1024 * 1024 * 1024) 
+    IndexBuilder(const std::string& outDir, size_t partBytes = (size_t)2ULL * 1024 * 1024 * 1024,
+                 bool positions = false, double scale = 0.0) 
         : currentDocID(0), outputDir(outDir), batchNumber(0),
-          partByteLimit(partBytes), bytesWrittenInPart(0), linesWrittenInPart(0) {
+          partByteLimit(partBytes), bytesWrittenInPart(0), linesWrittenInPart(0),
+          withPositions(positions), impactScale(scale), malformedWeights(0), totalPostings(0),
+          inputDocs(0), nearDups(0), nearDupPostings(0), nearDupBytes(0) {
         
         fs::create_directories(outputDir);
         
@@ -136,6 +325,24 @@ public:
         }
     }
    
+    /**
+     * Detect near-duplicates (mode "drop" or "link") with the given
+     * estimated Jaccard similarity threshold, on `threads` threads
+     */
+    void enableNearDups(const std::string& mode, double threshold, size_t threads) {
+        nearDupMode = mode;
+        detector = std::make_unique<NearDupDetector>(threshold);
+        signaturePool = std::make_unique<ThreadPool>(threads);
+        pending.reserve(DEDUP_BATCH);
+        nearDupReport.open(outputDir + "/near_dups.tsv");
+        if (!nearDupReport.is_open()) {
+            std::cerr << "Failed to open " << outputDir << "/near_dups.tsv" << std::endl;
+            exit(1);
+        }
+        nearDupReport << "# duplicate\tdocID\tcanonical_docID\tsimilarity\n";
+        nearDupReport.precision(3);
+    }
+    
     /**
      * Parse a single document and generate postings
      * 
@@ -144,9 +351,11 @@ public:
      * 2. Store full document content for later snippet generation
      * 3. Record content offset and length
      * 4. Tokenize document and compute term frequencies
-     * 5. Write postings (term, docID, tf) to current partition
+     * 5. Write postings (term, docID, tf[, positions]) to current partition
+     * With a weighted input, step 4 parses `weights` (term:weight list) instead.
      */
-    void parseDocument(const std::string& docName, const std::string& content) {
+    void parseDocument(const std::string& docName, const std::string& content,
+                       const std::string* weights = nullptr) {
         // Write document table entry
         docTableFile << currentDocID << "\t" << docName << "\n";
         
@@ -168,24 +377,12 @@ public:
         docOffsetFile.write(reinterpret_cast<const char*>(&offset), sizeof(uint64_t));
         docOffsetFile.write(reinterpret_cast<const char*>(&length), sizeof(uint32_t));
         
-        // Compute term frequencies for this document
-        std::unordered_map<std::string, uint32_t> termFreq;
-        termFreq.reserve(256);  // Pre-allocate to reduce rehashing
-        
-        for (const auto& token : tokenize_words(content)) {
-            termFreq[token]++;
-        }
-        
-        // Write postings: term<TAB>docID<TAB>tf
-        for (const auto& kv : termFreq) {
-            const std::string& term = kv.first;
-            uint32_t tf = kv.second;
-            
-            postingsOut << term << "\t" << currentDocID << "\t" << tf << "\n";
-            
-            // Estimate bytes written (avoid frequent tellp() calls for efficiency)
-            bytesWrittenInPart += term.size() + 1 + 10 + 1 + 5 + 1;
-            linesWrittenInPart++;
+        if (weights) {
+            writeImpactPostings(*weights);
+        } else if (withPositions) {
+            writePositionalPostings(content);
+        } else {
+            writePostings(content);
         }
         
         currentDocID++;
@@ -198,6 +395,16 @@ public:
      * Finalize indexing: close all files and print summary
      */
     void finalize() {
+        if (detector) {
+            if (!pending.empty()) flushPending();
+            nearDupReport.close();
+            if (nearDupMode == "link") {
+                std::ofstream canonicalFile(outputDir + "/doc_canonical.bin", std::ios::out | std::ios::binary);
+                canonicalFile.write(reinterpret_cast<const char*>(canonicalOf.data()),
+                                    canonicalOf.size() * sizeof(uint32_t));
+                if (!canonicalFile) std::cerr << "Warning: Failed to write doc_canonical.bin" << std::endl;
+            }
+        }
         if (postingsOut.is_open()) {
             std::cout << "Batch " << batchNumber << " written: " 
                       << linesWrittenInPart << " postings (~" 
@@ -211,8 +418,25 @@ public:
         std::cout << "\nIndexing complete!" << std::endl;
         std::cout << "Total documents processed: " << currentDocID << std::endl;
         std::cout << "Total intermediate files: " << (batchNumber + 1) << std::endl;
+        if (detector) {
+            bool dropped = nearDupMode == "drop";
+            uint64_t indexed = totalPostings + (dropped ? nearDupPostings : 0);
+            std::cout << std::fixed << std::setprecision(2);
+            std::cout << "Near-duplicates: " << nearDups << " of " << inputDocs << " passages ("
+                      << (inputDocs ? 100.0 * nearDups / inputDocs : 0.0) << "%), "
+                      << (dropped ? "dropped" : "linked in doc_canonical.bin") << ", listed in near_dups.tsv" << std::endl;
+            std::cout << (dropped ? "Saved: " : "Dropping them would save: ") << nearDupPostings << " postings ("
+                      << (indexed ? 100.0 * nearDupPostings / indexed : 0.0) << "%), "
+                      << (nearDupBytes / 1024) << " KB of content" << std::endl;
+        }
+        if (impactScale > 0) {
+            std::cout << "Malformed term:weight entries skipped: " << malformedWeights << std::endl;
+        }
         std::cout << "\nNext step: Use msort to globally sort posting files:" << std::endl;
         std::cout << "  Example: msort -t '\\t' -k 1,1 -k 2,2n postings_part_*.tsv > postings_sorted.tsv" << std::endl;
+        if (impactScale > 0) {
+            std::cout << "Then merge with: merger postings_sorted.tsv ./index --impacts" << std::endl;
+        }
     }
     
     /**
@@ -243,7 +467,22 @@ public:
             std::string docName = line.substr(0, tabPos);
             std::string content = line.substr(tabPos + 1);
             
-            parseDocument(docName, content);
+            std::string weights;
+            if (impactScale > 0) {
+                // docID \t term:weight ... [\t text]
+                size_t textPos = content.find('\t');
+                weights = content.substr(0, textPos);
+                if (textPos != std::string::npos) content = content.substr(textPos + 1);
+            }
+            
+            inputDocs++;
+            if (detector) {
+                pending.push_back({std::move(docName), std::move(content), std::move(weights), impactScale > 0});
+                if (pending.size() == DEDUP_BATCH) flushPending();
+                continue;
+            }
+            
+            parseDocument(docName, content, impactScale > 0 ? &weights : nullptr);
         }
         
         inFile.close();
@@ -253,10 +492,17 @@ public:
 
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        std::cout << "Usage: " << argv[0] << " <input_file> <output_dir> [part_size_gb]" << std::endl;
+        std::cout << "Usage: " << argv[0] << " <input_file> <output_dir> [part_size_gb] [--positions] [--weighted[=SCALE]]"
+                  << " [--near-dups=drop|link] [--near-dup-threshold=J]" << std::endl;
         std::cout << "Example: " << argv[0] << " collection.tsv ./index_output" << std::endl;
         std::cout << "         " << argv[0] << " collection.tsv ./index_output 4" << std::endl;
         std::cout << "  part_size_gb: Size of each intermediate file in GB (default: 2)" << std::endl;
+        std::cout << "  --positions:  Also record token positions (phrase / NEAR queries)" << std::endl;
+        std::cout << "  --weighted:   Input is docID<TAB>term:weight ...[<TAB>text]; weights are stored" << std::endl;
+        std::cout << "                as integer impacts round(weight * SCALE) (default 100)" << std::endl;
+        std::cout << "  --near-dups=drop|link  Detect near-duplicate passages (MinHash + LSH) and drop them," << std::endl;
+        std::cout << "                or index them linked to their canonical docID (doc_canonical.bin, querier --collapse)" << std::endl;
+        std::cout << "  --near-dup-threshold=J Estimated Jaccard similarity of word 3-shingles (default: 0.9)" << std::endl;
         return 1;
     }
     
@@ -264,17 +510,55 @@ int main(int argc, char* argv[]) {
     std::string outputDir = argv[2];
     
     size_t partSizeGB = 2;
-    if (argc >= 4) {
-        partSizeGB = std::stoull(argv[3]);
+    bool positions = false;
+    double impactScale = 0.0;
+    std::string nearDups;
+    double nearDupThreshold = 0.9;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--positions") {
+            positions = true;
+        } else if (arg == "--weighted") {
+            impactScale = 100.0;
+        } else if (arg.find("--near-dups=") == 0) {
+            nearDups = arg.substr(12);
+            if (nearDups != "drop" && nearDups != "link") {
+                std::cerr << "--near-dups must be drop or link" << std::endl;
+                return 1;
+            }
+        } else if (arg.find("--near-dup-threshold=") == 0) {
+            nearDupThreshold = std::stod(arg.substr(21));
+        } else if (arg.find("--weighted=") == 0) {
+            impactScale = std::stod(arg.substr(11));
+            if (impactScale <= 0) {
+                std::cerr << "--weighted scale must be positive" << std::endl;
+                return 1;
+            }
+        } else {
+            partSizeGB = std::stoull(arg);
+        }
     }
     size_t partBytes = partSizeGB * 1024ULL * 1024ULL * 1024ULL;
     
+    if (positions && impactScale > 0) {
+        std::cerr << "--positions cannot be combined with --weighted (the input has no token positions)" << std::endl;
+        return 1;
+    }
+    
     std::cout << "Building inverted index (Phase 1: Indexing)..." << std::endl;
     std::cout << "Input: " << inputFile << std::endl;
     std::cout << "Output: " << outputDir << std::endl;
     std::cout << "Part size: " << partSizeGB << " GB" << std::endl;
+    std::cout << "Positions: " << (positions ? "yes" : "no") << std::endl;
+    if (impactScale > 0) std::cout << "Weighted input, impact scale: " << impactScale << std::endl;
     
-    IndexBuilder builder(outputDir, partBytes);
+    IndexBuilder builder(outputDir, partBytes, positions, impactScale);
+    if (!nearDups.empty()) {
+        size_t threads = std::max(1u, std::thread::hardware_concurrency());
+        std::cout << "Near-duplicates: " << nearDups << ", threshold " << nearDupThreshold
+                  << ", " << threads << " threads" << std::endl;
+        builder.enableNearDups(nearDups, nearDupThreshold, threads);
+    }
     
     builder.processMSMARCO(inputFile);
     
@@ -7,9 +7,11 @@
 #include <algorithm>
 #include <filesystem>
 #include <cstdint>
-#include "varbyte.hpp"
-
-namespace fs = std::filesystem;
+#include <cstdlib>
+#include <memory>
+#include "index_writer.hpp"
+#include "index_reader.hpp"
+#include "bm25.hpp"
 
 /**
  * IndexMerger: Merges sorted postings into a compressed inverted index
@@ -20,65 +22,172 @@ namespace fs = std::filesystem;
  * - Block-compressed frequencies (VarByte encoded)
  * - Lexicon mapping terms to posting list offsets
  * - Index statistics for BM25 scoring
+ * The on-disk format itself is produced by IndexWriter (index_writer.hpp).
+ *
+ * With --tiers=N, every list longer than N postings is also split by BM25
+ * impact: its N highest-impact postings go to tier1/ (a second index in the
+ * same format) and the largest impact left in the tail goes to tier1/tiers.tsv.
+ * The tier lists are the precomputed top-N results of the single-term
+ * queries; the evaluator also seeds its OR pruning threshold from them.
+ *
+ * With --dense-ratio=R, every list in more than R * N documents also gets a
+ * Roaring copy (roaring.hpp) in postings.dense.bin, indexed by dense.tsv;
+ * readers use it instead of the gap-encoded blocks, which compress such
+ * lists poorly and are slow to skip through. The blocks are kept for the
+ * tools that read the index block by block. Positional indexes need the
+ * block-aligned positions, so they get no dense copies.
+ *
+ * With --forward, the lists are also inverted back into a forward index
+ * (ForwardIndexWriter): the sorted term IDs and tfs of every document, for
+ * features that need a document's terms without re-tokenizing its text.
+ *
+ * With --impacts, the tf column holds learned term impacts (indexer
+ * --weighted) and stats.txt marks the index for dot-product scoring. The
+ * per-block max tf in the skip entries then is the block's maximum score
+ * contribution per unit of query weight. Tiers rank postings by BM25, so
+ * they are not built for such an index.
  */
 class IndexMerger {
 private:
-    // Block size for compression (number of postings per block)
-    static constexpr size_t BLOCK_SIZE = 128;
     // Buffer size for efficient I/O operations
     static constexpr size_t READ_BUFFER_SIZE = 8 * 1024 * 1024;
     
+    using Posting = IndexWriter::Posting;
+    
     // Input/output paths
     std::string inputFile;      // Sorted postings file from Phase 1
     std::string outputDir;      // Output directory for index files
     
-    // Output file streams
-    std::ofstream docIdsFile;   // Block-compressed docIDs
-    std::ofstream freqsFile;    // Block-compressed frequencies
-    std::ofstream lexiconFile;  // Term dictionary (text format for debugging)
-    std::ofstream statsFile;    // Index statistics
+    IndexWriter writer;         // Block-compressed postings, lexicon and statistics
     
-    // Statistics accumulators
-    uint64_t totalTerms;        // Total number of unique terms
-    uint64_t totalPostings;     // Total number of postings
-    uint64_t docCount;          // Total number of documents
-    std::vector<uint32_t> docLengths;  // Document lengths for BM25 avgdl
+    // High-impact tier (0 = disabled)
+    uint32_t tierSize;
+    std::vector<std::pair<std::string, TermMeta>> tierTerms;  // lists longer than tierSize
     
-    // Posting structure for in-memory representation
-    struct Posting {
-        uint32_t docID;
-        uint32_t frequency;
-        
-        Posting(uint32_t d, uint32_t f) : docID(d), frequency(f) {}
-    };
+    // Roaring copies of dense lists (0 = disabled)
+    double denseRatio;
+    std::vector<std::pair<std::string, TermMeta>> denseTerms;  // candidates, filtered once N is known
     
-public:
-    IndexMerger(const std::string& input, const std::string& outDir)
-        : inputFile(input), outputDir(outDir),
-          totalTerms(0), totalPostings(0), docCount(0) {
+    // Per-document term vectors (nullptr = disabled)
+    std::unique_ptr<ForwardIndexWriter> forward;
+    
+    // append the comma-separated positions after `tab`; exactly tf are expected
+    static bool parsePositions(const std::string& line, size_t tab, uint32_t tf,
+                               std::vector<uint32_t>& out) {
+        if (tab == std::string::npos) return false;
+        size_t before = out.size();
+        const char* p = line.c_str() + tab + 1;
+        while (*p) {
+            char* end;
+            out.push_back(static_cast<uint32_t>(std::strtoul(p, &end, 10)));
+            if (end == p) return false;
+            p = (*end == ',') ? end + 1 : end;
+        }
+        return out.size() - before == tf;
+    }
+    
+    void writeList(const std::string& term, const std::vector<Posting>& postings,
+                   const std::vector<uint32_t>& positions) {
+        TermMeta meta = writer.writeInvertedList(term, postings,
+                                                 writer.hasPositions() ? &positions : nullptr);
+        if (forward) forward->addList(term, postings);
+        if (tierSize > 0 && meta.df > tierSize) {
+            tierTerms.emplace_back(term, meta);
+        }
+        // N only grows, so every final dense list passes this test when written
+        if (denseRatio > 0 && meta.df > denseRatio * writer.documentCount()) {
+            denseTerms.emplace_back(term, meta);
+        }
+    }
+    
+    /**
+     * Write postings.dense.bin and dense.tsv for the lists that are dense in
+     * the finished index (df > denseRatio * N).
+     */
+    void buildDense() {
+        uint64_t N = writer.documentCount();
+        std::vector<std::pair<std::string, TermMeta>> dense;
+        for (const auto& entry : denseTerms) {
+            if (entry.second.df > denseRatio * N) dense.push_back(entry);
+        }
+        writeDenseLists(outputDir, dense);
+    }
+    
+    /**
+     * Build tier1/ from the finished index
+     *
+     * Impacts need avgdl, so this runs after all lists are written: each long
+     * list is decoded again, its postings are ranked by BM25 impact (default
+     * k1/b), and the top tierSize postings are written in docID order.
+     */
+    void buildTiers() {
+        const std::vector<uint32_t>& docLengths = writer.documentLengths();
+        uint64_t totalDocLength = 0;
+        for (uint32_t len : docLengths) totalDocLength += len;
+        uint64_t N = writer.documentCount();
+        double avgdl = (N > 0) ? static_cast<double>(totalDocLength) / N : 0.0;
+        bm25::Params params;
         
-        fs::create_directories(outputDir);
+        std::string tierDir = outputDir + "/tier1";
+        IndexWriter tierWriter(tierDir);
+        std::ofstream tiersFile(tierDir + "/tiers.tsv");
+        if (!tiersFile.is_open()) {
+            std::cerr << "Failed to open " << tierDir << "/tiers.tsv" << std::endl;
+            exit(1);
+        }
+        tiersFile << "# k1\t" << params.k1 << "\n";
+        tiersFile << "# b\t" << params.b << "\n";
+        tiersFile.precision(17);
         
-        docIdsFile.open(outputDir + "/postings.docids.bin", 
-                        std::ios::out | std::ios::binary);
-        freqsFile.open(outputDir + "/postings.freqs.bin", 
-                       std::ios::out | std::ios::binary);
-        lexiconFile.open(outputDir + "/lexicon.tsv", 
-                         std::ios::out);
+        std::vector<double> impacts;
+        std::vector<uint32_t> order;
+        std::vector<Posting> tierPostings;
+        uint64_t tierPostingCount = 0;
         
-        if (!docIdsFile.is_open() || !freqsFile.is_open() || !lexiconFile.is_open()) {
-            std::cerr << "Failed to open output files" << std::endl;
-            exit(1);
+        for (const auto& entry : tierTerms) {
+            auto decoded = PostingList::decodeAll(entry.second, outputDir);
+            if (!decoded) continue;
+            
+            double idf = bm25::idf(N, entry.second.df);
+            size_t n = decoded->docIDs.size();
+            impacts.resize(n);
+            order.resize(n);
+            for (size_t i = 0; i < n; i++) {
+                uint32_t docID = decoded->docIDs[i];
+                uint32_t dl = docID < docLengths.size() ? docLengths[docID] : 0;
+                impacts[i] = bm25::score(idf, decoded->freqs[i], dl, avgdl, params);
+                order[i] = static_cast<uint32_t>(i);
+            }
+            
+            // top tierSize postings by impact (ties broken by docID)
+            auto byImpact = [&impacts](uint32_t a, uint32_t b) {
+                return impacts[a] != impacts[b] ? impacts[a] > impacts[b] : a < b;
+            };
+            std::nth_element(order.begin(), order.begin() + tierSize, order.end(), byImpact);
+            
+            double tailMax = 0.0;
+            for (size_t i = tierSize; i < n; i++) tailMax = std::max(tailMax, impacts[order[i]]);
+            
+            std::sort(order.begin(), order.begin() + tierSize);
+            tierPostings.clear();
+            for (size_t i = 0; i < tierSize; i++) {
+                tierPostings.emplace_back(decoded->docIDs[order[i]], decoded->freqs[order[i]]);
+            }
+            tierWriter.writeInvertedList(entry.first, tierPostings);
+            tiersFile << entry.first << "\t" << tailMax << "\n";
+            tierPostingCount += tierPostings.size();
         }
         
-        lexiconFile << "# term\tdf\tcf\tdocids_offset\tfreqs_offset\tblocks_count\n";
+        std::cout << "Tier 1: " << tierTerms.size() << " terms, "
+                  << tierPostingCount << " postings (" << tierSize << " per term)" << std::endl;
     }
     
-    ~IndexMerger() {
-        if (docIdsFile.is_open()) docIdsFile.close();
-        if (freqsFile.is_open()) freqsFile.close();
-        if (lexiconFile.is_open()) lexiconFile.close();
-        if (statsFile.is_open()) statsFile.close();
+public:
+    IndexMerger(const std::string& input, const std::string& outDir, uint32_t tiers = 0, double dense = 0.0,
+                bool withForward = false, bool impacts = false)
+        : inputFile(input), outputDir(outDir), writer(outDir), tierSize(tiers), denseRatio(dense) {
+        if (withForward) forward = std::make_unique<ForwardIndexWriter>(outDir);
+        writer.setImpactScoring(impacts);
     }
     
     /**
@@ -104,13 +213,16 @@ public:
         std::cout << "Merging sorted postings into compressed index..." << std::endl;
         std::cout << "Input: " << inputFile << std::endl;
         std::cout << "Output: " << outputDir << std::endl;
-        std::cout << "Block size: " << BLOCK_SIZE << std::endl;
+        std::cout << "Block size: " << IndexWriter::BLOCK_SIZE << std::endl;
+        if (writer.hasImpacts()) std::cout << "Scoring: impact" << std::endl;
         
         // Streaming processing: read line by line, group by term
         std::string line;
         std::string currentTerm;
         std::vector<Posting> currentPostings;
         currentPostings.reserve(1024);  // Pre-allocate for efficiency
+        std::vector<uint32_t> currentPositions;  // concatenated positions (if present)
+        bool firstLine = true;
         
         uint64_t linesProcessed = 0;
         
@@ -125,205 +237,129 @@ public:
                 continue;
             }
             
-            // Parse line: term<TAB>docID<TAB>tf
+            // Parse line: term<TAB>docID<TAB>tf[<TAB>pos,pos,...]
             std::string term = line.substr(0, tab1);
             uint32_t docID = std::stoul(line.substr(tab1 + 1, tab2 - tab1 - 1));
             uint32_t tf = std::stoul(line.substr(tab2 + 1));
+            size_t tab3 = line.find('\t', tab2 + 1);
             
-            // Update document count
-            if (docID >= docCount) {
-                docCount = docID + 1;
+            // a positions column on the first line turns on the positions file
+            if (firstLine) {
+                if (tab3 != std::string::npos) {
+                    writer.enablePositions();
+                    std::cout << "Positions: yes" << std::endl;
+                }
+                firstLine = false;
             }
             
+            // Update document count
+            writer.ensureDocCount(static_cast<uint64_t>(docID) + 1);
+            
             // Check if we've moved to a new term
             if (term != currentTerm) {
                 if (!currentPostings.empty()) {
                     // Write out the inverted list for the previous term
-                    writeInvertedList(currentTerm, currentPostings);
+                    writeList(currentTerm, currentPostings, currentPositions);
                     currentPostings.clear();
+                    currentPositions.clear();
                 }
                 currentTerm = term;
             }
             
             // Accumulate posting for current term
             currentPostings.emplace_back(docID, tf);
+            if (writer.hasPositions() && !parsePositions(line, tab3, tf, currentPositions)) {
+                std::cerr << "Error: expected " << tf << " positions: " << line << std::endl;
+                exit(1);
+            }
             
             linesProcessed++;
             if (linesProcessed % 10000000 == 0) {
                 std::cout << "Processed " << (linesProcessed / 1000000) 
-                          << "M postings, " << totalTerms << " terms..." << std::endl;
+                          << "M postings, " << writer.termCount() << " terms..." << std::endl;
             }
         }
         
         // Write out the last term
         if (!currentPostings.empty()) {
-            writeInvertedList(currentTerm, currentPostings);
+            writeList(currentTerm, currentPostings, currentPositions);
         }
         
         inFile.close();
         
         // Write statistics and document lengths
-        writeStats();
-        
-        std::cout << "\nMerging complete!" << std::endl;
-        std::cout << "Total terms: " << totalTerms << std::endl;
-        std::cout << "Total postings: " << totalPostings << std::endl;
-        std::cout << "Total documents: " << docCount << std::endl;
-    }
-    
-private:
-    /**
-     * Write inverted list for a single term using block compression
-     * 
-     * Format:
-     * - docIDs: block_size + gap-encoded docID sequence (VarByte)
-     * - frequencies: block_size + tf sequence (VarByte)
-     * - lexicon: term metadata (df, cf, offsets, block count)
-     */
-    void writeInvertedList(const std::string& term, const std::vector<Posting>& postings) {
-        if (postings.empty()) return;
-        
-        // Record file offsets before writing
-        uint64_t docIdsOffset = docIdsFile.tellp();
-        uint64_t freqsOffset = freqsFile.tellp();
-        
-        // Calculate statistics
-        uint32_t df = static_cast<uint32_t>(postings.size());  // Document frequency
-        uint64_t cf = 0;  // Collection frequency (sum of all tf)
-        
-        // Write in blocks for compression efficiency
-        size_t blocksCount = 0;
-        for (size_t i = 0; i < postings.size(); i += BLOCK_SIZE) {
-            size_t blockLen = std::min(BLOCK_SIZE, postings.size() - i);
-            
-            writeDocIDsBlock(postings, i, blockLen);
-            
-            writeFrequenciesBlock(postings, i, blockLen, cf);
-            
-            blocksCount++;
-        }
-        
-        lexiconFile << term << "\t" 
-                    << df << "\t" 
-                    << cf << "\t"
-                    << docIdsOffset << "\t" 
-                    << freqsOffset << "\t"
-                    << blocksCount << "\n";
-        
-        totalTerms++;
-        totalPostings += df;
-    }
-    
-    /**
-     * Write docIDs block with gap encoding and VarByte compression
-     * 
-     * Block format: block_length + docID_sequence
-     * docID_sequence uses gap encoding: first docID is absolute,
-     * subsequent docIDs are stored as gaps (docID[i] - docID[i-1])
-     */
-    void writeDocIDsBlock(const std::vector<Posting>& postings, 
-                          size_t start, size_t length) {
-        varbyte::encode(docIdsFile, static_cast<uint32_t>(length));
-        
-        uint32_t prevDocID = 0;
-        for (size_t i = 0; i < length; i++) {
-            uint32_t docID = postings[start + i].docID;
-            uint32_t gap = (i == 0) ? docID : (docID - prevDocID);
-            varbyte::encode(docIdsFile, gap);
-            prevDocID = docID;
-        }
-    }
-    
-    /**
-     * Write frequencies block with VarByte compression
-     * 
-     * Block format: block_length + tf_sequence
-     * Also updates collection frequency (cf) and document lengths
-     * for BM25 avgdl calculation
-     */
-    void writeFrequenciesBlock(const std::vector<Posting>& postings, 
-                               size_t start, size_t length, uint64_t& cf) {
-        varbyte::encode(freqsFile, static_cast<uint32_t>(length));
+        writer.writeStats();
+        writer.close();
         
-        for (size_t i = 0; i < length; i++) {
-            uint32_t tf = postings[start + i].frequency;
-            varbyte::encode(freqsFile, tf);
-            cf += tf;
-            
-            // Update document length for BM25 avgdl calculation
-            uint32_t docID = postings[start + i].docID;
-            if (docID >= docLengths.size()) {
-                docLengths.resize(docID + 1, 0);
+        if (tierSize > 0) {
+            if (writer.hasImpacts()) {
+                std::cout << "Tier 1: skipped (impact-scored index)" << std::endl;
+            } else {
+                buildTiers();
             }
-            docLengths[docID] += tf;
         }
-    }
-    
-    /**
-     * Write statistics file and document lengths file
-     * 
-     * Outputs:
-     * - doc_len.bin: binary file with document lengths (needed for BM25)
-     * - stats.txt: text file with index statistics (doc_count, avgdl, etc.)
-     */
-    void writeStats() {
-        std::ofstream docLenFile(outputDir + "/doc_len.bin", std::ios::out | std::ios::binary);
-        if (docLenFile.is_open()) {
-            for (uint32_t len : docLengths) {
-                docLenFile.write(reinterpret_cast<const char*>(&len), sizeof(uint32_t));
+        if (denseRatio > 0) {
+            if (writer.hasPositions()) {
+                std::cout << "Dense lists: skipped (positional index)" << std::endl;
+            } else {
+                buildDense();
             }
-            docLenFile.close();
-            std::cout << "Wrote document lengths for " << docLengths.size() << " documents" << std::endl;
-        } else {
-            std::cerr << "Warning: Failed to write doc_len.bin" << std::endl;
         }
-        
-        statsFile.open(outputDir + "/stats.txt", std::ios::out);
-        if (!statsFile.is_open()) {
-            std::cerr << "Failed to open stats file" << std::endl;
-            return;
+        if (forward) {
+            forward->finish(writer.documentCount());
         }
         
-        uint64_t totalDocLength = 0;
-        for (uint32_t len : docLengths) {
-            totalDocLength += len;
-        }
-        double avgdl = (docCount > 0) ? static_cast<double>(totalDocLength) / docCount : 0.0;
-        
-        statsFile << "# Index Statistics\n";
-        statsFile << "doc_count\t" << docCount << "\n";
-        statsFile << "total_terms\t" << totalTerms << "\n";
-        statsFile << "total_postings\t" << totalPostings << "\n";
-        statsFile << "avgdl\t" << avgdl << "\n";
-        statsFile << "total_doc_length\t" << totalDocLength << "\n";
-        
-        statsFile.close();
-        
-        std::cout << "Average document length: " << avgdl << std::endl;
+        std::cout << "\nMerging complete!" << std::endl;
+        std::cout << "Total terms: " << writer.termCount() << std::endl;
+        std::cout << "Total postings: " << writer.postingCount() << std::endl;
+        std::cout << "Total documents: " << writer.documentCount() << std::endl;
     }
 };
 
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        std::cout << "Usage: " << argv[0] << " <sorted_postings_file> <output_dir>" << std::endl;
+        std::cout << "Usage: " << argv[0] << " <sorted_postings_file> <output_dir> [--tiers=N] [--dense-ratio=R] [--forward] [--impacts]" << std::endl;
         std::cout << "Example: " << argv[0] << " postings_sorted.tsv ./index" << std::endl;
         std::cout << "\nThis program merges sorted postings into a compressed inverted index." << std::endl;
-        std::cout << "Input format: term<TAB>docID<TAB>tf (sorted by term, then by docID)" << std::endl;
+        std::cout << "Input format: term<TAB>docID<TAB>tf[<TAB>positions] (sorted by term, then by docID)" << std::endl;
         std::cout << "\nOutput files:" << std::endl;
         std::cout << "  - postings.docids.bin: Compressed docIDs (gap-encoded VarByte)" << std::endl;
         std::cout << "  - postings.freqs.bin: Compressed frequencies (VarByte)" << std::endl;
+        std::cout << "  - postings.skips.bin: Per-block skip entries (last docID, offsets, max tf)" << std::endl;
+        std::cout << "  - postings.positions.bin: Term positions (if the input has a positions column)" << std::endl;
         std::cout << "  - lexicon.tsv: Term dictionary with offsets" << std::endl;
         std::cout << "  - stats.txt: Index statistics (doc_count, avgdl, etc.)" << std::endl;
+        std::cout << "  - tier1/: with --tiers=N, the N highest-impact postings of each longer list" << std::endl;
+        std::cout << "  - postings.dense.bin, dense.tsv: with --dense-ratio=R, Roaring copies of lists in > R*N documents" << std::endl;
+        std::cout << "  - forward.bin, forward.blocks.bin, forward.terms.tsv: with --forward, term IDs and tfs per document" << std::endl;
+        std::cout << "\nWith --impacts, the tf column holds learned impacts (indexer --weighted), scored by dot product." << std::endl;
         return 1;
     }
     
     std::string inputFile = argv[1];
     std::string outputDir = argv[2];
+    uint32_t tiers = 0;
+    double denseRatio = 0.0;
+    bool withForward = false;
+    bool impacts = false;
+    
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.find("--tiers=") == 0) {
+            tiers = static_cast<uint32_t>(std::stoul(arg.substr(8)));
+        } else if (arg.find("--dense-ratio=") == 0) {
+            denseRatio = std::stod(arg.substr(14));
+        } else if (arg == "--forward") {
+            withForward = true;
+        } else if (arg == "--impacts") {
+            impacts = true;
+        }
+    }
     
     std::cout << "Inverted Index Merger (Phase 2)" << std::endl;
     std::cout << "===============================" << std::endl;
     
-    IndexMerger merger(inputFile, outputDir);
+    IndexMerger merger(inputFile, outputDir, tiers, denseRatio, withForward, impacts);
     merger.process();
     
     std::cout << "\nIndex merging phase 2 complete!" << std::endl;
@@ -0,0 +1,241 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
+
+#include "index_reader.hpp"
+#include "index_writer.hpp"
+#include "utils.hpp"
+
+/**
+ * PairBuilder: materializes intersected posting lists of frequent term pairs
+ *
+ * Runs after Phase 2 (or reorder / prune: docIDs are taken from the index).
+ * Candidate pairs come from a query log (every pair of distinct terms in a
+ * query, counted once per query) or, without a log, from co-occurrence: all
+ * pairs of the topTerms most frequent terms, ranked by intersection size.
+ * The first maxPairs candidates whose intersection has at least minPostings
+ * documents are written to <index_dir>/pairs/ (format in PairIndex); smaller
+ * intersections are cheap to compute at query time and are not worth the
+ * space. QueryEvaluator substitutes the pair lists in AND queries. A pair in
+ * which either term has a tf above PairIndex::MAX_TF is skipped, so its
+ * queries use the plain lists and score exactly as without pairs.
+ */
+class PairBuilder {
+private:
+    std::string indexDir;
+    uint32_t maxPairs;
+    uint32_t topTerms;
+    uint32_t minPostings;
+    std::string queryLog;
+
+    // decoded lists are cached up to this many postings, then the cache restarts
+    static constexpr uint64_t MAX_CACHED_POSTINGS = 64 * 1024 * 1024;
+
+    Lexicon lexicon;
+    std::unordered_map<std::string, std::shared_ptr<const DecodedPostings>> decoded;
+    uint64_t cachedPostings = 0;
+
+    struct Candidate {
+        std::string a;     // a < b
+        std::string b;
+        uint64_t count;    // queries containing the pair, or intersection size
+    };
+
+    std::shared_ptr<const DecodedPostings> postings(const std::string& term) {
+        auto it = decoded.find(term);
+        if (it != decoded.end()) return it->second;
+        TermMeta meta;
+        std::shared_ptr<const DecodedPostings> list;
+        if (lexicon.find(term, meta)) list = PostingList::decodeAll(meta, indexDir);
+        if (list) {
+            if (cachedPostings + list->docIDs.size() > MAX_CACHED_POSTINGS) {
+                decoded.clear();
+                cachedPostings = 0;
+            }
+            cachedPostings += list->docIDs.size();
+        }
+        return decoded[term] = list;
+    }
+
+    /**
+     * Documents containing both terms, freqs packed as in PairIndex
+     * @return false if a tf exceeded PairIndex::MAX_TF and was clamped
+     */
+    static bool intersect(const DecodedPostings& a, const DecodedPostings& b,
+                          std::vector<IndexWriter::Posting>& out) {
+        out.clear();
+        bool exact = true;
+        size_t i = 0, j = 0;
+        while (i < a.docIDs.size() && j < b.docIDs.size()) {
+            if (a.docIDs[i] < b.docIDs[j]) {
+                i++;
+            } else if (a.docIDs[i] > b.docIDs[j]) {
+                j++;
+            } else {
+                out.emplace_back(a.docIDs[i], PairIndex::pack(a.freqs[i], b.freqs[j]));
+                exact = exact && a.freqs[i] <= PairIndex::MAX_TF && b.freqs[j] <= PairIndex::MAX_TF;
+                i++;
+                j++;
+            }
+        }
+        return exact;
+    }
+
+    bool logCandidates(std::vector<Candidate>& candidates) {
+        std::ifstream file(queryLog);
+        if (!file.is_open()) {
+            std::cerr << "Cannot open query log: " << queryLog << std::endl;
+            return false;
+        }
+        std::unordered_map<std::string, uint64_t> counts;
+        std::string line;
+        size_t queries = 0;
+        while (std::getline(file, line)) {
+            size_t tab = line.find('\t');
+            std::vector<std::string> terms = tokenize_words(tab == std::string::npos ? line : line.substr(tab + 1));
+            std::sort(terms.begin(), terms.end());
+            terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+            for (size_t i = 0; i < terms.size(); i++) {
+                for (size_t j = i + 1; j < terms.size(); j++) counts[terms[i] + "|" + terms[j]]++;
+            }
+            queries++;
+        }
+        for (const auto& [key, count] : counts) {
+            size_t bar = key.find('|');
+            candidates.push_back({key.substr(0, bar), key.substr(bar + 1), count});
+        }
+        std::cout << "Query log: " << queries << " queries, " << candidates.size() << " distinct pairs" << std::endl;
+        return true;
+    }
+
+    void cooccurrenceCandidates(std::vector<Candidate>& candidates) {
+        std::vector<std::pair<uint32_t, std::string>> frequent;
+        for (const auto& [term, meta] : lexicon.entries()) frequent.push_back({meta.df, term});
+        size_t n = std::min<size_t>(frequent.size(), topTerms);
+        std::partial_sort(frequent.begin(), frequent.begin() + n, frequent.end(), std::greater<>());
+
+        std::vector<IndexWriter::Posting> both;
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = i + 1; j < n; j++) {
+                const std::string& a = std::min(frequent[i].second, frequent[j].second);
+                const std::string& b = std::max(frequent[i].second, frequent[j].second);
+                auto pa = postings(a);
+                auto pb = postings(b);
+                if (!pa || !pb) continue;
+                intersect(*pa, *pb, both);
+                candidates.push_back({a, b, both.size()});
+            }
+        }
+        std::cout << "Co-occurrence: " << candidates.size() << " pairs of the " << n << " most frequent terms" << std::endl;
+    }
+
+public:
+    PairBuilder(const std::string& dir, uint32_t pairs, uint32_t terms, uint32_t minSize, const std::string& log)
+        : indexDir(dir), maxPairs(pairs), topTerms(terms), minPostings(minSize), queryLog(log) {}
+
+    bool process() {
+        if (!lexicon.load(indexDir + "/lexicon.tsv")) return false;
+
+        std::vector<Candidate> candidates;
+        if (!queryLog.empty()) {
+            if (!logCandidates(candidates)) return false;
+        } else {
+            cooccurrenceCandidates(candidates);
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate& x, const Candidate& y) {
+            if (x.count != y.count) return x.count > y.count;
+            return x.a != y.a ? x.a < y.a : x.b < y.b;
+        });
+
+        std::string pairDir = indexDir + "/pairs";
+        IndexWriter writer(pairDir);
+        std::ofstream pairsFile(pairDir + "/pairs.tsv");
+        if (!pairsFile.is_open()) {
+            std::cerr << "Failed to open " << pairDir << "/pairs.tsv" << std::endl;
+            return false;
+        }
+        pairsFile << "# a\tb\tcount\tdf\n";
+
+        std::vector<IndexWriter::Posting> both;
+        uint32_t written = 0;
+        uint32_t clamped = 0;
+        uint64_t totalPostings = 0;
+        for (const auto& c : candidates) {
+            if (written >= maxPairs) break;
+            auto pa = postings(c.a);
+            auto pb = postings(c.b);
+            if (!pa || !pb) continue;
+            bool exact = intersect(*pa, *pb, both);
+            if (both.size() < minPostings) continue;
+            // a clamped tf would score differently from the plain lists
+            if (!exact) {
+                clamped++;
+                continue;
+            }
+
+            writer.writeInvertedList(PairIndex::key(c.a, c.b), both);
+            pairsFile << c.a << "\t" << c.b << "\t" << c.count << "\t" << both.size() << "\n";
+            written++;
+            totalPostings += both.size();
+        }
+        writer.close();
+
+        std::cout << "\nPair lists complete!" << std::endl;
+        std::cout << "Pairs: " << written << std::endl;
+        if (clamped > 0) {
+            std::cout << "Skipped: " << clamped << " pairs with a tf above " << PairIndex::MAX_TF << std::endl;
+        }
+        std::cout << "Postings: " << totalPostings << std::endl;
+        return true;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " <index_dir> [options]" << std::endl;
+        std::cout << "Example: " << argv[0] << " ./index --pairs=1000 --queries=queries.tsv" << std::endl;
+        std::cout << "\nWrites <index_dir>/pairs/ (intersected lists of frequent term pairs, used by AND queries)." << std::endl;
+        std::cout << "  --pairs=N          Pair lists to build (default: 1000)" << std::endl;
+        std::cout << "  --queries=FILE     Rank pairs by query log frequency (query or qid<TAB>query lines)" << std::endl;
+        std::cout << "  --top-terms=N      Without a log: pairs of the N most frequent terms (default: 64)" << std::endl;
+        std::cout << "  --min-postings=N   Skip pairs whose intersection is smaller (default: 10000)" << std::endl;
+        return 1;
+    }
+
+    std::string indexDir = argv[1];
+    uint32_t pairs = 1000;
+    uint32_t topTerms = 64;
+    uint32_t minPostings = 10000;
+    std::string queryLog;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.find("--pairs=") == 0) {
+            pairs = static_cast<uint32_t>(std::stoul(arg.substr(8)));
+        } else if (arg.find("--queries=") == 0) {
+            queryLog = arg.substr(10);
+        } else if (arg.find("--top-terms=") == 0) {
+            topTerms = static_cast<uint32_t>(std::stoul(arg.substr(12)));
+        } else if (arg.find("--min-postings=") == 0) {
+            minPostings = static_cast<uint32_t>(std::stoul(arg.substr(15)));
+        }
+    }
+
+    std::cout << "Pair List Builder" << std::endl;
+    std::cout << "=================" << std::endl;
+    std::cout << "Index: " << indexDir << std::endl;
+    std::cout << "Candidates: " << (queryLog.empty() ? "co-occurrence" : "query log (" + queryLog + ")") << std::endl;
+
+    PairBuilder builder(indexDir, pairs, topTerms, minPostings, queryLog);
+    if (!builder.process()) {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,484 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_set>
+#include <unordered_map>
+#include <filesystem>
+#include <memory>
+#include <cmath>
+#include <cstdint>
+
+#include "index_reader.hpp"
+#include "index_writer.hpp"
+#include "querier.hpp"
+#include "bm25.hpp"
+#include "utils.hpp"
+
+/**
+ * IndexPruner: static index pruning by BM25 impact
+ *
+ * Runs after Phase 2 (or after reorder). Every posting gets its BM25
+ * contribution (impact) and low-impact postings are dropped until about the
+ * requested fraction of postings is left:
+ * - term-centric (Carmel et al.): a posting is kept if its impact is at least
+ *   eps * z_t, where z_t is the term's k-th highest impact. A single global eps
+ *   is chosen for the target size, capped at 1 so every term keeps its top k.
+ * - doc-centric (Buttcher & Clarke): each document keeps the highest-impact
+ *   fraction of its own postings.
+ *
+ * The output is a complete index (lexicon df/cf and blocks describe the pruned
+ * lists). The full-index df of every shortened list goes to idf_df.tsv, which
+ * the lexicon reads back for idf; with document lengths, doc count and avgdl
+ * copied from the input, surviving postings score as before. The optional
+ * parts follow the kept postings: positions are written for them, dense lists
+ * get new Roaring copies, and tier1/ and pairs/ keep only postings whose
+ * documents are still in the pruned lists (the tier tail bounds stay upper
+ * bounds). doc_order.bin / doc_prior.bin and the forward index describe the
+ * documents, not the lists, and are copied. With --queries, both indexes are
+ * queried and overlap@10 is reported next to the size reduction.
+ */
+class IndexPruner {
+private:
+    // resolution of the eps search (term-centric), over ratios in [0, 1]
+    static constexpr size_t HISTOGRAM_BINS = 10000;
+
+    std::string inputDir;
+    std::string outputDir;
+    std::string method;         // "term" or "doc"
+    double keepFraction;        // target fraction of postings to keep
+    uint32_t topK;              // k for z_t (term-centric)
+
+    Lexicon lexicon;
+    Stats stats;
+    DocLen docLen;
+    bm25::Params params;
+
+    std::vector<std::string> terms;     // lexicon terms in output order
+
+    double epsilon;                             // term-centric threshold
+    std::vector<float> docThreshold;            // doc-centric threshold per docID
+
+    void computeImpacts(const TermMeta& meta, const DecodedPostings& postings,
+                        std::vector<double>& impacts) const {
+        impacts.resize(postings.docIDs.size());
+        if (stats.impacts) {
+            // learned sparse index: the stored tf is the score contribution
+            for (size_t i = 0; i < postings.docIDs.size(); i++) impacts[i] = postings.freqs[i];
+            return;
+        }
+        double idf = bm25::idf(stats.doc_count, meta.scoringDf());
+        for (size_t i = 0; i < postings.docIDs.size(); i++) {
+            impacts[i] = bm25::score(idf, postings.freqs[i], docLen.len(postings.docIDs[i]),
+                                     stats.avgdl, params);
+        }
+    }
+
+    // k-th highest impact of a list (the highest if the list is shorter)
+    double kthImpact(std::vector<double> impacts) const {
+        size_t k = std::min<size_t>(topK, impacts.size());
+        std::nth_element(impacts.begin(), impacts.begin() + (k - 1), impacts.end(),
+                         std::greater<double>());
+        return impacts[k - 1];
+    }
+
+    /**
+     * Term-centric: histogram impact / z_t over all postings and pick the
+     * largest eps that keeps at least keepFraction of them
+     */
+    void chooseEpsilon() {
+        std::vector<uint64_t> histogram(HISTOGRAM_BINS + 1, 0);
+        std::vector<double> impacts;
+        uint64_t total = 0;
+
+        for (const auto& term : terms) {
+            const TermMeta& meta = lexicon.entries().at(term);
+            auto decoded = PostingList::decodeAll(meta, inputDir);
+            if (!decoded) continue;
+            computeImpacts(meta, *decoded, impacts);
+
+            double z = kthImpact(impacts);
+            for (double impact : impacts) {
+                double ratio = z > 0.0 ? impact / z : 1.0;
+                size_t bin = ratio >= 1.0 ? HISTOGRAM_BINS
+                                          : static_cast<size_t>(ratio * HISTOGRAM_BINS);
+                histogram[bin]++;
+            }
+            total += impacts.size();
+        }
+
+        // walk down from ratio 1 until enough postings are kept
+        uint64_t target = static_cast<uint64_t>(std::ceil(keepFraction * total));
+        uint64_t kept = 0;
+        size_t bin = HISTOGRAM_BINS;
+        while (true) {
+            kept += histogram[bin];
+            if (kept >= target || bin == 0) break;
+            bin--;
+        }
+        epsilon = static_cast<double>(bin) / HISTOGRAM_BINS;
+        std::cout << "Term-centric threshold: eps=" << epsilon << " (z_t = impact of rank "
+                  << topK << ")" << std::endl;
+    }
+
+    /**
+     * Doc-centric: gather each document's impacts and keep its top
+     * ceil(keepFraction * postings) of them
+     */
+    void chooseDocThresholds() {
+        std::vector<std::vector<float>> docImpacts(stats.doc_count);
+        std::vector<double> impacts;
+
+        for (const auto& term : terms) {
+            const TermMeta& meta = lexicon.entries().at(term);
+            auto decoded = PostingList::decodeAll(meta, inputDir);
+            if (!decoded) continue;
+            computeImpacts(meta, *decoded, impacts);
+            for (size_t i = 0; i < impacts.size(); i++) {
+                uint32_t docID = decoded->docIDs[i];
+                if (docID < docImpacts.size()) {
+                    docImpacts[docID].push_back(static_cast<float>(impacts[i]));
+                }
+            }
+        }
+
+        docThreshold.assign(stats.doc_count, 0.0f);
+        for (size_t d = 0; d < docImpacts.size(); d++) {
+            auto& values = docImpacts[d];
+            if (values.empty()) continue;
+            size_t keep = std::max<size_t>(1, static_cast<size_t>(std::ceil(keepFraction * values.size())));
+            std::nth_element(values.begin(), values.begin() + (keep - 1), values.end(),
+                             std::greater<float>());
+            docThreshold[d] = values[keep - 1];
+            std::vector<float>().swap(values);
+        }
+        std::cout << "Doc-centric thresholds computed for " << docImpacts.size() << " documents" << std::endl;
+    }
+
+    bool keepPosting(uint32_t docID, double impact, double z) const {
+        if (method == "doc") {
+            return docID >= docThreshold.size() || static_cast<float>(impact) >= docThreshold[docID];
+        }
+        return impact >= epsilon * z;
+    }
+
+    static uint64_t fileSize(const std::string& path) {
+        std::error_code ec;
+        uint64_t size = std::filesystem::file_size(path, ec);
+        return ec ? 0 : size;
+    }
+
+    static uint64_t postingsBytes(const std::string& dir) {
+        return fileSize(dir + "/postings.docids.bin") + fileSize(dir + "/postings.freqs.bin") +
+               fileSize(dir + "/postings.skips.bin");
+    }
+
+    // full-index df of the shortened lists, so idf survives pruning
+    bool writeIdfDf(const std::vector<std::pair<std::string, uint32_t>>& shortened) const {
+        std::ofstream out(outputDir + "/idf_df.tsv");
+        if (!out.is_open()) {
+            std::cerr << "Cannot write " << outputDir << "/idf_df.tsv" << std::endl;
+            return false;
+        }
+        out << "# term\tdf (before pruning)\n";
+        for (const auto& [term, df] : shortened) out << term << '\t' << df << '\n';
+        return static_cast<bool>(out);
+    }
+
+    // the prior files and the forward index describe documents, which pruning leaves unchanged
+    void copyDocFiles() {
+        for (const char* name : {"doc_order.bin", "doc_prior.bin",
+                                 "forward.bin", "forward.blocks.bin", "forward.terms.tsv"}) {
+            std::string from = inputDir + "/" + name;
+            if (!std::filesystem::exists(from)) continue;
+            std::filesystem::copy_file(from, outputDir + "/" + name,
+                                       std::filesystem::copy_options::overwrite_existing);
+        }
+    }
+
+    /**
+     * Rewrite a sub-index of the input (tier1/: one list per term, pairs/:
+     * one per "a|b" key) with the postings whose document is still in the
+     * pruned list of every term of the key; the sidecar file is copied
+     */
+    bool filterSubIndex(const std::string& name, const std::string& sidecar, const Lexicon& pruned) {
+        std::string from = inputDir + "/" + name;
+        std::string to = outputDir + "/" + name;
+        if (!std::filesystem::exists(from + "/lexicon.tsv")) return true;
+
+        Lexicon sub;
+        if (!sub.load(from + "/lexicon.tsv")) return false;
+        std::vector<std::string> keys;
+        keys.reserve(sub.size());
+        for (const auto& kv : sub.entries()) keys.push_back(kv.first);
+        std::sort(keys.begin(), keys.end());
+
+        IndexWriter subWriter(to);
+        std::unordered_map<std::string, std::shared_ptr<DecodedPostings>> prunedLists;
+        std::vector<IndexWriter::Posting> postings;
+        uint64_t before = 0;
+        uint64_t after = 0;
+        for (const auto& key : keys) {
+            auto decoded = PostingList::decodeAll(sub.entries().at(key), from);
+            if (!decoded) {
+                std::cerr << "Failed to read " << name << "/ list " << key << std::endl;
+                return false;
+            }
+            before += decoded->docIDs.size();
+
+            std::vector<const std::vector<uint32_t>*> lists;
+            size_t bar = key.find('|');
+            for (const std::string& term : {key.substr(0, bar),
+                                            bar == std::string::npos ? std::string() : key.substr(bar + 1)}) {
+                if (term.empty()) continue;
+                auto& list = prunedLists[term];
+                TermMeta meta;
+                if (!list && pruned.find(term, meta)) list = PostingList::decodeAll(meta, outputDir);
+                if (!list) {
+                    lists.clear();
+                    break;
+                }
+                lists.push_back(&list->docIDs);
+            }
+
+            postings.clear();
+            std::vector<size_t> cursors(lists.size(), 0);
+            for (size_t i = 0; i < decoded->docIDs.size() && !lists.empty(); i++) {
+                uint32_t docID = decoded->docIDs[i];
+                bool kept = true;
+                for (size_t t = 0; t < lists.size() && kept; t++) {
+                    const auto& docIDs = *lists[t];
+                    while (cursors[t] < docIDs.size() && docIDs[cursors[t]] < docID) cursors[t]++;
+                    kept = cursors[t] < docIDs.size() && docIDs[cursors[t]] == docID;
+                }
+                if (kept) postings.emplace_back(docID, decoded->freqs[i]);
+            }
+            if (postings.empty()) continue;
+            subWriter.writeInvertedList(key, postings);
+            after += postings.size();
+        }
+        subWriter.close();
+        std::filesystem::copy_file(from + "/" + sidecar, to + "/" + sidecar,
+                                   std::filesystem::copy_options::overwrite_existing);
+        std::cout << "Filtered " << name << "/: " << before << " -> " << after << " postings" << std::endl;
+        return true;
+    }
+
+public:
+    IndexPruner(const std::string& in, const std::string& out, const std::string& m,
+                double keep, uint32_t k)
+        : inputDir(in), outputDir(out), method(m), keepFraction(keep), topK(k), epsilon(0.0) {}
+
+    bool process() {
+        if (!lexicon.load(inputDir + "/lexicon.tsv") ||
+            !stats.load(inputDir + "/stats.txt") ||
+            !docLen.load(inputDir + "/doc_len.bin")) {
+            return false;
+        }
+
+        terms.reserve(lexicon.size());
+        for (const auto& kv : lexicon.entries()) terms.push_back(kv.first);
+        std::sort(terms.begin(), terms.end());
+
+        if (method == "doc") {
+            chooseDocThresholds();
+        } else {
+            chooseEpsilon();
+        }
+
+        IndexWriter writer(outputDir);
+        writer.setImpactScoring(stats.impacts);
+        bool positional = std::filesystem::exists(inputDir + "/postings.positions.bin");
+        if (positional) writer.enablePositions();
+        std::vector<uint32_t> lengths(stats.doc_count);
+        for (size_t d = 0; d < lengths.size(); d++) lengths[d] = docLen.len(static_cast<uint32_t>(d));
+
+        std::vector<IndexWriter::Posting> postings;
+        std::vector<double> impacts;
+        std::vector<uint32_t> positions;
+        std::vector<uint32_t> keptPositions;
+        uint64_t inputPostings = 0;
+        uint64_t droppedTerms = 0;
+        std::vector<std::pair<std::string, uint32_t>> shortened;
+        std::vector<std::pair<std::string, TermMeta>> denseLists;
+        for (const auto& term : terms) {
+            const TermMeta& meta = lexicon.entries().at(term);
+            positions.clear();
+            auto decoded = PostingList::decodeAll(meta, inputDir, positional ? &positions : nullptr);
+            if (!decoded) {
+                std::cerr << "Failed to read the list of " << term << std::endl;
+                return false;
+            }
+            computeImpacts(meta, *decoded, impacts);
+            double z = (method == "doc") ? 0.0 : kthImpact(impacts);
+
+            postings.clear();
+            keptPositions.clear();
+            size_t position = 0;
+            for (size_t i = 0; i < impacts.size(); i++) {
+                uint32_t tf = decoded->freqs[i];
+                if (keepPosting(decoded->docIDs[i], impacts[i], z)) {
+                    postings.emplace_back(decoded->docIDs[i], tf);
+                    if (positional) {
+                        keptPositions.insert(keptPositions.end(), positions.begin() + position,
+                                             positions.begin() + position + tf);
+                    }
+                }
+                position += tf;
+            }
+            inputPostings += impacts.size();
+            if (postings.empty()) {
+                droppedTerms++;
+                continue;
+            }
+            TermMeta written = writer.writeInvertedList(term, postings, positional ? &keptPositions : nullptr);
+            if (meta.hasDense) denseLists.emplace_back(term, written);
+            if (postings.size() < meta.scoringDf()) shortened.emplace_back(term, meta.scoringDf());
+        }
+
+        writer.setDocumentLengths(lengths);
+        writer.writeStats();
+        writer.close();
+        if (!writeIdfDf(shortened)) return false;
+        copyDocFiles();
+        if (!denseLists.empty()) writeDenseLists(outputDir, denseLists);
+
+        Lexicon pruned;
+        if (std::filesystem::exists(inputDir + "/tier1") || std::filesystem::exists(inputDir + "/pairs")) {
+            if (!pruned.load(outputDir + "/lexicon.tsv") ||
+                !filterSubIndex("tier1", "tiers.tsv", pruned) ||
+                !filterSubIndex("pairs", "pairs.tsv", pruned)) {
+                return false;
+            }
+        }
+
+        uint64_t inBytes = postingsBytes(inputDir);
+        uint64_t outBytes = postingsBytes(outputDir);
+        std::cout << "\nPruning complete!" << std::endl;
+        std::cout << "Method: " << method << ", target keep fraction: " << keepFraction << std::endl;
+        std::cout << "Postings: " << inputPostings << " -> " << writer.postingCount() << " ("
+                  << (inputPostings ? 100.0 * writer.postingCount() / inputPostings : 0.0) << "%)" << std::endl;
+        std::cout << "Terms: " << terms.size() << " -> " << writer.termCount()
+                  << " (" << droppedTerms << " lists emptied, " << shortened.size()
+                  << " shortened; idf keeps the full df)" << std::endl;
+        std::cout << "Posting files: " << inBytes << " -> " << outBytes << " bytes ("
+                  << (inBytes ? 100.0 * outBytes / inBytes : 0.0) << "%)" << std::endl;
+        return true;
+    }
+
+    /**
+     * Overlap@k of OR-mode results between the input and the pruned index,
+     * averaged over the queries that return results on the input index
+     */
+    bool reportOverlap(const std::string& queryFile, int k) {
+        std::ifstream file(queryFile);
+        if (!file.is_open()) {
+            std::cerr << "Cannot open query file: " << queryFile << std::endl;
+            return false;
+        }
+
+        Lexicon prunedLexicon;
+        Stats prunedStats;
+        DocLen prunedDocLen;
+        if (!prunedLexicon.load(outputDir + "/lexicon.tsv") ||
+            !prunedStats.load(outputDir + "/stats.txt") ||
+            !prunedDocLen.load(outputDir + "/doc_len.bin")) {
+            return false;
+        }
+
+        // evaluators only need postings and statistics; no snippets are produced
+        DocTable docTable;
+        DocContentFile docContent;
+        QueryEvaluator full(lexicon, stats, docLen, docTable, docContent, inputDir, params);
+        QueryEvaluator pruned(prunedLexicon, prunedStats, prunedDocLen, docTable, docContent,
+                              outputDir, params);
+
+        double overlapSum = 0.0;
+        size_t evaluated = 0;
+        size_t exact = 0;
+        std::string line;
+        while (std::getline(file, line)) {
+            // accept "qid<TAB>query" as well as plain query lines
+            size_t tab = line.find('\t');
+            if (tab != std::string::npos) line = line.substr(tab + 1);
+
+            std::vector<std::string> tokens = tokenize_words(line);
+            std::unordered_set<std::string> uniqueSet(tokens.begin(), tokens.end());
+            std::vector<std::string> queryTerms(uniqueSet.begin(), uniqueSet.end());
+            if (queryTerms.empty()) continue;
+
+            auto reference = full.processQuery(queryTerms, "or", k);
+            if (reference.empty()) continue;
+            auto candidate = pruned.processQuery(queryTerms, "or", k);
+
+            std::unordered_set<uint32_t> referenceDocs;
+            for (const auto& r : reference) referenceDocs.insert(r.docID);
+            size_t common = 0;
+            for (const auto& r : candidate) common += referenceDocs.count(r.docID);
+
+            overlapSum += static_cast<double>(common) / reference.size();
+            if (common == reference.size()) exact++;
+            evaluated++;
+        }
+
+        std::cout << "\nOverlap@" << k << " over " << evaluated << " queries: "
+                  << (evaluated ? overlapSum / evaluated : 0.0)
+                  << " (identical top-" << k << ": " << exact << ")" << std::endl;
+        return true;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cout << "Usage: " << argv[0] << " <index_dir> <output_dir> [options]" << std::endl;
+        std::cout << "Example: " << argv[0] << " ./index ./index_pruned --keep=0.5 --queries=queries.tsv" << std::endl;
+        std::cout << "\nRemoves low-impact postings (BM25 contribution) to build a smaller index." << std::endl;
+        std::cout << "  --keep=F           Target fraction of postings to keep (default: 0.5)" << std::endl;
+        std::cout << "  --method=term|doc  Term-centric or document-centric pruning (default: term)" << std::endl;
+        std::cout << "  --k=N              Term-centric: every term keeps its top N postings (default: 10)" << std::endl;
+        std::cout << "  --queries=FILE     Report overlap@10 with the input index (query or qid<TAB>query lines)" << std::endl;
+        return 1;
+    }
+
+    std::string inputDir = argv[1];
+    std::string outputDir = argv[2];
+    double keep = 0.5;
+    std::string method = "term";
+    uint32_t k = 10;
+    std::string queryFile;
+
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.find("--keep=") == 0) {
+            keep = std::stod(arg.substr(7));
+        } else if (arg.find("--method=") == 0) {
+            method = arg.substr(9);
+        } else if (arg.find("--k=") == 0) {
+            k = static_cast<uint32_t>(std::stoul(arg.substr(4)));
+        } else if (arg.find("--queries=") == 0) {
+            queryFile = arg.substr(10);
+        }
+    }
+
+    if (keep <= 0.0 || keep > 1.0 || (method != "term" && method != "doc") || k == 0) {
+        std::cerr << "Invalid options: --keep must be in (0, 1], --method term|doc, --k > 0" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Static Index Pruner" << std::endl;
+    std::cout << "===================" << std::endl;
+    std::cout << "Input: " << inputDir << std::endl;
+    std::cout << "Output: " << outputDir << std::endl;
+
+    IndexPruner pruner(inputDir, outputDir, method, keep, k);
+    if (!pruner.process()) {
+        return 1;
+    }
+    if (!queryFile.empty() && !pruner.reportOverlap(queryFile, 10)) {
+        return 1;
+    }
+
+    return 0;
+}
@@ -23,11 +23,40 @@ int main(int argc, char* argv[]) {
         std::cout << "  --k=N            Number of results (default: 10)" << std::endl;
         std::cout << "  --k1=X           BM25 k1 parameter (default: 0.9)" << std::endl;
         std::cout << "  --b=X            BM25 b parameter (default: 0.4)" << std::endl;
+        std::cout << "  --max-postings=N Stop after scoring N postings (anytime mode, default: off)" << std::endl;
+        std::cout << "  --prior-weight=X Add X * static prior to scores (reordered index, default: 0)" << std::endl;
+        std::cout << "  --no-tiers       Ignore the high-impact tier (index built with merger --tiers=N)" << std::endl;
+        std::cout << "  --no-pairs       Ignore precomputed pair lists (built with pair_builder)" << std::endl;
+        std::cout << "  --rerank-depth=N Re-rank the top N in a second stage (default: off)" << std::endl;
+        std::cout << "  --pair-weight=X  Weight of the term-pair proximity score (default: 1)" << std::endl;
+        std::cout << "  --span-weight=X  Weight of the minimal-span score (default: 1)" << std::endl;
+        std::cout << "  --reranker=FILE  Second-stage model (linear or gbdt); default: BM25 + proximity" << std::endl;
+        std::cout << "  --dump-features=FILE  Append query/docID/feature rows of re-ranked candidates" << std::endl;
+        std::cout << "  --max-expansions=N    Terms a '*' pattern expands to, most frequent first (default: 50)" << std::endl;
+        std::cout << "  --expansion-postings=N  Postings merged per pattern (default: 2000000)" << std::endl;
+        std::cout << "  --fuzzy          Replace unknown terms by the closest term (edit distance <= 2)" << std::endl;
+        std::cout << "  --fuzzy-distance=N   Max edit distance for fuzzy matching (default: 2)" << std::endl;
+        std::cout << "  --fuzzy-min-df=N     Only correct to terms with df >= N (default: 3)" << std::endl;
+        std::cout << "  --count          Print the number of matching documents instead of results" << std::endl;
+        std::cout << "  --count=approx   Estimate the count from df and sampled postings (fast)" << std::endl;
+        std::cout << "  --rm3            RM3 pseudo-relevance feedback (index built with merger --forward)" << std::endl;
+        std::cout << "  --fb-docs=N      Feedback documents (default: 10)" << std::endl;
+        std::cout << "  --fb-terms=N     Expansion terms (default: 10)" << std::endl;
+        std::cout << "  --fb-weight=X    Weight of the original query in the expanded one (default: 0.5)" << std::endl;
+        std::cout << "  --collapse[=N]   Keep one result per near-duplicate cluster among the top N (default: 100;" << std::endl;
+        std::cout << "                   doc_canonical.bin next to the doc table, indexer --near-dups=link)" << std::endl;
+        std::cout << "  --doc-range=LO-HI[,LO-HI...]  Only return docIDs in these ranges (e.g. one source's passages)" << std::endl;
+        std::cout << "  --ids=ID[,ID...] Only return these docIDs" << std::endl;
+        std::cout << "  --min-len=N      Only return passages of at least N tokens" << std::endl;
+        std::cout << "  --max-len=N      Only return passages of at most N tokens" << std::endl;
         std::cout << "\nExample:" << std::endl;
         std::cout << "  " << argv[0] << " ./index ./output/doc_table.txt --mode=or --k=10" << std::endl;
         std::cout << "\nInteractive commands:" << std::endl;
         std::cout << "  /and <query>     Switch to AND mode for this query" << std::endl;
         std::cout << "  /or <query>      Switch to OR mode for this query" << std::endl;
+        std::cout << "  \"a b\" / a NEAR/k b  Phrase / proximity query (index built with --positions)" << std::endl;
+        std::cout << "  comput* / colo*r    Wildcard term (at least 2 characters before the first '*')" << std::endl;
+        std::cout << "  +a -b / a AND (b OR c) NOT d / a^2  Boolean query (juxtaposed clauses follow the mode)" << std::endl;
         std::cout << "  /quit or /exit   Exit the program" << std::endl;
         return 1;
     }
@@ -40,6 +69,21 @@ int main(int argc, char* argv[]) {
     int defaultK = 10;
     double k1 = 0.9;
     double b = 0.4;
+    uint64_t maxPostings = 0;
+    double priorWeight = 0.0;
+    bool useTiers = true;
+    bool usePairs = true;
+    RerankOptions rerank;
+    std::string rerankerPath;
+    std::string featuresPath;
+    ExpansionOptions expansionOptions;
+    FuzzyOptions fuzzy;
+    uint32_t fuzzyMinDf = 3;
+    bool countOnly = false;
+    bool approximateCount = false;
+    FeedbackOptions feedbackOptions;
+    size_t collapseDepth = 0;
+    FilterOptions filter;
     
     for (int i = 3; i < argc; i++) {
         std::string arg = argv[i];
@@ -52,6 +96,74 @@ int main(int argc, char* argv[]) {
             k1 = std::stod(arg.substr(5));
         } else if (arg.find("--b=") == 0) {
             b = std::stod(arg.substr(4));
+        } else if (arg.find("--max-postings=") == 0) {
+            maxPostings = std::stoull(arg.substr(15));
+        } else if (arg.find("--prior-weight=") == 0) {
+            priorWeight = std::stod(arg.substr(15));
+        } else if (arg == "--no-tiers") {
+            useTiers = false;
+        } else if (arg == "--no-pairs") {
+            usePairs = false;
+        } else if (arg.find("--rerank-depth=") == 0) {
+            rerank.depth = std::stoul(arg.substr(15));
+        } else if (arg.find("--pair-weight=") == 0) {
+            rerank.pairWeight = std::stod(arg.substr(14));
+        } else if (arg.find("--span-weight=") == 0) {
+            rerank.spanWeight = std::stod(arg.substr(14));
+        } else if (arg.find("--reranker=") == 0) {
+            rerankerPath = arg.substr(11);
+        } else if (arg.find("--dump-features=") == 0) {
+            featuresPath = arg.substr(16);
+        } else if (arg.find("--max-expansions=") == 0) {
+            expansionOptions.maxTerms = std::stoul(arg.substr(17));
+        } else if (arg.find("--expansion-postings=") == 0) {
+            expansionOptions.maxPostings = std::stoull(arg.substr(21));
+        } else if (arg == "--fuzzy") {
+            fuzzy.enabled = true;
+        } else if (arg.find("--fuzzy-distance=") == 0) {
+            fuzzy.enabled = true;
+            fuzzy.maxDistance = std::stoul(arg.substr(17));
+        } else if (arg.find("--fuzzy-min-df=") == 0) {
+            fuzzy.enabled = true;
+            fuzzyMinDf = std::stoul(arg.substr(15));
+        } else if (arg == "--count") {
+            countOnly = true;
+        } else if (arg == "--count=approx") {
+            countOnly = true;
+            approximateCount = true;
+        } else if (arg == "--rm3") {
+            feedbackOptions.enabled = true;
+        } else if (arg.find("--fb-docs=") == 0) {
+            feedbackOptions.docs = static_cast<uint32_t>(std::stoul(arg.substr(10)));
+        } else if (arg.find("--fb-terms=") == 0) {
+            feedbackOptions.terms = static_cast<uint32_t>(std::stoul(arg.substr(11)));
+        } else if (arg.find("--fb-weight=") == 0) {
+            feedbackOptions.originalWeight = std::stod(arg.substr(12));
+        } else if (arg == "--collapse") {
+            collapseDepth = 100;
+        } else if (arg.find("--collapse=") == 0) {
+            collapseDepth = std::stoul(arg.substr(11));
+        } else if (arg.find("--doc-range=") == 0) {
+            if (!FilterOptions::parseRanges(arg.substr(12), filter.docRanges)) {
+                std::cerr << "Invalid --doc-range (expected LO-HI[,LO-HI...]): " << arg.substr(12) << std::endl;
+                return 1;
+            }
+        } else if (arg.find("--ids=") == 0) {
+            if (!FilterOptions::parseIDs(arg.substr(6), filter.docIDs)) {
+                std::cerr << "Invalid --ids (expected ID[,ID...]): " << arg.substr(6) << std::endl;
+                return 1;
+            }
+            filter.hasIDs = true;
+        } else if (arg.find("--min-len=") == 0) {
+            if (!FilterOptions::parseNumber(arg.substr(10), filter.minLength)) {
+                std::cerr << "Invalid --min-len: " << arg.substr(10) << std::endl;
+                return 1;
+            }
+        } else if (arg.find("--max-len=") == 0) {
+            if (!FilterOptions::parseNumber(arg.substr(10), filter.maxLength)) {
+                std::cerr << "Invalid --max-len: " << arg.substr(10) << std::endl;
+                return 1;
+            }
         }
     }
     
@@ -86,6 +198,42 @@ int main(int argc, char* argv[]) {
     if (!docTable.load(docTablePath)) {
         return 1;
     }
+    
+    DocPriors docPriors;
+    docPriors.load(indexDir);
+    
+    if (!rerankerPath.empty()) {
+        std::string error;
+        rerank.model = loadReranker(rerankerPath, &error);
+        if (!rerank.model) {
+            std::cerr << "Failed to load reranker: " << error << std::endl;
+            return 1;
+        }
+        std::cout << "Loaded " << rerank.model->kind() << " reranker from " << rerankerPath << std::endl;
+    }
+    
+    std::ofstream featuresFile;
+    if (!featuresPath.empty()) {
+        featuresFile.open(featuresPath, std::ios::app);
+        if (!featuresFile.is_open()) {
+            std::cerr << "Cannot open " << featuresPath << std::endl;
+            return 1;
+        }
+    }
+    
+    TierIndex tierIndex;
+    if (useTiers) tierIndex.load(indexDir);
+    
+    PairIndex pairIndex;
+    if (usePairs) pairIndex.load(indexDir);
+    
+    FuzzyIndex fuzzyIndex;
+    if (fuzzy.enabled) fuzzyIndex.build(lexicon, fuzzyMinDf, fuzzy.maxDistance);
+    
+    ForwardIndex forwardIndex;
+    if (feedbackOptions.enabled && !forwardIndex.load(indexDir)) {
+        std::cerr << "Warning: no forward index in " << indexDir << " (merger --forward), RM3 disabled" << std::endl;
+    }
 
     // ---- Load document content ----
     DocContentFile docContent;
@@ -104,6 +252,15 @@ int main(int argc, char* argv[]) {
         std::cerr << "Warning: Could not load document content" << std::endl;
     }
     
+    DocClusters docClusters;
+    if (collapseDepth > 0) {
+        std::string clustersPath = (lastSlash != std::string::npos ? docTablePath.substr(0, lastSlash + 1) : "") +
+                                   "doc_canonical.bin";
+        if (!docClusters.load(clustersPath)) {
+            std::cerr << "Warning: no " << clustersPath << " (indexer --near-dups=link), collapsing disabled" << std::endl;
+        }
+    }
+    
     std::cout << "\nIndex loaded successfully!" << std::endl;
     std::cout << std::string(80, '=') << std::endl;
     std::cout << "\nEnter queries (one per line). Type /quit to exit." << std::endl;
@@ -112,6 +269,15 @@ int main(int argc, char* argv[]) {
     // ---- Create Query Evaluator ----
     bm25::Params bm25Params(k1, b);
     QueryEvaluator evaluator(lexicon, stats, docLen, docTable, docContent, indexDir, bm25Params);
+    evaluator.setDocPriors(&docPriors, priorWeight);
+    evaluator.setTierIndex(&tierIndex);
+    evaluator.setPairIndex(&pairIndex);
+    evaluator.setRerank(rerank);
+    evaluator.setExpansionOptions(expansionOptions);
+    evaluator.setFuzzy(&fuzzyIndex, fuzzy);
+    evaluator.setFeedback(&forwardIndex, feedbackOptions);
+    evaluator.setCollapse(&docClusters, collapseDepth);
+    evaluator.setFilter(filter);
     
     /// ---- REPL----
     std::string line;
@@ -143,34 +309,97 @@ int main(int argc, char* argv[]) {
         
         auto start = std::chrono::high_resolution_clock::now();
         // ---- Load document content ----
-        // tokenize
-        std::vector<std::string> tokens = tokenize_words(query);
+        // tokenize ("quoted phrases" and NEAR/k become positional constraints)
+        ParsedQuery parsed = QueryParser::parse(query);
+        const std::vector<std::string>& queryTerms = parsed.terms;
         
-        if (tokens.empty()) {
+        if (queryTerms.empty()) {
             std::cout << "Empty query" << std::endl;
             continue;
         }
         
-        // Remove duplicates
-        std::unordered_set<std::string> uniqueSet(tokens.begin(), tokens.end());
-        std::vector<std::string> queryTerms(uniqueSet.begin(), uniqueSet.end());
-        
         std::cout << "Query terms: ";
         for (size_t i = 0; i < queryTerms.size(); i++) {
             if (i > 0) std::cout << ", ";
             std::cout << queryTerms[i];
         }
-        std::cout << " (" << localMode << " mode)" << std::endl;
+        std::cout << " (" << (parsed.positional() ? "positional" : localMode) << " mode)" << std::endl;
         
         // Evaluate query
         
-        std::vector<QueryResult> results = evaluator.processQuery(queryTerms, localMode, defaultK);
+        QueryBudget budget;
+        budget.maxPostings = maxPostings;
+        if (countOnly) {
+            MatchCount matches = evaluator.countQuery(parsed, localMode, approximateCount, &budget);
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::high_resolution_clock::now() - start);
+            if (!matches.supported) {
+                std::cout << "Counting phrase / NEAR queries is not supported\n" << std::endl;
+                continue;
+            }
+            std::cout << "Matches: " << matches.count << (matches.exact ? "" : " (estimated)")
+                      << (budget.partial ? " (partial: budget reached)" : "") << ", "
+                      << matches.postings << " postings visited, "
+                      << std::fixed << std::setprecision(3) << elapsed.count() / 1000.0 << " ms\n" << std::endl;
+            continue;
+        }
+        std::vector<QueryResult> results = evaluator.processQuery(parsed, localMode, defaultK, nullptr, &budget);
 
         auto end = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-        
+
+        // training rows: query <TAB> docID <TAB> feature values (reranker.hpp order)
+        if (featuresFile.is_open()) {
+            const FeatureMatrix& matrix = evaluator.lastFeatures();
+            const std::vector<uint32_t>& featureDocs = evaluator.lastFeatureDocs();
+            for (size_t r = 0; r < matrix.rows; r++) {
+                featuresFile << query << '\t' << docTable.originalID(featureDocs[r]) << '\t';
+                for (size_t f = 0; f < features::COUNT; f++) {
+                    featuresFile << (f > 0 ? " " : "") << features::name(f) << ':' << matrix.row(r)[f];
+                }
+                featuresFile << '\n';
+            }
+            featuresFile.flush();
+        }
+
         // Output
-        std::cout << "\nTop " << results.size() << " results (in " << duration.count() << " ms):\n";
+        std::cout << "\nTop " << results.size() << " results (in " << duration.count() << " ms"
+                  << (budget.partial ? ", partial: budget reached" : "")
+                  << (evaluator.lastAnsweredFromTier() ? ", tier 1" : "")
+                  << (evaluator.lastCollapsed() ? ", " + std::to_string(evaluator.lastCollapsed()) + " near-duplicates collapsed" : "")
+                  << "):\n";
+        for (const auto& c : evaluator.lastCorrections()) {
+            std::cout << "Corrected: " << c.original << " -> " << c.term
+                      << " (distance " << c.distance << ", df " << c.df << ", "
+                      << std::fixed << std::setprecision(3) << c.lookupMs << " ms)" << std::endl;
+        }
+        if (!evaluator.lastPairs().empty()) {
+            std::cout << "Pair lists:";
+            for (const auto& key : evaluator.lastPairs()) std::cout << " " << key;
+            std::cout << std::endl;
+        }
+        const ExpansionStats& expansion = evaluator.lastExpansion();
+        if (expansion.patterns > 0) {
+            std::cout << "Expanded " << expansion.patterns << " pattern(s): " << expansion.expandedTerms
+                      << " of " << expansion.matchedTerms << " matching terms"
+                      << (expansion.truncated ? " (capped)" : "") << ", "
+                      << expansion.mergedPostings << " postings -> " << expansion.unionPostings << " docs"
+                      << " (scan " << std::fixed << std::setprecision(2) << expansion.expandMs
+                      << " ms, merge " << expansion.mergeMs << " ms)" << std::endl;
+        }
+        const FeedbackStats& feedback = evaluator.lastFeedback();
+        if (feedback.applied) {
+            std::cout << "RM3: " << feedback.feedbackDocs << " feedback docs, " << feedback.candidates
+                      << " candidate terms" << (feedback.dropped ? " (accumulator full)" : "")
+                      << " (first pass " << std::fixed << std::setprecision(2) << feedback.firstPassMs
+                      << " ms, selection " << feedback.selectionMs << " ms, second pass "
+                      << feedback.secondPassMs << " ms)" << std::endl;
+            std::cout << "Expanded query:";
+            for (const auto& t : feedback.terms) {
+                std::cout << " " << t.term << "^" << std::setprecision(3) << t.weight;
+            }
+            std::cout << std::endl;
+        }
         std::cout << std::string(80, '-') << std::endl;
         std::cout << std::setw(5) << "Rank" 
                   << std::setw(12) << "DocID" 
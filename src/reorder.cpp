@@ -0,0 +1,309 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <filesystem>
+#include <memory>
+#include <cmath>
+#include <cstdint>
+
+#include "index_reader.hpp"
+#include "index_writer.hpp"
+
+/**
+ * IndexReorderer: rewrites an index with docIDs ordered by a static prior
+ *
+ * Runs after Phase 2. Every document gets a static quality score (derived
+ * from its length or read from an external prior file) and docIDs are
+ * reassigned so that high-prior documents come first. DAAT traversal then
+ * meets the best documents early, which lets the evaluator stop after a
+ * postings or time budget (QueryBudget) with a good-enough top-k.
+ *
+ * Output (in a new index directory):
+ * - postings.docids.bin / postings.freqs.bin / lexicon.tsv / stats.txt / doc_len.bin
+ * - doc_order.bin: uint32 per new docID → original internal docID
+ * - doc_prior.bin: float per new docID → prior score
+ * The optional parts of the input are carried over under the new docIDs:
+ * positions, Roaring copies of dense lists (dense.tsv), the forward index,
+ * tier1/ and pairs/. doc_canonical.bin (next to the doc table) is keyed by
+ * the indexer's docIDs, which doc_order.bin maps back to, so it stays valid.
+ */
+class IndexReorderer {
+private:
+    std::string inputDir;
+    std::string outputDir;
+    std::string priorSource;    // "doclen" or path to "docID<TAB>score" file
+
+    Lexicon lexicon;
+    Stats stats;
+    DocLen docLen;
+
+    std::vector<float> priors;          // by original docID
+    std::vector<uint32_t> newToOld;
+    std::vector<uint32_t> oldToNew;
+
+    /**
+     * Compute one prior per original docID
+     *
+     * doclen: log(1 + dl), favouring longer, more informative passages.
+     * file:   docID<TAB>score lines; documents not listed get the minimum score.
+     */
+    bool computePriors() {
+        size_t n = stats.doc_count;
+        priors.assign(n, 0.0f);
+
+        if (priorSource == "doclen") {
+            for (size_t d = 0; d < n; d++) {
+                priors[d] = static_cast<float>(std::log1p(static_cast<double>(docLen.len(d))));
+            }
+            return true;
+        }
+
+        std::ifstream file(priorSource);
+        if (!file.is_open()) {
+            std::cerr << "Cannot open prior file: " << priorSource << std::endl;
+            return false;
+        }
+
+        std::vector<bool> seen(n, false);
+        float minPrior = 0.0f;
+        bool any = false;
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream iss(line);
+            uint32_t docID;
+            float score;
+            if (!(iss >> docID >> score) || docID >= n) continue;
+            priors[docID] = score;
+            seen[docID] = true;
+            minPrior = any ? std::min(minPrior, score) : score;
+            any = true;
+        }
+        for (size_t d = 0; d < n; d++) {
+            if (!seen[d]) priors[d] = minPrior;
+        }
+        return true;
+    }
+
+    // order documents by prior (descending), ties by original docID
+    void computeOrder() {
+        size_t n = priors.size();
+        newToOld.resize(n);
+        std::iota(newToOld.begin(), newToOld.end(), 0);
+        std::stable_sort(newToOld.begin(), newToOld.end(),
+                         [this](uint32_t a, uint32_t b) { return priors[a] > priors[b]; });
+
+        oldToNew.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            oldToNew[newToOld[i]] = static_cast<uint32_t>(i);
+        }
+    }
+
+    /**
+     * Map a decoded list to the new docIDs, in new docID order; with
+     * `positions` (the list's positions, freq values per posting) the
+     * positions move with their postings into newPositions
+     */
+    void remapList(const DecodedPostings& decoded, const std::vector<uint32_t>* positions,
+                   std::vector<IndexWriter::Posting>& postings, std::vector<uint32_t>& newPositions) const {
+        size_t n = decoded.docIDs.size();
+        std::vector<uint32_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return oldToNew[decoded.docIDs[a]] < oldToNew[decoded.docIDs[b]];
+        });
+
+        std::vector<size_t> starts;
+        if (positions) {
+            starts.resize(n + 1, 0);
+            for (size_t i = 0; i < n; i++) starts[i + 1] = starts[i] + decoded.freqs[i];
+        }
+        postings.clear();
+        postings.reserve(n);
+        newPositions.clear();
+        for (uint32_t i : order) {
+            postings.emplace_back(oldToNew[decoded.docIDs[i]], decoded.freqs[i]);
+            if (positions) {
+                newPositions.insert(newPositions.end(), positions->begin() + starts[i],
+                                    positions->begin() + starts[i + 1]);
+            }
+        }
+    }
+
+    /**
+     * Rewrite a sub-index of the input (tier1/, pairs/: lists in the index
+     * format over this index's docIDs) under the new docIDs; its sidecar
+     * file does not mention docIDs and is copied as is
+     */
+    bool remapSubIndex(const std::string& name, const std::string& sidecar) {
+        std::string from = inputDir + "/" + name;
+        std::string to = outputDir + "/" + name;
+        if (!std::filesystem::exists(from + "/lexicon.tsv")) return true;
+
+        Lexicon sub;
+        if (!sub.load(from + "/lexicon.tsv")) return false;
+        std::vector<std::string> keys;
+        keys.reserve(sub.size());
+        for (const auto& kv : sub.entries()) keys.push_back(kv.first);
+        std::sort(keys.begin(), keys.end());
+
+        IndexWriter subWriter(to);
+        std::vector<IndexWriter::Posting> postings;
+        std::vector<uint32_t> unused;
+        for (const auto& key : keys) {
+            auto decoded = PostingList::decodeAll(sub.entries().at(key), from);
+            if (!decoded) {
+                std::cerr << "Failed to read " << name << "/ list " << key << std::endl;
+                return false;
+            }
+            remapList(*decoded, nullptr, postings, unused);
+            subWriter.writeInvertedList(key, postings);
+        }
+        subWriter.close();
+        std::filesystem::copy_file(from + "/" + sidecar, to + "/" + sidecar,
+                                   std::filesystem::copy_options::overwrite_existing);
+        std::cout << "Remapped " << name << "/: " << keys.size() << " lists" << std::endl;
+        return true;
+    }
+
+    template <typename T>
+    bool writeArray(const std::string& path, const std::vector<T>& values) {
+        std::ofstream file(path, std::ios::out | std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Failed to write " << path << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+        return static_cast<bool>(file);
+    }
+
+public:
+    IndexReorderer(const std::string& in, const std::string& out, const std::string& prior)
+        : inputDir(in), outputDir(out), priorSource(prior) {}
+
+    bool process() {
+        if (!lexicon.load(inputDir + "/lexicon.tsv") ||
+            !stats.load(inputDir + "/stats.txt") ||
+            !docLen.load(inputDir + "/doc_len.bin")) {
+            return false;
+        }
+
+        if (!computePriors()) return false;
+        computeOrder();
+
+        // rewrite posting lists in term order with remapped docIDs
+        std::vector<std::string> terms;
+        terms.reserve(lexicon.size());
+        for (const auto& kv : lexicon.entries()) terms.push_back(kv.first);
+        std::sort(terms.begin(), terms.end());
+
+        IndexWriter writer(outputDir);
+        writer.ensureDocCount(stats.doc_count);
+        writer.setImpactScoring(stats.impacts);
+        bool positional = std::filesystem::exists(inputDir + "/postings.positions.bin");
+        if (positional) writer.enablePositions();
+        std::unique_ptr<ForwardIndexWriter> forward;
+        if (std::filesystem::exists(inputDir + "/forward.blocks.bin")) {
+            forward = std::make_unique<ForwardIndexWriter>(outputDir);
+        }
+
+        std::vector<IndexWriter::Posting> postings;
+        std::vector<uint32_t> positions;
+        std::vector<uint32_t> newPositions;
+        std::vector<std::pair<std::string, TermMeta>> denseLists;
+        size_t done = 0;
+        for (const auto& term : terms) {
+            const TermMeta& meta = lexicon.entries().at(term);
+            positions.clear();
+            auto decoded = PostingList::decodeAll(meta, inputDir, positional ? &positions : nullptr);
+            if (!decoded) {
+                std::cerr << "Failed to read the list of " << term << std::endl;
+                return false;
+            }
+
+            remapList(*decoded, positional ? &positions : nullptr, postings, newPositions);
+            TermMeta written = writer.writeInvertedList(term, postings, positional ? &newPositions : nullptr);
+            if (forward) forward->addList(term, postings);
+            if (meta.hasDense) denseLists.emplace_back(term, written);
+
+            if (++done % 100000 == 0) {
+                std::cout << "Reordered " << done << " terms..." << std::endl;
+            }
+        }
+        // lengths come from the input, not the rewritten tfs: a pruned input
+        // keeps its full-document lengths (and avgdl) for BM25
+        std::vector<uint32_t> lengths(newToOld.size());
+        for (size_t i = 0; i < newToOld.size(); i++) lengths[i] = docLen.len(newToOld[i]);
+        writer.setDocumentLengths(lengths);
+        writer.writeStats();
+        writer.close();
+        if (positional) std::cout << "Positions: remapped" << std::endl;
+        if (!denseLists.empty()) writeDenseLists(outputDir, denseLists);
+        if (forward) forward->finish(stats.doc_count);
+        if (!remapSubIndex("tier1", "tiers.tsv") || !remapSubIndex("pairs", "pairs.tsv")) {
+            return false;
+        }
+
+        std::vector<float> newPriors(newToOld.size());
+        for (size_t i = 0; i < newToOld.size(); i++) newPriors[i] = priors[newToOld[i]];
+
+        if (!writeArray(outputDir + "/doc_order.bin", newToOld) ||
+            !writeArray(outputDir + "/doc_prior.bin", newPriors)) {
+            return false;
+        }
+
+        // a pruned input keeps its full-index dfs; reordering leaves list lengths alone
+        std::ifstream idfDf(inputDir + "/idf_df.tsv", std::ios::binary);
+        if (idfDf.is_open()) {
+            std::ofstream out(outputDir + "/idf_df.tsv", std::ios::binary);
+            out << idfDf.rdbuf();
+        }
+
+        std::cout << "\nReordering complete!" << std::endl;
+        std::cout << "Total terms: " << writer.termCount() << std::endl;
+        std::cout << "Total postings: " << writer.postingCount() << std::endl;
+        std::cout << "Total documents: " << writer.documentCount() << std::endl;
+        return true;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cout << "Usage: " << argv[0] << " <index_dir> <output_dir> [--prior=doclen|<prior_file>]" << std::endl;
+        std::cout << "Example: " << argv[0] << " ./index ./index_prior --prior=doclen" << std::endl;
+        std::cout << "\nRewrites the index with docIDs sorted by a static document prior." << std::endl;
+        std::cout << "  --prior=doclen       prior = log(1 + document length) (default)" << std::endl;
+        std::cout << "  --prior=<file>       text file with docID<TAB>score lines (internal docIDs)" << std::endl;
+        std::cout << "\nQuery the output with --max-postings=N (querier) or max_postings=N (web server)" << std::endl;
+        std::cout << "for budgeted early termination; doc_table/doc_content stay unchanged." << std::endl;
+        return 1;
+    }
+
+    std::string inputDir = argv[1];
+    std::string outputDir = argv[2];
+    std::string prior = "doclen";
+
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.find("--prior=") == 0) {
+            prior = arg.substr(8);
+        }
+    }
+
+    std::cout << "Index Reorderer (static priors)" << std::endl;
+    std::cout << "===============================" << std::endl;
+    std::cout << "Input: " << inputDir << std::endl;
+    std::cout << "Output: " << outputDir << std::endl;
+    std::cout << "Prior: " << prior << std::endl;
+
+    IndexReorderer reorderer(inputDir, outputDir, prior);
+    if (!reorderer.process()) {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,238 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+
+#include "index_reader.hpp"
+#include "completion_trie.hpp"
+#include "utils.hpp"
+
+/**
+ * SuggestBuilder: builds the completion trie for query autocomplete
+ *
+ * Runs after Phase 2. Every lexicon term with df >= minDf becomes a
+ * suggestion weighted by its df or, with a query log, by how often it occurs
+ * in the log (df breaks ties and ranks terms absent from the log). The terms
+ * are sorted and turned into a radix trie in one recursive pass over sorted
+ * ranges; each node keeps the ids of the k heaviest terms below it, merged
+ * from its children's lists. The result is written to <index_dir>/suggest.bin
+ * (format in completion_trie.hpp) and served by web_server at /suggest.
+ */
+class SuggestBuilder {
+private:
+    using Node = CompletionTrie::Node;
+
+    std::string indexDir;
+    uint32_t k;
+    uint32_t minDf;
+    std::string queryLog;
+
+    std::vector<std::string> terms;     // sorted; index = term id
+    std::vector<uint64_t> weights;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> top;
+    std::string labels;
+
+    // query log term counts (query or qid<TAB>query lines)
+    bool countLogTerms(std::unordered_map<std::string, uint64_t>& counts) {
+        std::ifstream file(queryLog);
+        if (!file.is_open()) {
+            std::cerr << "Cannot open query log: " << queryLog << std::endl;
+            return false;
+        }
+        std::string line;
+        size_t queries = 0;
+        while (std::getline(file, line)) {
+            size_t tab = line.find('\t');
+            std::string text = tab == std::string::npos ? line : line.substr(tab + 1);
+            for (const auto& term : tokenize_words(text)) counts[term]++;
+            queries++;
+        }
+        std::cout << "Query log: " << queries << " queries, " << counts.size() << " distinct terms" << std::endl;
+        return true;
+    }
+
+    // heaviest first, ties by term order (smaller id)
+    bool heavier(uint32_t a, uint32_t b) const {
+        return weights[a] != weights[b] ? weights[a] > weights[b] : a < b;
+    }
+
+    /**
+     * Fill node `index` for terms[lo, hi), which share their first `depth`
+     * characters; children are allocated contiguously before recursing.
+     */
+    void buildNode(uint32_t index, size_t lo, size_t hi, size_t depth) {
+        std::vector<uint32_t> best;
+        size_t begin = lo;
+        if (terms[lo].size() == depth) {
+            best.push_back(static_cast<uint32_t>(lo));   // a term ends here
+            begin++;
+        }
+
+        // group the remaining terms by their next character
+        std::vector<std::pair<size_t, size_t>> groups;
+        for (size_t i = begin; i < hi;) {
+            size_t j = i + 1;
+            while (j < hi && terms[j][depth] == terms[i][depth]) j++;
+            groups.push_back({i, j});
+            i = j;
+        }
+
+        uint32_t firstChild = static_cast<uint32_t>(nodes.size());
+        nodes[index].firstChild = firstChild;
+        nodes[index].childCount = static_cast<uint32_t>(groups.size());
+        nodes.resize(nodes.size() + groups.size());
+
+        for (size_t g = 0; g < groups.size(); g++) {
+            auto [a, b] = groups[g];
+            // edge label: longest common prefix of the group beyond depth
+            const std::string& first = terms[a];
+            const std::string& last = terms[b - 1];
+            size_t end = depth + 1;
+            while (end < first.size() && end < last.size() && first[end] == last[end]) end++;
+
+            uint32_t child = firstChild + static_cast<uint32_t>(g);
+            nodes[child].labelOffset = static_cast<uint32_t>(labels.size());
+            nodes[child].labelLen = static_cast<uint32_t>(end - depth);
+            labels.append(first, depth, end - depth);
+            buildNode(child, a, b, end);
+
+            for (uint32_t i = 0; i < nodes[child].topCount; i++) {
+                best.push_back(top[nodes[child].topOffset + i]);
+            }
+        }
+
+        size_t keep = std::min<size_t>(best.size(), k);
+        std::partial_sort(best.begin(), best.begin() + keep, best.end(),
+                          [this](uint32_t a, uint32_t b) { return heavier(a, b); });
+        nodes[index].topOffset = static_cast<uint32_t>(top.size());
+        nodes[index].topCount = static_cast<uint32_t>(keep);
+        top.insert(top.end(), best.begin(), best.begin() + keep);
+    }
+
+    template <typename T>
+    static void writeArray(std::ofstream& file, const std::vector<T>& values) {
+        file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+public:
+    SuggestBuilder(const std::string& dir, uint32_t topK, uint32_t minDocFreq, const std::string& log)
+        : indexDir(dir), k(topK), minDf(minDocFreq), queryLog(log) {}
+
+    bool process() {
+        Lexicon lexicon;
+        if (!lexicon.load(indexDir + "/lexicon.tsv")) return false;
+
+        std::unordered_map<std::string, uint64_t> logCounts;
+        if (!queryLog.empty() && !countLogTerms(logCounts)) return false;
+
+        std::vector<std::pair<std::string, uint64_t>> entries;
+        for (const auto& [term, meta] : lexicon.entries()) {
+            if (meta.df < minDf) continue;
+            uint64_t weight = meta.df;
+            if (!logCounts.empty()) {
+                auto it = logCounts.find(term);
+                uint64_t count = it == logCounts.end() ? 0 : std::min<uint64_t>(it->second, UINT32_MAX);
+                weight = (count << 32) | meta.df;
+            }
+            entries.push_back({term, weight});
+        }
+        if (entries.empty()) {
+            std::cerr << "No terms with df >= " << minDf << std::endl;
+            return false;
+        }
+        std::sort(entries.begin(), entries.end());
+        for (auto& [term, weight] : entries) {
+            terms.push_back(std::move(term));
+            weights.push_back(weight);
+        }
+
+        nodes.assign(1, Node{0, 0, 0, 0, 0, 0});
+        buildNode(0, 0, terms.size(), 0);
+
+        std::vector<uint32_t> termOffsets;
+        std::string termBytes;
+        for (const auto& term : terms) {
+            termOffsets.push_back(static_cast<uint32_t>(termBytes.size()));
+            termBytes += term;
+        }
+        termOffsets.push_back(static_cast<uint32_t>(termBytes.size()));
+
+        std::string path = indexDir + "/suggest.bin";
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Failed to write " << path << std::endl;
+            return false;
+        }
+        uint32_t header[7] = {CompletionTrie::VERSION, k, static_cast<uint32_t>(terms.size()),
+                              static_cast<uint32_t>(nodes.size()), static_cast<uint32_t>(top.size()),
+                              static_cast<uint32_t>(labels.size()), static_cast<uint32_t>(termBytes.size())};
+        file.write("SUGG", 4);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        writeArray(file, termOffsets);
+        file.write(termBytes.data(), termBytes.size());
+        writeArray(file, weights);
+        writeArray(file, nodes);
+        writeArray(file, top);
+        file.write(labels.data(), labels.size());
+        if (!file) {
+            std::cerr << "Failed to write " << path << std::endl;
+            return false;
+        }
+
+        std::cout << "\nCompletion trie complete!" << std::endl;
+        std::cout << "Terms: " << terms.size() << std::endl;
+        std::cout << "Nodes: " << nodes.size() << std::endl;
+        std::cout << "Size: " << file.tellp() << " bytes" << std::endl;
+        return true;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " <index_dir> [options]" << std::endl;
+        std::cout << "Example: " << argv[0] << " ./index --k=10 --min-df=3 --queries=queries.tsv" << std::endl;
+        std::cout << "\nBuilds <index_dir>/suggest.bin for web_server's /suggest endpoint." << std::endl;
+        std::cout << "  --k=N            Completions stored per trie node (default: 10)" << std::endl;
+        std::cout << "  --min-df=N       Only suggest terms with df >= N (default: 3)" << std::endl;
+        std::cout << "  --queries=FILE   Weight terms by query log frequency (query or qid<TAB>query lines)" << std::endl;
+        return 1;
+    }
+
+    std::string indexDir = argv[1];
+    uint32_t k = 10;
+    uint32_t minDf = 3;
+    std::string queryLog;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.find("--k=") == 0) {
+            k = static_cast<uint32_t>(std::stoul(arg.substr(4)));
+        } else if (arg.find("--min-df=") == 0) {
+            minDf = static_cast<uint32_t>(std::stoul(arg.substr(9)));
+        } else if (arg.find("--queries=") == 0) {
+            queryLog = arg.substr(10);
+        }
+    }
+
+    if (k == 0) {
+        std::cerr << "Invalid options: --k must be > 0" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Completion Trie Builder" << std::endl;
+    std::cout << "=======================" << std::endl;
+    std::cout << "Index: " << indexDir << std::endl;
+    std::cout << "Weights: " << (queryLog.empty() ? "df" : "query log (" + queryLog + ")") << std::endl;
+
+    SuggestBuilder builder(indexDir, k, minDf, queryLog);
+    if (!builder.process()) {
+        return 1;
+    }
+
+    return 0;
+}
@@ -4,11 +4,19 @@
 #include <sstream>
 #include <vector>
 #include <cstring>
+#include <cstdio>
 #include <thread>
 #include <chrono>
 #include <iomanip> 
 #include <algorithm>
 #include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <charconv>
+#include <future>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -16,6 +24,8 @@
 #pragma comment(lib, "ws2_32.lib")
 #else
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <cerrno>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
@@ -29,8 +39,32 @@
 #include "bm25.hpp"
 #include "utils.hpp"
 #include "querier.hpp"
+#include "json.hpp"
+#include "thread_pool.hpp"
+#include "admission_control.hpp"
+#include "completion_trie.hpp"
+#include "result_cache.hpp"
+#include "singleflight.hpp"
 
 
+// Server tuning knobs (set from the command line)
+struct ServerOptions {
+    long long defaultTimeoutMs = 0;   // 0 = no deadline unless timeout_ms is given
+    size_t maxConcurrent = 0;         // 0 = number of hardware threads
+    size_t maxQueued = 64;            // searches allowed to wait for a slot
+    size_t rerankDepth = 0;           // default second-stage depth (0 = off)
+    std::shared_ptr<const Reranker> reranker;   // model for the second stage (optional)
+    const FuzzyIndex* fuzzyIndex = nullptr;     // enables fuzzy=1 (built with --fuzzy)
+    const CompletionTrie* suggestions = nullptr;  // serves /suggest (suggest.bin, optional)
+    const ForwardIndex* forwardIndex = nullptr;   // enables rm3=1 (merger --forward)
+    const DocClusters* docClusters = nullptr;     // enables collapse=1 (indexer --near-dups=link)
+    size_t collapseDepth = 100;        // candidates collapsed per evaluation (at least the page)
+    size_t resultCacheEntries = 1024;  // ranked lists kept for pagination (0 = off)
+    long long resultCacheTtlMs = 30000;
+    size_t prefetchPages = 5;          // pages ranked (and cached) per evaluation
+    size_t maxResultDepth = 10000;     // deepest rank a search can reach (offset + page, re-rank depth)
+};
+
 // HTTP Server
 class WebServer {
 private:
@@ -43,11 +77,26 @@ private:
     DocLen* docLen;
     DocTable* docTable;
     DocContentFile* docContent; 
+    DocPriors* docPriors;
+    TierIndex* tierIndex;
+    PairIndex* pairIndex;
     std::string indexDir;
     bm25::Params bm25Params;
 
-    QueryEvaluator* evaluator;
-    std::mutex evalMutex;
+    ServerOptions options;
+    ThreadPool workers;               // evaluates batch queries concurrently
+    AdmissionController admission;    // bounds concurrent and queued searches
+    ResultCache resultCache;          // recent ranked lists, sliced into pages
+    struct PageEvaluation;
+    SingleFlight<PageEvaluation> inFlight;   // /search evaluations shared by identical requests
+    
+    static constexpr size_t MAX_HEADER_BYTES = 64 * 1024;
+    static constexpr size_t MAX_BODY_BYTES = 1024 * 1024;
+    static constexpr size_t MAX_BATCH_QUERIES = 1000;
+    static constexpr double MAX_K1 = 100.0;                 // BM25 k1 accepted from requests
+    static constexpr double MAX_WEIGHT = 1e6;               // prior / proximity weights
+    static constexpr uint64_t MAX_TIMEOUT_MS = 3600 * 1000;
+    static constexpr size_t MAX_SUGGESTIONS = 100;
 
     // URL Decode
     std::string urlDecode(const std::string& str) {
@@ -84,95 +133,1226 @@ private:
         return urlDecode(queryString.substr(pos, endPos - pos));
     }
 
-    // Escape JSON special characters
-    std::string escapeJson(const std::string& str) {
-        std::ostringstream escaped;
-        for (char c : str) {
-            switch (c) {
-                case '"': escaped << "\\\""; break;
-                case '\\': escaped << "\\\\"; break;
-                case '\b': escaped << "\\b"; break;
-                case '\f': escaped << "\\f"; break;
-                case '\n': escaped << "\\n"; break;
-                case '\r': escaped << "\\r"; break;
-                case '\t': escaped << "\\t"; break;
-                default:
-                    if (c < 32) {
-                        escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)(unsigned char)c;
-                    } else {
-                        escaped << c;
-                    }
-            }
-        }
-        return escaped.str();
+    // Output buffers reused across all responses written by the current thread
+    struct ResponseBuffers {
+        std::string header;
+        std::string body;
+    };
+
+    static ResponseBuffers& responseBuffers() {
+        thread_local ResponseBuffers buffers;
+        return buffers;
     }
 
-    // generate JSON response
-    std::string generateJsonResponse(const std::vector<QueryResult>& results, 
-                                    const std::vector<std::string>& queryTerms,
-                                    long long queryTime) {
-        std::ostringstream json;
-        json << "{\n";
-        json << "  \"query_terms\": [";
-        for (size_t i = 0; i < queryTerms.size(); i++) {
-            if (i > 0) json << ", ";
-            json << "\"" << escapeJson(queryTerms[i]) << "\"";
+    // position of a /search page in the full result list
+    struct PageInfo {
+        size_t offset;        // rank of the first result - 1
+        std::string next;     // continuation token, empty on the last page
+        bool cached;          // sliced from the result cache
+        bool coalesced;       // answered by an identical request's evaluation
+        bool collapsed;       // one result per near-duplicate cluster
+    };
+
+    // write one search result object; contents maps docID -> text for snippets
+    void writeSearchResult(json::Writer& json,
+                           const std::vector<QueryResult>& results,
+                           const std::vector<std::string>& queryTerms,
+                           long long queryTime,
+                           bool partial,
+                           const std::unordered_map<uint32_t, std::string>* contents,
+                           const ExpansionStats* expansion = nullptr,
+                           const std::vector<FuzzyMatch>* corrections = nullptr,
+                           const PageInfo* page = nullptr,
+                           const FeedbackStats* feedback = nullptr) {
+        json.beginObject();
+        json.key("query_terms");
+        json.beginArray();
+        for (const auto& term : queryTerms) {
+            json.value(term);
+        }
+        json.endArray();
+        json.key("query_time_ms");
+        json.value(queryTime);
+        json.key("partial");
+        json.value(partial);
+        if (expansion && expansion->patterns > 0) {
+            json.key("expansion");
+            json.beginObject();
+            json.key("patterns");
+            json.value(expansion->patterns);
+            json.key("matched_terms");
+            json.value(expansion->matchedTerms);
+            json.key("expanded_terms");
+            json.value(expansion->expandedTerms);
+            json.key("merged_postings");
+            json.value(expansion->mergedPostings);
+            json.key("union_postings");
+            json.value(expansion->unionPostings);
+            json.key("truncated");
+            json.value(expansion->truncated);
+            json.key("expand_ms");
+            json.value(expansion->expandMs, 3);
+            json.key("merge_ms");
+            json.value(expansion->mergeMs, 3);
+            json.endObject();
         }
-        json << "],\n";
-        json << "  \"query_time_ms\": " << queryTime << ",\n";
-        json << "  \"num_results\": " << results.size() << ",\n";
-        json << "  \"results\": [\n";
+        if (feedback && feedback->applied) {
+            json.key("feedback");
+            json.beginObject();
+            json.key("docs");
+            json.value(feedback->feedbackDocs);
+            json.key("candidates");
+            json.value(feedback->candidates);
+            json.key("first_pass_ms");
+            json.value(feedback->firstPassMs, 3);
+            json.key("selection_ms");
+            json.value(feedback->selectionMs, 3);
+            json.key("second_pass_ms");
+            json.value(feedback->secondPassMs, 3);
+            json.key("terms");
+            json.beginArray();
+            for (const auto& t : feedback->terms) {
+                json.beginObject();
+                json.key("term");
+                json.value(t.term);
+                json.key("weight");
+                json.value(t.weight, 4);
+                json.endObject();
+            }
+            json.endArray();
+            json.endObject();
+        }
+        if (corrections && !corrections->empty()) {
+            json.key("corrections");
+            json.beginArray();
+            for (const auto& c : *corrections) {
+                json.beginObject();
+                json.key("term");
+                json.value(c.original);
+                json.key("corrected");
+                json.value(c.term);
+                json.key("distance");
+                json.value(c.distance);
+                json.endObject();
+            }
+            json.endArray();
+        }
+        if (page) {
+            json.key("offset");
+            json.value(page->offset);
+            json.key("next");
+            if (page->next.empty()) {
+                json.raw("null");
+            } else {
+                json.value(page->next);
+            }
+            json.key("cached");
+            json.value(page->cached);
+            json.key("coalesced");
+            json.value(page->coalesced);
+            json.key("collapsed");
+            json.value(page->collapsed);
+        }
+        json.key("num_results");
+        json.value(results.size());
+        json.key("results");
+        json.beginArray();
         
+        size_t firstRank = page ? page->offset + 1 : 1;
+        for (size_t i = 0; i < results.size(); i++) {
+            uint32_t docID = results[i].docID;
+            
+            json.beginObject();
+            json.key("rank");
+            json.value(firstRank + i);
+            json.key("docID");
+            json.value(docID);
+            json.key("score");
+            json.value(results[i].score, 4);
+            json.key("original_id");
+            json.value(docTable->originalID(docID));
+            if (contents) {
+                // generate query-dependent snippet
+                auto it = contents->find(docID);
+                json.key("snippet");
+                if (it != contents->end() && !it->second.empty()) {
+                    json.value(SnippetGenerator::generate(it->second, queryTerms));
+                } else {
+                    json.value("(No content available)");
+                }
+            }
+            json.endObject();
+        }
+        
+        json.endArray();
+        json.endObject();
+    }
 
+    // generate JSON response into out (appended, no intermediate copies)
+    void generateJsonResponse(std::string& out,
+                              const std::vector<QueryResult>& results, 
+                              const std::vector<std::string>& queryTerms,
+                              long long queryTime,
+                              bool partial,
+                              const ExpansionStats* expansion = nullptr,
+                              const std::vector<FuzzyMatch>* corrections = nullptr,
+                              const PageInfo* page = nullptr,
+                              const FeedbackStats* feedback = nullptr) {
         // get document contents in batch
         std::vector<uint32_t> docIDs;
+        docIDs.reserve(results.size());
         for (const auto& r : results) {
             docIDs.push_back(r.docID);
         }
         auto contents = docContent->getBatch(docIDs);
         
-        for (size_t i = 0; i < results.size(); i++) {
-            if (i > 0) json << ",\n";
-            
-            uint32_t docID = results[i].docID;
+        json::Writer json(out);
+        writeSearchResult(json, results, queryTerms, queryTime, partial, &contents, expansion, corrections, page,
+                          feedback);
+    }
+
+    // settings of a batch query: its own fields, else the batch defaults, else the server's
+    struct BatchSettings {
+        std::string mode = "or";
+        int k = 10;
+        double k1 = 0.9;
+        double b = 0.4;
+        long long timeoutMs = 0;
+        uint64_t maxPostings = 0;
+        double priorWeight = 0.0;
+        RerankOptions rerank;
+        ExpansionOptions expansion;
+        bool fuzzy = false;
+    };
+
+    // numeric field within [lo, hi] (absent: out unchanged); false if not finite or out of range
+    static bool readNumber(const json::Value& v, std::string_view key, double lo, double hi, double& out) {
+        double value = v.getNumber(key, out);
+        if (!std::isfinite(value) || value < lo || value > hi) return false;
+        out = value;
+        return true;
+    }
+
+    /**
+     * Override settings with the fields present in v; false with the name of
+     * the offending field in invalid if a number is out of range (settings
+     * are then unchanged). Integers are truncated.
+     */
+    bool readBatchSettings(const json::Value& v, BatchSettings& settings, const char*& invalid) const {
+        const double maxDepth = static_cast<double>(std::min<uint64_t>(options.maxResultDepth, INT_MAX));
+        const double maxInteger = 9007199254740992.0;   // 2^53, exact in a double
+        BatchSettings s = settings;
+        double k = s.k;
+        double timeoutMs = static_cast<double>(s.timeoutMs);
+        double maxPostings = static_cast<double>(s.maxPostings);
+        double rerankDepth = static_cast<double>(s.rerank.depth);
+        double maxTerms = static_cast<double>(s.expansion.maxTerms);
+        double expansionPostings = static_cast<double>(s.expansion.maxPostings);
+        invalid = nullptr;
+        if (!readNumber(v, "k", 0.0, maxDepth, k)) invalid = "k";
+        else if (!readNumber(v, "k1", 0.0, MAX_K1, s.k1)) invalid = "k1";
+        else if (!readNumber(v, "b", 0.0, 1.0, s.b)) invalid = "b";
+        else if (!readNumber(v, "timeout_ms", 0.0, static_cast<double>(MAX_TIMEOUT_MS), timeoutMs)) invalid = "timeout_ms";
+        else if (!readNumber(v, "max_postings", 0.0, maxInteger, maxPostings)) invalid = "max_postings";
+        else if (!readNumber(v, "prior_weight", -MAX_WEIGHT, MAX_WEIGHT, s.priorWeight)) invalid = "prior_weight";
+        else if (!readNumber(v, "rerank_depth", 0.0, maxDepth, rerankDepth)) invalid = "rerank_depth";
+        else if (!readNumber(v, "pair_weight", -MAX_WEIGHT, MAX_WEIGHT, s.rerank.pairWeight)) invalid = "pair_weight";
+        else if (!readNumber(v, "span_weight", -MAX_WEIGHT, MAX_WEIGHT, s.rerank.spanWeight)) invalid = "span_weight";
+        else if (!readNumber(v, "max_expansions", 0.0, UINT32_MAX, maxTerms)) invalid = "max_expansions";
+        else if (!readNumber(v, "expansion_postings", 0.0, maxInteger, expansionPostings)) invalid = "expansion_postings";
+        if (invalid) return false;
+        
+        s.k = static_cast<int>(k);
+        s.timeoutMs = static_cast<long long>(timeoutMs);
+        s.maxPostings = static_cast<uint64_t>(maxPostings);
+        s.rerank.depth = static_cast<size_t>(rerankDepth);
+        s.expansion.maxTerms = static_cast<size_t>(maxTerms);
+        s.expansion.maxPostings = static_cast<uint64_t>(expansionPostings);
+        s.mode = v.getString("mode", s.mode);
+        s.fuzzy = v.getBool("fuzzy", s.fuzzy);
+        settings = std::move(s);
+        return true;
+    }
+
+    // server-wide second-stage defaults (--rerank-depth, --reranker)
+    RerankOptions serverRerank() const {
+        RerankOptions rerank;
+        rerank.depth = options.rerankDepth;
+        rerank.model = options.reranker;
+        return rerank;
+    }
+
+    // ranked results [offset, offset + count) of list
+    static void slice(const std::vector<QueryResult>& list, size_t offset, size_t count,
+                      std::vector<QueryResult>& out) {
+        out.clear();
+        if (offset >= list.size()) return;
+        out.assign(list.begin() + offset, list.begin() + std::min(list.size(), offset + count));
+    }
+
+    // result cache key: every parameter that changes the ranking, then the
+    // query with runs of whitespace collapsed
+    static std::string resultKey(const std::string& query, const std::string& mode, double k1, double b,
+                                 double priorWeight, const RerankOptions& rerank,
+                                 const ExpansionOptions& expansion, bool fuzzy,
+                                 const FeedbackOptions& feedback, size_t collapseDepth,
+                                 const FilterOptions& filter) {
+        std::ostringstream key;
+        key.precision(17);
+        key << (mode == "and" ? "and" : "or") << '|' << k1 << '|' << b << '|' << priorWeight << '|'
+            << rerank.depth << '|' << rerank.pairWeight << '|' << rerank.spanWeight << '|'
+            << expansion.maxTerms << '|' << expansion.maxPostings << '|' << fuzzy << '|';
+        if (feedback.enabled) {
+            key << "rm3:" << feedback.docs << ',' << feedback.terms << ',' << feedback.originalWeight << '|';
+        }
+        if (collapseDepth > 0) key << "collapse:" << collapseDepth << '|';
+        if (filter.active()) {
+            key << "filter:";
+            for (const auto& [lo, hi] : filter.docRanges) key << lo << '-' << hi << ',';
+            if (filter.hasIDs) {
+                key << "ids";
+                for (uint32_t id : filter.docIDs) key << ',' << id;
+            }
+            key << ';' << filter.minLength << '-' << filter.maxLength << '|';
+        }
+        std::istringstream words(query);
+        std::string word;
+        for (bool first = true; words >> word; first = false) key << (first ? "" : " ") << word;
+        return key.str();
+    }
+
+    // continuation token contents: last result of a page, offset of the next
+    struct PageToken {
+        double score;
+        uint32_t docID;     // as returned (indexer docID)
+        size_t offset;
+    };
+
+    // 40 hex digits: score bits, docID, offset, hash of the result key
+    static std::string encodeToken(const PageToken& token, uint32_t keyHash) {
+        uint64_t bits;
+        std::memcpy(&bits, &token.score, sizeof(bits));
+        char buf[41];
+        std::snprintf(buf, sizeof(buf), "%016llx%08x%08x%08x", static_cast<unsigned long long>(bits),
+                      token.docID, static_cast<uint32_t>(token.offset), keyHash);
+        return buf;
+    }
+
+    static bool decodeToken(const std::string& text, uint32_t keyHash, PageToken& token) {
+        if (text.size() != 40 || text.find_first_not_of("0123456789abcdef") != std::string::npos) return false;
+        if (static_cast<uint32_t>(std::stoul(text.substr(32, 8), nullptr, 16)) != keyHash) return false;
+        uint64_t bits = std::stoull(text.substr(0, 16), nullptr, 16);
+        std::memcpy(&token.score, &bits, sizeof(bits));
+        token.docID = static_cast<uint32_t>(std::stoul(text.substr(16, 8), nullptr, 16));
+        token.offset = std::stoul(text.substr(24, 8), nullptr, 16);
+        return true;
+    }
+
+    // one evaluation of a /search page, shared with identical concurrent requests
+    struct PageEvaluation {
+        std::vector<QueryResult> ranked;   // ranked[i] has rank base + i
+        size_t base = 0;
+        bool complete = false;             // no results exist beyond base + ranked.size()
+        bool partial = false;
+        bool hasDeadline = false;          // deadline of the request that evaluated
+        AdmissionController::Clock::time_point deadline;
+        ExpansionStats expansion;
+        std::vector<FuzzyMatch> corrections;
+        FeedbackStats feedback;
+    };
+
+    // optional unsigned parameter (empty: out unchanged); false if malformed or above max
+    template <typename T>
+    static bool parseCount(const std::string& text, uint64_t max, T& out) {
+        if (text.empty()) return true;
+        uint32_t value;
+        if (!FilterOptions::parseNumber(text, value) || value > max) return false;
+        out = static_cast<T>(value);
+        return true;
+    }
+
+    // optional real parameter (empty: out unchanged); false if malformed, not finite or outside [lo, hi]
+    static bool parseReal(const std::string& text, double lo, double hi, double& out) {
+        if (text.empty()) return true;
+        char* end = nullptr;
+        double value = std::strtod(text.c_str(), &end);
+        if (end != text.c_str() + text.size() || !std::isfinite(value) || value < lo || value > hi) return false;
+        out = value;
+        return true;
+    }
+
+    // doc_range, ids, min_len, max_len (see handleSearch); false with an error message if malformed
+    bool parseFilter(const std::string& queryString, FilterOptions& filter, std::string& error) {
+        std::string rangeStr = getParam(queryString, "doc_range");
+        std::string idsStr = getParam(queryString, "ids");
+        std::string minLenStr = getParam(queryString, "min_len");
+        std::string maxLenStr = getParam(queryString, "max_len");
+        if (!rangeStr.empty() && !FilterOptions::parseRanges(rangeStr, filter.docRanges)) {
+            error = "Invalid doc_range (expected lo-hi[,lo-hi...])";
+            return false;
+        }
+        if (!idsStr.empty()) {
+            if (!FilterOptions::parseIDs(idsStr, filter.docIDs)) {
+                error = "Invalid ids (expected id[,id...])";
+                return false;
+            }
+            filter.hasIDs = true;
+        }
+        if ((!minLenStr.empty() && !FilterOptions::parseNumber(minLenStr, filter.minLength)) ||
+            (!maxLenStr.empty() && !FilterOptions::parseNumber(maxLenStr, filter.maxLength))) {
+            error = "Invalid min_len / max_len";
+            return false;
+        }
+        return true;
+    }
+
+    // rank prefetchPages pages from offset (per-request evaluator, no shared mutable state)
+    void evaluatePage(PageEvaluation& out, const ParsedQuery& parsed, const std::string& mode, double k1, double b,
+                      double priorWeight, const RerankOptions& rerank, const ExpansionOptions& expansion,
+                      const FuzzyOptions& fuzzy, const FeedbackOptions& feedback, size_t collapseDepth,
+                      const FilterOptions& filter, QueryBudget& budget, const PageToken* after, size_t offset, size_t pageSize) {
+        QueryEvaluator evaluator(*lexicon, *stats, *docLen, *docTable, *docContent, indexDir,
+                                 bm25::Params(k1, b));
+        evaluator.setDocPriors(docPriors, priorWeight);
+        evaluator.setTierIndex(tierIndex);
+        evaluator.setPairIndex(pairIndex);
+        evaluator.setRerank(rerank);
+        evaluator.setExpansionOptions(expansion);
+        evaluator.setFuzzy(options.fuzzyIndex, fuzzy);
+        evaluator.setFeedback(options.forwardIndex, feedback);
+        evaluator.setCollapse(options.docClusters, collapseDepth);
+        evaluator.setFilter(filter);
+        
+        // handleSearch guarantees offset + pageSize <= maxResultDepth; prefetching stops there too
+        size_t depth = pageSize * std::max<size_t>(options.prefetchPages, 1);
+        out.base = 0;
+        if (after && rerank.depth == 0 && collapseDepth == 0) {
+            evaluator.setSearchAfter(after->score, docPriors->toInternal(after->docID));
+            out.base = offset;
+        } else {
+            depth += offset;
+        }
+        depth = std::max(std::min(depth, options.maxResultDepth - out.base), pageSize);
+        out.ranked = evaluator.processQuery(parsed, mode, static_cast<int>(depth), nullptr, &budget);
+        out.expansion = evaluator.lastExpansion();
+        out.corrections = evaluator.lastCorrections();
+        out.feedback = evaluator.lastFeedback();
+        // collapsing may leave fewer than depth results although more exist
+        out.complete = out.ranked.size() < depth &&
+                       out.ranked.size() + evaluator.lastCollapsed() < std::max(depth, collapseDepth);
+        out.partial = budget.partial;
+    }
+
+    // cache lists that start at rank 1; a resumed list extends the prefix it follows
+    void cacheEvaluation(const std::string& cacheKey, const PageEvaluation& evaluation,
+                         const std::shared_ptr<const ResultCache::Entry>& entry) {
+        if (evaluation.partial || !resultCache.enabled()) return;
+        auto fresh = std::make_shared<ResultCache::Entry>();
+        if (evaluation.base == 0) {
+            fresh->results = evaluation.ranked;
+        } else if (entry && entry->results.size() == evaluation.base) {
+            fresh->results = entry->results;
+            fresh->results.insert(fresh->results.end(), evaluation.ranked.begin(), evaluation.ranked.end());
+        } else {
+            return;
+        }
+        fresh->complete = evaluation.complete;
+        resultCache.put(cacheKey, fresh);
+    }
+
+    // absolute deadline for a request; timeout_ms <= 0 falls back to the server default
+    bool requestDeadline(long long timeoutMs, AdmissionController::Clock::time_point& deadline) const {
+        if (timeoutMs <= 0) timeoutMs = options.defaultTimeoutMs;
+        if (timeoutMs <= 0) return false;
+        deadline = AdmissionController::Clock::now() + std::chrono::milliseconds(timeoutMs);
+        return true;
+    }
+
+    // answer a search that could not be admitted
+    void sendOverloaded(SOCKET clientSocket, AdmissionController::Result result) {
+        const char* message = (result == AdmissionController::Result::Rejected)
+            ? "Server overloaded, retry later"
+            : "Deadline expired while waiting for a search slot";
+        sendJsonError(clientSocket, "503 Service Unavailable", message, "Retry-After: 1\r\n");
+    }
+
+    // send {"error": message} with the given status
+    void sendJsonError(SOCKET clientSocket, const std::string& status, const std::string& message,
+                       std::string_view extraHeaders = std::string_view()) {
+        std::string& body = responseBuffers().body;
+        body.clear();
+        json::Writer json(body);
+        json.beginObject();
+        json.key("error");
+        json.value(message);
+        json.endObject();
+        sendResponse(clientSocket, status, "application/json", body, extraHeaders);
+    }
+
+    /**
+     * POST /search/batch
+     *
+     * Body: either an array of queries or {"queries": [...], <defaults>}.
+     * Each query is a string or {"q", "mode", "k", "k1", "b", "timeout_ms",
+     * "max_postings", "prior_weight", "rerank_depth", "pair_weight",
+     * "span_weight", "max_expansions", "expansion_postings", "fuzzy"}; missing fields fall back to the
+     * top-level defaults of the same name (plus "snippets"). Numbers must be
+     * finite and in range (k and rerank_depth up to --max-depth, k1 >= 0,
+     * b in [0, 1]); otherwise the batch is rejected with 400 before it is
+     * admitted. The whole batch takes one admission slot.
+     * Queries are evaluated concurrently on the worker pool and share lexicon
+     * lookups and decoded posting lists through a BatchTermCache. A query
+     * whose evaluation throws gets {"error": ...} in its response slot.
+     */
+    void handleBatchSearch(SOCKET clientSocket, const std::string& body) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        
+        json::Value root;
+        std::string error;
+        if (!json::parse(body, root, &error)) {
+            sendJsonError(clientSocket, "400 Bad Request", "Invalid JSON: " + error);
+            return;
+        }
+        
+        static const json::Value emptyObject;
+        const json::Value& defaults = root.isObject() ? root : emptyObject;
+        const json::Value* queries = root.isArray() ? &root : root.get("queries");
+        if (!queries || !queries->isArray()) {
+            sendJsonError(clientSocket, "400 Bad Request", "Expected an array of queries");
+            return;
+        }
+        if (queries->items.size() > MAX_BATCH_QUERIES) {
+            sendJsonError(clientSocket, "400 Bad Request",
+                          "Too many queries (max " + std::to_string(MAX_BATCH_QUERIES) + ")");
+            return;
+        }
+        
+        // every field is validated before the batch takes an admission slot
+        BatchSettings batchDefaults;
+        batchDefaults.k1 = bm25Params.k1;
+        batchDefaults.b = bm25Params.b;
+        batchDefaults.rerank = serverRerank();
+        const char* invalid = nullptr;
+        if (!readBatchSettings(defaults, batchDefaults, invalid)) {
+            sendJsonError(clientSocket, "400 Bad Request", std::string("Invalid value for ") + invalid);
+            return;
+        }
+        bool snippets = defaults.getBool("snippets", true);
+        
+        // parse and tokenize all queries
+        struct BatchQuery {
+            std::string mode;
+            int k;
+            bm25::Params params;
+            ParsedQuery parsed;
+            std::vector<QueryResult> results;
+            long long timeMs;
+            QueryBudget budget;
+            double priorWeight;
+            RerankOptions rerank;
+            ExpansionOptions expansionOptions;
+            ExpansionStats expansion;
+            FuzzyOptions fuzzy;
+            std::vector<FuzzyMatch> corrections;
+            std::string error;      // set if the evaluation threw
+        };
+        std::vector<BatchQuery> batch(queries->items.size());
+        std::vector<std::vector<std::string>> allTerms;
+        allTerms.reserve(batch.size());
+        
+        for (size_t i = 0; i < batch.size(); i++) {
+            const json::Value& q = queries->items[i];
+            std::string text = q.isString() ? q.str : q.getString("q", "");
+            BatchSettings settings = batchDefaults;
+            if (!readBatchSettings(q, settings, invalid)) {
+                sendJsonError(clientSocket, "400 Bad Request",
+                              std::string("Invalid value for ") + invalid + " in query " + std::to_string(i));
+                return;
+            }
+            batch[i].mode = settings.mode;
+            batch[i].k = settings.k;
+            batch[i].params = bm25::Params(settings.k1, settings.b);
+            batch[i].timeMs = 0;
             
-            // generate query-dependent snippet
-            std::string snippet;
-            auto it = contents.find(docID);
-            if (it != contents.end() && !it->second.empty()) {
-                snippet = SnippetGenerator::generate(it->second, queryTerms);
-            } else {
-                snippet = "(No content available)";
+            AdmissionController::Clock::time_point deadline;
+            if (requestDeadline(settings.timeoutMs, deadline)) {
+                batch[i].budget = QueryBudget::until(deadline);
             }
+            batch[i].budget.maxPostings = settings.maxPostings;
+            batch[i].priorWeight = settings.priorWeight;
+            batch[i].rerank = settings.rerank;
+            batch[i].expansionOptions = settings.expansion;
+            batch[i].fuzzy.enabled = settings.fuzzy;
             
-            json << "    {\n";
-            json << "      \"rank\": " << (i + 1) << ",\n";
-            json << "      \"docID\": " << docID << ",\n";
-            json << "      \"score\": " << std::fixed << std::setprecision(4) << results[i].score << ",\n";
-            json << "      \"original_id\": \"" << escapeJson(docTable->originalID(docID)) << "\",\n";
-            json << "      \"snippet\": \"" << escapeJson(snippet) << "\"\n";
-            json << "    }";
+            batch[i].parsed = QueryParser::parse(text);
+            allTerms.push_back(batch[i].parsed.terms);
+        }
+        
+        // the batch waits at most until its latest query deadline
+        bool batchHasDeadline = true;
+        AdmissionController::Clock::time_point batchDeadline = AdmissionController::Clock::time_point::min();
+        for (const auto& query : batch) {
+            if (!query.budget.hasDeadline) {
+                batchHasDeadline = false;
+                break;
+            }
+            batchDeadline = std::max(batchDeadline, query.budget.deadline);
+        }
+        AdmissionController::Slot slot(admission, batchHasDeadline, batchDeadline);
+        if (!slot.admitted()) {
+            sendOverloaded(clientSocket, slot.status());
+            return;
+        }
+        
+        BatchTermCache cache(*lexicon, indexDir, allTerms);
+        
+        // evaluate concurrently, one evaluator per task (no shared mutable state)
+        std::vector<std::future<void>> pending;
+        pending.reserve(batch.size());
+        for (auto& query : batch) {
+            pending.push_back(workers.submit([this, &query, &cache] {
+                auto queryStart = std::chrono::high_resolution_clock::now();
+                // a failing query (bad_alloc, a throwing reranker) gets an error
+                // entry; an exception must not reach get() on the client thread
+                try {
+                    QueryEvaluator local(*lexicon, *stats, *docLen, *docTable, *docContent, indexDir, query.params);
+                    local.setDocPriors(docPriors, query.priorWeight);
+                    local.setPairIndex(pairIndex);
+                    local.setRerank(query.rerank);
+                    local.setExpansionOptions(query.expansionOptions);
+                    local.setFuzzy(options.fuzzyIndex, query.fuzzy);
+                    query.results = local.processQuery(query.parsed, query.mode, query.k, &cache, &query.budget);
+                    query.expansion = local.lastExpansion();
+                    query.corrections = local.lastCorrections();
+                } catch (const std::exception& e) {
+                    query.results.clear();
+                    query.error = std::string("query failed: ") + e.what();
+                } catch (...) {
+                    query.results.clear();
+                    query.error = "query failed";
+                }
+                query.timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::high_resolution_clock::now() - queryStart).count();
+            }));
+        }
+        for (auto& f : pending) f.get();
+        
+        // one sorted content read for the union of all result docIDs
+        std::unordered_map<uint32_t, std::string> contents;
+        if (snippets) {
+            std::vector<uint32_t> docIDs;
+            for (const auto& query : batch) {
+                for (const auto& r : query.results) docIDs.push_back(r.docID);
+            }
+            std::sort(docIDs.begin(), docIDs.end());
+            docIDs.erase(std::unique(docIDs.begin(), docIDs.end()), docIDs.end());
+            contents = docContent->getBatch(docIDs);
+        }
+        
+        long long batchTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - startTime).count();
+        
+        std::string& out = responseBuffers().body;
+        out.clear();
+        json::Writer json(out);
+        json.beginObject();
+        json.key("num_queries");
+        json.value(batch.size());
+        json.key("shared_terms");
+        json.value(cache.sharedCount());
+        json.key("batch_time_ms");
+        json.value(batchTime);
+        json.key("responses");
+        json.beginArray();
+        for (const auto& query : batch) {
+            if (!query.error.empty()) {
+                json.beginObject();
+                json.key("error");
+                json.value(query.error);
+                json.endObject();
+                continue;
+            }
+            writeSearchResult(json, query.results, query.parsed.terms, query.timeMs, query.budget.partial,
+                              snippets ? &contents : nullptr, &query.expansion, &query.corrections);
+        }
+        json.endArray();
+        json.endObject();
+        
+        sendResponse(clientSocket, "200 OK", "application/json", out);
+    }
+
+    /**
+     * GET /search?q=&mode=&k=&k1=&b=&timeout_ms=&max_postings=&prior_weight=
+     *             &rerank_depth=&pair_weight=&span_weight=&max_expansions=&expansion_postings=
+     *             &fuzzy=1&offset=&page=&after=&rm3=1&fb_docs=&fb_terms=&fb_weight=&collapse=1
+     *             &doc_range=&ids=&min_len=&max_len=
+     *
+     * Runs under an admission slot; if the deadline or the postings budget
+     * (anytime mode) runs out during evaluation the best-so-far results are
+     * returned with "partial": true. Malformed or out-of-range numbers are
+     * rejected with 400, as are pages ending beyond --max-depth.
+     *
+     * Pagination: offset (or 1-based page, offset = (page - 1) * k) skips
+     * results; "next" in the response is an opaque token for after= that
+     * resumes behind the page's last result. Each evaluation ranks
+     * prefetchPages pages and caches the list (complete results only), so
+     * following pages are usually slices of the cache. When the entry has
+     * expired, a token resumes with a search-after bound and ranks only the
+     * results behind it, instead of the whole prefix; with re-ranking the
+     * bound is not comparable, and the prefix is ranked again. Collapsed lists
+     * are ranked from the top as well, so that a page never repeats a cluster
+     * shown on an earlier page.
+     *
+     * rm3=1 expands bag-of-words queries with RM3 feedback when the index has
+     * a forward index (fb_docs, fb_terms, fb_weight as in FeedbackOptions);
+     * "feedback" reports the weighted query and the time of each stage.
+     *
+     * collapse=1 keeps only the best result of each near-duplicate cluster
+     * (doc_canonical.bin next to the doc table) among the top --collapse-depth
+     * candidates, or the whole prefetched list if that is deeper.
+     *
+     * doc_range=lo-hi[,lo-hi...] (e.g. the docIDs of one source), ids=a,b,c
+     * and min_len / max_len (passage length in tokens) restrict the results;
+     * the filter is applied while the posting lists are traversed (see
+     * QueryEvaluator::setFilter), so pages are full and skip only rejected
+     * documents. Malformed filters are rejected with 400.
+     *
+     * Identical requests (same result key and page) that miss the cache while
+     * one is being evaluated wait for its result instead of taking a slot of
+     * their own ("coalesced": true), up to their own deadline (503 after it).
+     * A partial result is only shared with requests whose deadline is no later
+     * than the evaluating request's; the others evaluate themselves.
+     */
+    void handleSearch(SOCKET clientSocket, const std::string& queryString) {
+        std::string query = getParam(queryString, "q");
+        std::string modeStr = getParam(queryString, "mode");
+        std::string kStr = getParam(queryString, "k");
+        std::string k1Str = getParam(queryString, "k1");
+        std::string bStr = getParam(queryString, "b");
+        std::string timeoutStr = getParam(queryString, "timeout_ms");
+        std::string maxPostingsStr = getParam(queryString, "max_postings");
+        std::string priorWeightStr = getParam(queryString, "prior_weight");
+        std::string rerankStr = getParam(queryString, "rerank_depth");
+        std::string pairWeightStr = getParam(queryString, "pair_weight");
+        std::string spanWeightStr = getParam(queryString, "span_weight");
+        std::string maxExpansionsStr = getParam(queryString, "max_expansions");
+        std::string expansionPostingsStr = getParam(queryString, "expansion_postings");
+        std::string fuzzyStr = getParam(queryString, "fuzzy");
+        std::string offsetStr = getParam(queryString, "offset");
+        std::string pageStr = getParam(queryString, "page");
+        std::string afterStr = getParam(queryString, "after");
+        std::string rm3Str = getParam(queryString, "rm3");
+        std::string fbDocsStr = getParam(queryString, "fb_docs");
+        std::string fbTermsStr = getParam(queryString, "fb_terms");
+        std::string fbWeightStr = getParam(queryString, "fb_weight");
+        std::string collapseStr = getParam(queryString, "collapse");
+        
+        std::string mode = modeStr;
+        auto startTime = std::chrono::high_resolution_clock::now();
+        
+        // numeric parameters are validated before anything is evaluated
+        uint64_t maxDepth = std::min<uint64_t>(options.maxResultDepth, INT_MAX);
+        int k = 10;
+        double k1 = 0.9;
+        double b = 0.4;
+        long long timeoutMs = 0;
+        uint64_t maxPostings = 0;
+        double priorWeight = 0.0;
+        RerankOptions rerank = serverRerank();
+        ExpansionOptions expansion;
+        FeedbackOptions feedback;
+        uint64_t offset = 0;
+        uint64_t pageNumber = 0;
+        const char* invalid = nullptr;
+        if (!parseCount(kStr, maxDepth, k)) invalid = "k";
+        else if (!parseReal(k1Str, 0.0, MAX_K1, k1)) invalid = "k1";
+        else if (!parseReal(bStr, 0.0, 1.0, b)) invalid = "b";
+        else if (!parseCount(timeoutStr, MAX_TIMEOUT_MS, timeoutMs)) invalid = "timeout_ms";
+        else if (!parseCount(maxPostingsStr, UINT32_MAX, maxPostings)) invalid = "max_postings";
+        else if (!parseReal(priorWeightStr, -MAX_WEIGHT, MAX_WEIGHT, priorWeight)) invalid = "prior_weight";
+        else if (!parseCount(rerankStr, maxDepth, rerank.depth)) invalid = "rerank_depth";
+        else if (!parseReal(pairWeightStr, -MAX_WEIGHT, MAX_WEIGHT, rerank.pairWeight)) invalid = "pair_weight";
+        else if (!parseReal(spanWeightStr, -MAX_WEIGHT, MAX_WEIGHT, rerank.spanWeight)) invalid = "span_weight";
+        else if (!parseCount(maxExpansionsStr, UINT32_MAX, expansion.maxTerms)) invalid = "max_expansions";
+        else if (!parseCount(expansionPostingsStr, UINT32_MAX, expansion.maxPostings)) invalid = "expansion_postings";
+        else if (!parseCount(fbDocsStr, maxDepth, feedback.docs)) invalid = "fb_docs";
+        else if (!parseCount(fbTermsStr, TermAccumulator::CAPACITY, feedback.terms)) invalid = "fb_terms";
+        else if (!parseReal(fbWeightStr, 0.0, 1.0, feedback.originalWeight)) invalid = "fb_weight";
+        else if (!parseCount(offsetStr, maxDepth, offset)) invalid = "offset";
+        else if (!parseCount(pageStr, maxDepth, pageNumber)) invalid = "page";
+        if (invalid) {
+            sendJsonError(clientSocket, "400 Bad Request", std::string("Invalid value for ") + invalid);
+            return;
+        }
+        
+        QueryBudget budget;
+        AdmissionController::Clock::time_point deadline;
+        bool hasDeadline = requestDeadline(timeoutMs, deadline);
+        if (hasDeadline) budget = QueryBudget::until(deadline);
+        budget.maxPostings = maxPostings;
+        FuzzyOptions fuzzy;
+        fuzzy.enabled = (fuzzyStr == "1" || fuzzyStr == "true");
+        feedback.enabled = options.forwardIndex && (rm3Str == "1" || rm3Str == "true");
+        size_t collapseDepth = (options.docClusters && (collapseStr == "1" || collapseStr == "true"))
+                               ? std::max<size_t>(options.collapseDepth, 1) : 0;
+        FilterOptions filter;
+        std::string filterError;
+        if (!parseFilter(queryString, filter, filterError)) {
+            sendJsonError(clientSocket, "400 Bad Request", filterError);
+            return;
+        }
+        
+        // tokenize query ("quoted phrases" and NEAR/k become positional constraints)
+        ParsedQuery parsed = QueryParser::parse(query);
+        const std::vector<std::string>& queryTerms = parsed.terms;
+        
+        size_t pageSize = static_cast<size_t>(k);
+        if (pageNumber > 1) offset = (pageNumber - 1) * pageSize;   // both bounded by maxDepth: no overflow
+        std::string cacheKey = resultKey(query, mode, k1, b, priorWeight, rerank, expansion, fuzzy.enabled,
+                                         feedback, collapseDepth, filter);
+        uint32_t keyHash = static_cast<uint32_t>(std::hash<std::string>{}(cacheKey));
+        PageToken after{0.0, 0, 0};
+        bool hasAfter = !afterStr.empty();
+        if (hasAfter && !decodeToken(afterStr, keyHash, after)) {
+            sendJsonError(clientSocket, "400 Bad Request", "Invalid continuation token for this query");
+            return;
         }
+        if (hasAfter) offset = after.offset;
+        if (offset + pageSize > maxDepth) {
+            sendJsonError(clientSocket, "400 Bad Request",
+                          "Results beyond rank " + std::to_string(maxDepth) + " are not available");
+            return;
+        }
+
+        // execute query (per-request evaluator, no shared mutable state)
+        std::vector<QueryResult> results;
+        ExpansionStats expansionStats;
+        std::vector<FuzzyMatch> corrections;
+        FeedbackStats feedbackStats;
+        bool complete = false;   // no results exist beyond `total`
+        bool partial = false;
+        size_t total = 0;
+        bool cached = false;
+        bool coalesced = false;
         
-        json << "\n  ]\n";
-        json << "}";
+        std::shared_ptr<const ResultCache::Entry> entry = resultCache.find(cacheKey);
+        if (entry && entry->covers(offset, pageSize)) {
+            slice(entry->results, offset, pageSize, results);
+            complete = entry->complete;
+            total = entry->results.size();
+            cached = true;
+        } else {
+            // identical requests in flight share one evaluation
+            std::string flightKey = cacheKey + '#' + std::to_string(offset) + '#' + std::to_string(pageSize) +
+                                    '#' + afterStr;
+            bool leader = false;
+            auto call = inFlight.join(flightKey, leader);
+            SingleFlight<PageEvaluation>::Guard flight(inFlight, flightKey, call, leader);
+            std::shared_ptr<const PageEvaluation> shared;
+            if (!leader) {
+                if (!inFlight.wait(call, hasDeadline, deadline, shared)) {
+                    sendOverloaded(clientSocket, AdmissionController::Result::TimedOut);
+                    return;
+                }
+                // a partial answer is only good enough for requests that could not wait longer
+                if (shared && shared->partial &&
+                    !(hasDeadline && shared->hasDeadline && deadline <= shared->deadline)) {
+                    shared.reset();
+                }
+                coalesced = (shared != nullptr);
+            }
+            if (!shared) {
+                AdmissionController::Slot slot(admission, hasDeadline, deadline);
+                if (!slot.admitted()) {
+                    flight.publish(nullptr);
+                    sendOverloaded(clientSocket, slot.status());
+                    return;
+                }
+                auto evaluation = std::make_shared<PageEvaluation>();
+                evaluation->hasDeadline = hasDeadline;
+                evaluation->deadline = deadline;
+                entry = resultCache.find(cacheKey);   // may have been filled while this request waited
+                if (entry && entry->covers(offset, pageSize)) {
+                    evaluation->ranked = entry->results;
+                    evaluation->complete = entry->complete;
+                    cached = true;
+                } else {
+                    evaluatePage(*evaluation, parsed, mode, k1, b, priorWeight, rerank, expansion, fuzzy, feedback,
+                                 collapseDepth, filter, budget, hasAfter ? &after : nullptr, offset, pageSize);
+                    cacheEvaluation(cacheKey, *evaluation, entry);
+                }
+                shared = evaluation;
+                flight.publish(shared);
+            }
+            slice(shared->ranked, offset - shared->base, pageSize, results);
+            expansionStats = shared->expansion;
+            feedbackStats = shared->feedback;
+            corrections = shared->corrections;
+            complete = shared->complete;
+            partial = shared->partial;
+            total = shared->base + shared->ranked.size();
+        }
+        
+        PageInfo page{offset, std::string(), cached, coalesced, collapseDepth > 0};
+        if (!results.empty() && results.size() == pageSize && !(complete && offset + pageSize >= total) &&
+            offset + 2 * pageSize <= maxDepth) {
+            page.next = encodeToken({results.back().score, results.back().docID, offset + pageSize}, keyHash);
+        }
+       
+        auto endTime = std::chrono::high_resolution_clock::now();
+        long long queryTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+            endTime - startTime).count();
         
-        return json.str();
+        // generate JSON response
+        std::string& body = responseBuffers().body;
+        body.clear();
+        generateJsonResponse(body, results, queryTerms, queryTime, partial, &expansionStats, &corrections, &page,
+                             &feedbackStats);
+        sendResponse(clientSocket, "200 OK", "application/json", body);
     }
 
+    /**
+     * GET /count?q=&mode=&approx=&timeout_ms=&fuzzy=&doc_range=&ids=&min_len=&max_len=
+     *
+     * Number of matching documents, without scoring or fetching content
+     * (QueryEvaluator::countQuery). approx=1 returns an estimate from df and
+     * sampled postings (filtered counts are always exact). Phrase / NEAR
+     * queries are rejected.
+     */
+    void handleCount(SOCKET clientSocket, const std::string& queryString) {
+        auto startTime = std::chrono::steady_clock::now();
+        std::string query = getParam(queryString, "q");
+        std::string mode = getParam(queryString, "mode");
+        std::string approxStr = getParam(queryString, "approx");
+        std::string timeoutStr = getParam(queryString, "timeout_ms");
+        std::string fuzzyStr = getParam(queryString, "fuzzy");
+        bool approximate = (approxStr == "1" || approxStr == "true");
+        long long timeoutMs = 0;
+        if (!parseCount(timeoutStr, MAX_TIMEOUT_MS, timeoutMs)) {
+            sendJsonError(clientSocket, "400 Bad Request", "Invalid value for timeout_ms");
+            return;
+        }
+        FuzzyOptions fuzzy;
+        fuzzy.enabled = (fuzzyStr == "1" || fuzzyStr == "true");
+        FilterOptions filter;
+        std::string filterError;
+        if (!parseFilter(queryString, filter, filterError)) {
+            sendJsonError(clientSocket, "400 Bad Request", filterError);
+            return;
+        }
+
+        QueryBudget budget;
+        AdmissionController::Clock::time_point deadline;
+        bool hasDeadline = requestDeadline(timeoutMs, deadline);
+        if (hasDeadline) budget = QueryBudget::until(deadline);
+
+        ParsedQuery parsed = QueryParser::parse(query);
+        MatchCount matches;
+        {
+            AdmissionController::Slot slot(admission, hasDeadline, deadline);
+            if (!slot.admitted()) {
+                sendOverloaded(clientSocket, slot.status());
+                return;
+            }
+            QueryEvaluator evaluator(*lexicon, *stats, *docLen, *docTable, *docContent, indexDir,
+                                     bm25::Params(0.9, 0.4));
+            evaluator.setFuzzy(options.fuzzyIndex, fuzzy);
+            evaluator.setDocPriors(docPriors);
+            evaluator.setFilter(filter);
+            matches = evaluator.countQuery(parsed, mode, approximate, &budget);
+        }
+        if (!matches.supported) {
+            sendJsonError(clientSocket, "400 Bad Request", "Phrase and NEAR queries cannot be counted");
+            return;
+        }
+        long long elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+
+        std::string& body = responseBuffers().body;
+        body.clear();
+        json::Writer json(body);
+        json.beginObject();
+        json.key("query");
+        json.value(query);
+        json.key("mode");
+        json.value(mode == "and" ? "and" : "or");
+        json.key("count");
+        json.value(static_cast<unsigned long long>(matches.count));
+        json.key("exact");
+        json.value(matches.exact && !budget.partial);
+        json.key("partial");
+        json.value(budget.partial);
+        json.key("postings");
+        json.value(static_cast<unsigned long long>(matches.postings));
+        json.key("time_us");
+        json.value(elapsedUs);
+        json.endObject();
+        sendResponse(clientSocket, "200 OK", "application/json", body);
+    }
+
+    /**
+     * GET /suggest?prefix=&k=
+     *
+     * Completes the last word of prefix from the completion trie; the
+     * earlier words are kept, so "text" is the full suggested query. Never
+     * reads posting lists and needs no admission slot.
+     */
+    void handleSuggest(SOCKET clientSocket, const std::string& queryString) {
+        auto startTime = std::chrono::steady_clock::now();
+        std::string prefix = getParam(queryString, "prefix");
+        std::string kStr = getParam(queryString, "k");
+        size_t k = 8;
+        if (!parseCount(kStr, MAX_SUGGESTIONS, k)) {
+            sendJsonError(clientSocket, "400 Bad Request", "Invalid value for k");
+            return;
+        }
+
+        std::string lower = prefix;
+        std::transform(lower.begin(), lower.end(), lower.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        size_t wordStart = lower.find_last_of(' ') + 1;   // npos + 1 == 0
+        std::string word = lower.substr(wordStart);
+
+        std::vector<CompletionTrie::Completion> completions;
+        if (options.suggestions && !word.empty()) {
+            options.suggestions->complete(word, k, completions);
+        }
+        long long elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
 
-    // Read static file
-    std::string readFile(const std::string& filename) {
-        std::ifstream file(filename);
-        if (!file.is_open()) return "";
+        std::string& body = responseBuffers().body;
+        body.clear();
+        json::Writer json(body);
+        json.beginObject();
+        json.key("prefix");
+        json.value(prefix);
+        json.key("suggestions");
+        json.beginArray();
+        for (const auto& c : completions) {
+            json.beginObject();
+            json.key("text");
+            json.value(lower.substr(0, wordStart) + c.term);
+            json.key("term");
+            json.value(c.term);
+            json.key("weight");
+            json.value(static_cast<unsigned long long>(c.weight));
+            json.endObject();
+        }
+        json.endArray();
+        json.key("time_us");
+        json.value(elapsedUs);
+        json.endObject();
+        sendResponse(clientSocket, "200 OK", "application/json", body);
+    }
+
+    // read the request head and, if present, a Content-Length body
+    bool readRequest(SOCKET clientSocket, std::string& request, size_t& bodyStart, bool& tooLarge) {
+        char buffer[4096];
+        tooLarge = false;
         
-        std::ostringstream ss;
-        ss << file.rdbuf();
-        return ss.str();
+        size_t headEnd;
+        while ((headEnd = request.find("\r\n\r\n")) == std::string::npos) {
+            if (request.size() > MAX_HEADER_BYTES) {
+                tooLarge = true;
+                return false;
+            }
+            int bytesRead = recv(clientSocket, buffer, sizeof(buffer), 0);
+            if (bytesRead <= 0) return !request.empty();
+            request.append(buffer, bytesRead);
+        }
+        bodyStart = headEnd + 4;
+        
+        std::string lengthStr = getHeader(request.substr(0, bodyStart), "Content-Length");
+        size_t contentLength = lengthStr.empty() ? 0 : std::strtoull(lengthStr.c_str(), nullptr, 10);
+        if (contentLength > MAX_BODY_BYTES) {
+            tooLarge = true;
+            return false;
+        }
+        
+        while (request.size() - bodyStart < contentLength) {
+            int bytesRead = recv(clientSocket, buffer, sizeof(buffer), 0);
+            if (bytesRead <= 0) break;
+            request.append(buffer, bytesRead);
+        }
+        return true;
+    }
+
+    // Static file loaded once at startup, served with precomputed headers
+    // (the body is sent from memory, so headers and content always agree)
+    struct StaticAsset {
+        std::string etag;
+        std::string gzipETag;       // etag of the gzip variant ("...-gz")
+        std::string body;           // identity content
+        std::string gzipBody;       // precompressed "<file>.gz" variant (optional)
+        std::string header;         // 200 headers for identity content
+        std::string gzipHeader;     // 200 headers for gzip content
+        std::string notModified;    // complete 304 responses
+        std::string gzipNotModified;
+    };
+    std::unordered_map<std::string, StaticAsset> staticAssets;  // URL path -> asset
+
+    // Read whole file (binary)
+    static bool readFile(const std::string& filename, std::string& out) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) return false;
+
+        file.seekg(0, std::ios::end);
+        std::streamoff size = file.tellg();
+        file.seekg(0, std::ios::beg);
+        out.resize(static_cast<size_t>(size));
+        file.read(&out[0], size);
+        return static_cast<bool>(file);
+    }
+
+    // Strong ETag from a 64-bit FNV-1a hash of the content
+    static std::string computeETag(const std::string& content) {
+        uint64_t h = 1469598103934665603ULL;
+        for (unsigned char c : content) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        char buf[24];
+        auto res = std::to_chars(buf, buf + sizeof(buf), h, 16);
+        return "\"" + std::string(buf, res.ptr - buf) + "-" + std::to_string(content.size()) + "\"";
+    }
+
+    static std::string assetHeader(const std::string& contentType, const std::string& etag,
+                                   size_t length, bool gzip) {
+        std::string header;
+        header.append("HTTP/1.1 200 OK\r\n");
+        header.append("Content-Type: ").append(contentType).append("; charset=utf-8\r\n");
+        header.append("Content-Length: ").append(std::to_string(length)).append("\r\n");
+        if (gzip) header.append("Content-Encoding: gzip\r\n");
+        header.append("ETag: ").append(etag).append("\r\n");
+        header.append("Cache-Control: no-cache\r\n");
+        header.append("Vary: Accept-Encoding\r\n");
+        header.append("Access-Control-Allow-Origin: *\r\n");
+        header.append("Connection: close\r\n");
+        header.append("\r\n");
+        return header;
+    }
+
+    // Load a static file (and its optional .gz sibling) for the given URL paths
+    void loadStaticAsset(const std::vector<std::string>& urlPaths, const std::string& filename) {
+        StaticAsset asset;
+        if (!readFile(filename, asset.body)) {
+            std::cerr << "Warning: static file not found: " << filename << std::endl;
+            return;
+        }
+        bool hasGzip = readFile(filename + ".gz", asset.gzipBody);
+
+        std::string contentType = getContentType(filename);
+        asset.etag = computeETag(asset.body);
+        asset.header = assetHeader(contentType, asset.etag, asset.body.size(), false);
+        asset.notModified = notModifiedResponse(asset.etag);
+        if (hasGzip) {
+            // each representation has its own strong ETag
+            asset.gzipETag = asset.etag.substr(0, asset.etag.size() - 1) + "-gz\"";
+            asset.gzipHeader = assetHeader(contentType, asset.gzipETag, asset.gzipBody.size(), true);
+            asset.gzipNotModified = notModifiedResponse(asset.gzipETag);
+        }
+        std::cout << "Loaded static file " << filename << " (" << asset.body.size() << " bytes"
+                  << (hasGzip ? ", gzip variant" : "") << ")" << std::endl;
+
+        for (size_t i = 0; i + 1 < urlPaths.size(); i++) staticAssets[urlPaths[i]] = asset;
+        staticAssets[urlPaths.back()] = std::move(asset);
+    }
+
+    static std::string notModifiedResponse(const std::string& etag) {
+        return "HTTP/1.1 304 Not Modified\r\nETag: " + etag +
+               "\r\nCache-Control: no-cache\r\nVary: Accept-Encoding\r\n"
+               "Connection: close\r\n\r\n";
+    }
+
+    /**
+     * Whether an Accept-Encoding value allows gzip: listed as "gzip" (or
+     * covered by "*") with a non-zero q-value.
+     */
+    static bool acceptsGzip(const std::string& acceptEncoding) {
+        bool gzip = false, wildcard = false, gzipListed = false;
+        std::istringstream list(acceptEncoding);
+        std::string item;
+        while (std::getline(list, item, ',')) {
+            std::istringstream parts(item);
+            std::string coding, param;
+            std::getline(parts, coding, ';');
+            coding = trim(coding);
+            std::transform(coding.begin(), coding.end(), coding.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            double q = 1.0;
+            while (std::getline(parts, param, ';')) {
+                param = trim(param);
+                if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                    char* end = nullptr;
+                    q = std::strtod(param.c_str() + 2, &end);
+                    if (end == param.c_str() + 2) q = 0.0;
+                }
+            }
+            if (coding == "gzip") {
+                gzipListed = true;
+                gzip = q > 0.0;
+            } else if (coding == "*") {
+                wildcard = q > 0.0;
+            }
+        }
+        return gzipListed ? gzip : wildcard;
+    }
+
+    static std::string trim(const std::string& s) {
+        size_t start = s.find_first_not_of(" \t");
+        if (start == std::string::npos) return std::string();
+        return s.substr(start, s.find_last_not_of(" \t") - start + 1);
+    }
+
+    // Serve a preloaded asset: 304 on ETag match of the chosen variant, gzip when accepted
+    void sendStaticAsset(SOCKET clientSocket, const StaticAsset& asset,
+                         const std::string& request, bool headOnly) {
+        bool gzip = !asset.gzipBody.empty() && acceptsGzip(getHeader(request, "Accept-Encoding"));
+        const std::string& etag = gzip ? asset.gzipETag : asset.etag;
+
+        std::string ifNoneMatch = getHeader(request, "If-None-Match");
+        if (!ifNoneMatch.empty() &&
+            (ifNoneMatch == "*" || ifNoneMatch.find(etag) != std::string::npos)) {
+            sendAll(clientSocket, gzip ? asset.gzipNotModified : asset.notModified, std::string_view());
+            return;
+        }
+
+        const std::string& header = gzip ? asset.gzipHeader : asset.header;
+        const std::string& body = gzip ? asset.gzipBody : asset.body;
+        sendAll(clientSocket, header, headOnly ? std::string_view() : std::string_view(body));
+    }
+
+    // Case-insensitive lookup of a request header value
+    static std::string getHeader(const std::string& request, const std::string& name) {
+        size_t pos = request.find("\r\n");
+        while (pos != std::string::npos) {
+            size_t lineStart = pos + 2;
+            size_t lineEnd = request.find("\r\n", lineStart);
+            if (lineEnd == std::string::npos || lineEnd == lineStart) break;
+
+            size_t colon = request.find(':', lineStart);
+            if (colon != std::string::npos && colon < lineEnd && colon - lineStart == name.size()) {
+                bool match = true;
+                for (size_t i = 0; i < name.size(); i++) {
+                    if (std::tolower(static_cast<unsigned char>(request[lineStart + i])) !=
+                        std::tolower(static_cast<unsigned char>(name[i]))) {
+                        match = false;
+                        break;
+                    }
+                }
+                if (match) {
+                    size_t valueStart = request.find_first_not_of(" \t", colon + 1);
+                    if (valueStart == std::string::npos || valueStart > lineEnd) return "";
+                    return request.substr(valueStart, lineEnd - valueStart);
+                }
+            }
+            pos = lineEnd;
+        }
+        return "";
     }
     
     // Get content type based on file extension
-    std::string getContentType(const std::string& path) {
+    static std::string getContentType(const std::string& path) {
         if (path.find(".html") != std::string::npos) return "text/html";
         if (path.find(".css") != std::string::npos) return "text/css";
         if (path.find(".js") != std::string::npos) return "application/javascript";
@@ -180,35 +1360,92 @@ private:
         return "text/plain";
     }
     
+    // write header and body with one gather call, retrying on partial writes
+    void sendAll(SOCKET clientSocket, std::string_view header, std::string_view body) {
+#ifdef _WIN32
+        WSABUF bufs[2];
+        bufs[0].buf = const_cast<char*>(header.data());
+        bufs[0].len = static_cast<ULONG>(header.size());
+        bufs[1].buf = const_cast<char*>(body.data());
+        bufs[1].len = static_cast<ULONG>(body.size());
+
+        int first = 0;
+        while (first < 2) {
+            DWORD sent = 0;
+            if (WSASend(clientSocket, bufs + first, 2 - first, &sent, 0, NULL, NULL) == SOCKET_ERROR) {
+                if (WSAGetLastError() == WSAEINTR) continue;
+                return;
+            }
+            size_t written = sent;
+            while (first < 2 && written >= bufs[first].len) {
+                written -= bufs[first].len;
+                first++;
+            }
+            if (first < 2) {
+                bufs[first].buf += written;
+                bufs[first].len -= static_cast<ULONG>(written);
+            }
+        }
+#else
+        iovec iov[2];
+        iov[0].iov_base = const_cast<char*>(header.data());
+        iov[0].iov_len = header.size();
+        iov[1].iov_base = const_cast<char*>(body.data());
+        iov[1].iov_len = body.size();
+
+        int first = 0;
+        while (first < 2) {
+            ssize_t n = writev(clientSocket, iov + first, 2 - first);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return;
+            }
+            size_t written = static_cast<size_t>(n);
+            while (first < 2 && written >= iov[first].iov_len) {
+                written -= iov[first].iov_len;
+                first++;
+            }
+            if (first < 2) {
+                iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + written;
+                iov[first].iov_len -= written;
+            }
+        }
+#endif
+    }
+
     // send HTTP response
     void sendResponse(SOCKET clientSocket, const std::string& status, 
-                     const std::string& contentType, const std::string& body) {
-        std::ostringstream response;
-        response << "HTTP/1.1 " << status << "\r\n";
-        response << "Content-Type: " << contentType << "; charset=utf-8\r\n";
-        response << "Content-Length: " << body.length() << "\r\n";
-        response << "Access-Control-Allow-Origin: *\r\n";
-        response << "Connection: close\r\n";
-        response << "\r\n";
-        response << body;
-        
-        std::string resp = response.str();
-        send(clientSocket, resp.c_str(), resp.length(), 0);
+                     const std::string& contentType, std::string_view body,
+                     std::string_view extraHeaders = std::string_view()) {
+        std::string& header = responseBuffers().header;
+        header.clear();
+        header.append("HTTP/1.1 ").append(status).append("\r\n");
+        header.append("Content-Type: ").append(contentType).append("; charset=utf-8\r\n");
+        header.append("Content-Length: ");
+        json::appendInt(header, body.size());
+        header.append("\r\n");
+        header.append("Access-Control-Allow-Origin: *\r\n");
+        header.append(extraHeaders.data(), extraHeaders.size());
+        header.append("Connection: close\r\n");
+        header.append("\r\n");
+
+        sendAll(clientSocket, header, body);
     }
     
     // handle client connection
     void handleClient(SOCKET clientSocket) {
-        char buffer[4096];
-        int bytesRead = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
+        std::string request;
+        size_t bodyStart = std::string::npos;
+        bool tooLarge = false;
         
-        if (bytesRead <= 0) {
+        if (!readRequest(clientSocket, request, bodyStart, tooLarge)) {
+            if (tooLarge) {
+                sendResponse(clientSocket, "413 Payload Too Large", "text/plain", "Payload Too Large");
+            }
             closesocket(clientSocket);
             return;
         }
         
-        buffer[bytesRead] = '\0';
-        std::string request(buffer);
-        
         // parse request line
         size_t methodEnd = request.find(' ');
         size_t pathEnd = request.find(' ', methodEnd + 1);
@@ -234,54 +1471,26 @@ private:
         std::cout << "Request: " << method << " " << path << std::endl;
         
         // route requests
-        if (path == "/" || path == "/index.html") {
-            std::string html = readFile("web/index.html");
-            if (html.empty()) {
-                sendResponse(clientSocket, "404 Not Found", "text/plain", "File not found");
-            } else {
-                sendResponse(clientSocket, "200 OK", "text/html", html);
-            }
-        } else if (path == "/styles.css") {
-            std::string css = readFile("web/styles.css");
-            if (css.empty()) {
-                sendResponse(clientSocket, "404 Not Found", "text/plain", "File not found");
+        auto asset = staticAssets.find(path);
+        if (asset != staticAssets.end() && (method == "GET" || method == "HEAD")) {
+            sendStaticAsset(clientSocket, asset->second, request, method == "HEAD");
+        } else if (path == "/health") {
+            sendResponse(clientSocket, "200 OK", "text/plain", "OK");
+        } else if (path == "/" || path == "/index.html" || path == "/styles.css") {
+            sendResponse(clientSocket, "404 Not Found", "text/plain", "File not found");
+        } else if (path == "/search/batch") {
+            if (method != "POST") {
+                sendResponse(clientSocket, "405 Method Not Allowed", "text/plain", "Use POST");
             } else {
-                sendResponse(clientSocket, "200 OK", "text/css", css);
+                handleBatchSearch(clientSocket,
+                                  bodyStart < request.size() ? request.substr(bodyStart) : std::string());
             }
         } else if (path == "/search") {
-            std::string query = getParam(queryString, "q");
-            std::string modeStr = getParam(queryString, "mode");
-            std::string kStr = getParam(queryString, "k");
-            std::string k1Str = getParam(queryString, "k1");
-            std::string bStr = getParam(queryString, "b");
-            
-            std::string mode = modeStr;
-            int k = kStr.empty() ? 10 : std::stoi(kStr);
-            double k1 = k1Str.empty() ? 0.9 : std::stod(k1Str);
-            double b = bStr.empty() ? 0.4 : std::stod(bStr);
-            auto startTime = std::chrono::high_resolution_clock::now();
-            
-            // tokenize query
-            std::vector<std::string> tokens = tokenize_words(query);
-            std::unordered_set<std::string> uniqueSet(tokens.begin(), tokens.end());
-            std::vector<std::string> queryTerms(uniqueSet.begin(), uniqueSet.end());
-
-            // execute query
-            std::vector<QueryResult> results;
-            {
-                std::lock_guard<std::mutex> lock(evalMutex);
-                evaluator->updateBM25Params(k1, b);
-                results = evaluator->processQuery(queryTerms, mode, k);
-            }
-           
-            auto endTime = std::chrono::high_resolution_clock::now();
-            long long queryTime = std::chrono::duration_cast<std::chrono::milliseconds>(
-                endTime - startTime).count();
-            
-            // generate JSON response
-            std::string json = generateJsonResponse(results, queryTerms, queryTime);
-            sendResponse(clientSocket, "200 OK", "application/json", json);
-            
+            handleSearch(clientSocket, queryString);
+        } else if (path == "/count") {
+            handleCount(clientSocket, queryString);
+        } else if (path == "/suggest") {
+            handleSuggest(clientSocket, queryString);
         } else {
             sendResponse(clientSocket, "404 Not Found", "text/plain", "Not Found");
         }
@@ -291,23 +1500,26 @@ private:
     
 public:
     WebServer(int p, Lexicon* lex, Stats* st, DocLen* dl, DocTable* dt, DocContentFile* dc,
-              const std::string& idxDir, bm25::Params params)
+              DocPriors* pr, TierIndex* tiers, PairIndex* pairs, const std::string& idxDir, bm25::Params params,
+              const ServerOptions& opts)
         : port(p), serverSocket(INVALID_SOCKET), 
-          lexicon(lex), stats(st), docLen(dl), docTable(dt), docContent(dc),
-          indexDir(idxDir), bm25Params(params), evaluator(nullptr) {
+          lexicon(lex), stats(st), docLen(dl), docTable(dt), docContent(dc), docPriors(pr), tierIndex(tiers), pairIndex(pairs),
+          indexDir(idxDir), bm25Params(params), options(opts),
+          workers(std::max(1u, std::thread::hardware_concurrency())),
+          admission(opts.maxConcurrent > 0 ? opts.maxConcurrent
+                                           : std::max(1u, std::thread::hardware_concurrency()),
+                    opts.maxQueued),
+          resultCache(opts.resultCacheEntries, std::chrono::milliseconds(opts.resultCacheTtlMs)) {
         
 #ifdef _WIN32
         WSADATA wsaData;
         WSAStartup(MAKEWORD(2, 2), &wsaData);
 #endif
-evaluator = new QueryEvaluator(*lexicon, *stats, *docLen, *docTable, *docContent, indexDir, params);
+        loadStaticAsset({"/", "/index.html"}, "web/index.html");
+        loadStaticAsset({"/styles.css"}, "web/styles.css");
     }
     
     ~WebServer() {
-        if (evaluator) {
-            delete evaluator;
-        }
-        
         if (serverSocket != INVALID_SOCKET) {
             closesocket(serverSocket);
         }
@@ -367,14 +1579,64 @@ evaluator = new QueryEvaluator(*lexicon, *stats, *docLen, *docTable, *docContent
 
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        std::cout << "Usage: " << argv[0] << " <index_dir> <doc_table_path> [port]" << std::endl;
-        std::cout << "Example: " << argv[0] << " ./index ./output/doc_table.txt 8080" << std::endl;
+        std::cout << "Usage: " << argv[0] << " <index_dir> <doc_table_path> [port] [options]" << std::endl;
+        std::cout << "\nOptions:" << std::endl;
+        std::cout << "  --timeout-ms=N      Default search deadline in ms (default: none)" << std::endl;
+        std::cout << "  --max-concurrent=N  Searches evaluated at once (default: hardware threads)" << std::endl;
+        std::cout << "  --max-queue=N       Searches waiting for a slot before 503 (default: 64)" << std::endl;
+        std::cout << "  --reranker=FILE     Second-stage model (linear or gbdt, see reranker.hpp)" << std::endl;
+        std::cout << "  --rerank-depth=N    Default number of candidates to re-rank (default: 0 = off)" << std::endl;
+        std::cout << "  --fuzzy[=MIN_DF]    Build the typo index (terms with df >= MIN_DF, default 3); enables fuzzy=1" << std::endl;
+        std::cout << "  --result-cache=N    Ranked lists cached for pagination (default: 1024, 0 = off)" << std::endl;
+        std::cout << "  --result-cache-ttl-ms=N  Lifetime of a cached list (default: 30000)" << std::endl;
+        std::cout << "  --prefetch-pages=N  Pages ranked per evaluation and cached (default: 5)" << std::endl;
+        std::cout << "  --collapse-depth=N  Candidates collapse=1 reduces to one per near-duplicate cluster (default: 100)" << std::endl;
+        std::cout << "  --max-depth=N       Deepest rank /search serves (offset + k, rerank_depth; default: 10000)" << std::endl;
+        std::cout << "Example: " << argv[0] << " ./index ./output/doc_table.txt 8080 --timeout-ms=200" << std::endl;
         return 1;
     }
     
     std::string indexDir = argv[1];
     std::string docTablePath = argv[2];
-    int port = (argc >= 4) ? std::stoi(argv[3]) : 8080;
+    int port = 8080;
+    ServerOptions options;
+    uint32_t fuzzyMinDf = 0;   // 0 = no fuzzy index
+    
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.find("--timeout-ms=") == 0) {
+            options.defaultTimeoutMs = std::stoll(arg.substr(13));
+        } else if (arg.find("--max-concurrent=") == 0) {
+            options.maxConcurrent = std::stoul(arg.substr(17));
+        } else if (arg.find("--max-queue=") == 0) {
+            options.maxQueued = std::stoul(arg.substr(12));
+        } else if (arg.find("--reranker=") == 0) {
+            std::string error;
+            options.reranker = loadReranker(arg.substr(11), &error);
+            if (!options.reranker) {
+                std::cerr << "Failed to load reranker: " << error << std::endl;
+                return 1;
+            }
+        } else if (arg.find("--rerank-depth=") == 0) {
+            options.rerankDepth = std::stoul(arg.substr(15));
+        } else if (arg == "--fuzzy") {
+            fuzzyMinDf = 3;
+        } else if (arg.find("--fuzzy=") == 0) {
+            fuzzyMinDf = std::stoul(arg.substr(8));
+        } else if (arg.find("--result-cache=") == 0) {
+            options.resultCacheEntries = std::stoul(arg.substr(15));
+        } else if (arg.find("--result-cache-ttl-ms=") == 0) {
+            options.resultCacheTtlMs = std::stoll(arg.substr(22));
+        } else if (arg.find("--prefetch-pages=") == 0) {
+            options.prefetchPages = std::stoul(arg.substr(17));
+        } else if (arg.find("--collapse-depth=") == 0) {
+            options.collapseDepth = std::stoul(arg.substr(17));
+        } else if (arg.find("--max-depth=") == 0) {
+            options.maxResultDepth = std::max<size_t>(std::stoul(arg.substr(12)), 1);
+        } else if (arg.find("--") != 0) {
+            port = std::stoi(arg);
+        }
+    }
     
     std::cout << "Loading index..." << std::endl;
     
@@ -399,6 +1661,31 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    DocPriors docPriors;
+    docPriors.load(indexDir);
+    
+    TierIndex tierIndex;
+    tierIndex.load(indexDir);
+    
+    PairIndex pairIndex;
+    pairIndex.load(indexDir);
+    
+    CompletionTrie suggestions;
+    if (suggestions.load(indexDir + "/suggest.bin")) {
+        options.suggestions = &suggestions;
+    }
+    
+    ForwardIndex forwardIndex;
+    if (forwardIndex.load(indexDir)) {
+        options.forwardIndex = &forwardIndex;
+    }
+    
+    FuzzyIndex fuzzyIndex;
+    if (fuzzyMinDf > 0) {
+        fuzzyIndex.build(lexicon, fuzzyMinDf);
+        options.fuzzyIndex = &fuzzyIndex;
+    }
+    
     // ---- Load document content ----
     DocContentFile docContent;
     std::string offsetPath = docTablePath;
@@ -415,12 +1702,19 @@ int main(int argc, char* argv[]) {
     if (!docContent.load(offsetPath, contentPath)) {
         std::cerr << "Warning: Could not load document content, snippets will be unavailable" << std::endl;
     }
+    
+    DocClusters docClusters;
+    if (docClusters.load((lastSlash != std::string::npos ? docTablePath.substr(0, lastSlash + 1) : "") +
+                         "doc_canonical.bin")) {
+        options.docClusters = &docClusters;
+    }
 
     std::cout << "Index loaded successfully!" << std::endl;
     
     // start web server
     bm25::Params bm25Params(0.9, 0.4);
-    WebServer server(port, &lexicon, &stats, &docLen, &docTable, &docContent, indexDir, bm25Params);
+    WebServer server(port, &lexicon, &stats, &docLen, &docTable, &docContent, &docPriors, &tierIndex,
+                     &pairIndex, indexDir, bm25Params, options);
     
     if (!server.start()) {
         return 1;